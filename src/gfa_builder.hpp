@@ -7,10 +7,15 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
-#include <set>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
 #include <zlib.h>
 #include <ostream>
 #include "gfakluge.hpp"
+#include "gfa_fasta.hpp"
+#include "gfa_vcf.hpp"
 #include "tinyFA.hpp"
 #include "pliib.hpp"
 
@@ -30,46 +35,6 @@
  * Lastly, wire up deletio / inversion edges and emit the graph
  *
  */
-struct VCF_Variant{
-    std::string seq;
-    int pos;
-    std::string ref;
-    std::vector<std::string> alts;
-    std::map<std::string, std::string> info;
-    std::string raw_info_line;
-
-    VCF_Variant(){
-
-    };
-    VCF_Variant(std::string line){
-        std::vector<std::string> splits = pliib::split(line, '\t');
-        seq = splits[0];
-        pos = stoi(splits[1]);
-        ref = splits[3];
-        alts = pliib::split(splits[4], ',');
-
-        raw_info_line = splits[7];
-        std::vector<std::string> isplits = pliib::split(splits[7], ';');
-        for (auto i : isplits){
-            std::vector<std::string> xsplits = pliib::split(i, '=');
-            if (xsplits.size() == 1){
-                this->info[xsplits[0]] = xsplits[0];
-            }
-            else{
-                this->info[xsplits[0]] = xsplits[1];
-            }
-        }
-    };
-    std::string to_string(){
-        std::stringstream st;
-        st << seq << '\t' <<
-            pos << '\t' << "." << '\t' << 
-            ref << '\t' <<
-            std::endl;
-        return st.str();
-    };
-};
-
 struct dummy_node{
     uint32_t id = 0;
     uint32_t length = 0;
@@ -108,54 +73,221 @@ inline void set_gfa_node_values(gfak::sequence_elem& s){
     s.length = s.sequence.length();
 };
 
+/**
+ * Writes the nodes and edges of a single contig as they are made. IDs are
+ * counted from 1 within the contig and written with node_offset /
+ * edge_offset added, so a contig can be written as soon as the ID counts
+ * of the contigs before it are known. A writer with no output stream
+ * only counts IDs.
+ */
+struct contig_writer{
+    gfak::GFAKluge* gg = nullptr;
+    std::ostream* os = nullptr;
+    int node_offset = 0;
+    int edge_offset = 0;
+    std::string name;
+    // The reference path, as runs of consecutive node IDs (first ID, run length).
+    std::vector<std::pair<int, int>> path;
+    std::size_t path_length = 0;
+    // Number of node and edge IDs used (some IDs may not have a node).
+    int node_count = 0;
+    int edge_count = 0;
+    // State of the path line being written, which is flushed to os in pieces.
+    std::string line;
+    bool gfa2 = true;
+    bool first_step = true;
+    std::size_t run = 0;
+    std::size_t run_rank = 0;
+
+    contig_writer(){
+
+    }
+    contig_writer(gfak::GFAKluge& g, std::ostream& o, int n_offset, int e_offset) :
+        gg(&g), os(&o), node_offset(n_offset), edge_offset(e_offset){
+
+    }
+
+    inline bool counting() const{
+        return os == nullptr;
+    }
+    inline void add(gfak::sequence_elem& s){
+        if (os == nullptr){
+            return;
+        }
+        s.name = std::to_string(s.id + node_offset);
+        gg->write_element(*os, s);
+        *os << '\n';
+        s.name = std::to_string(s.id);
+    }
+    inline void add(gfak::edge_elem e){
+        if (os == nullptr){
+            return;
+        }
+        e.id = std::to_string(std::stoll(e.id) + edge_offset);
+        e.source_name = std::to_string(std::stoll(e.source_name) + node_offset);
+        e.sink_name = std::to_string(std::stoll(e.sink_name) + node_offset);
+        gg->write_element(*os, e);
+        *os << '\n';
+    }
+    inline void add_path_node(int id){
+        if (!path.empty() && path.back().first + path.back().second == id){
+            ++path.back().second;
+        }
+        else{
+            path.push_back(std::make_pair(id, 1));
+        }
+        ++path_length;
+    }
+
+    /** Start a path line: an O line in GFA2 graphs, a P line in GFA1 graphs. **/
+    inline void begin_path(const std::string& path_name){
+        gfa2 = gg->get_version() >= 2.0;
+        first_step = true;
+        run = 0;
+        run_rank = 0;
+        line.clear();
+        line.push_back(gfa2 ? 'O' : 'P');
+        line.push_back('\t');
+        line.append(path_name);
+        line.push_back('\t');
+    }
+    inline void step(int id){
+        if (!first_step){
+            line.push_back(gfa2 ? ' ' : ',');
+        }
+        first_step = false;
+        char digits[12];
+        int n = 0;
+        unsigned int v = id + node_offset;
+        do{
+            digits[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v > 0);
+        while (n > 0){
+            line.push_back(digits[--n]);
+        }
+        line.push_back('+');
+        if (line.length() >= (1 << 16)){
+            os->write(line.data(), line.length());
+            line.clear();
+        }
+    }
+    /**
+     * Add the reference path nodes with ranks [from, to) to the path line.
+     * Ranks must increase along a line.
+     */
+    inline void reference_steps(std::size_t from, std::size_t to){
+        for (std::size_t rank = from; rank < to; ++rank){
+            while (rank >= run_rank + path[run].second){
+                run_rank += path[run].second;
+                ++run;
+            }
+            step(path[run].first + (rank - run_rank));
+        }
+    }
+    inline void end_path(){
+        line.append(gfa2 ? "\n" : "\t*\n");
+        os->write(line.data(), line.length());
+        line.clear();
+    }
+
+    /** Write the contig's reference path. **/
+    inline void finish(){
+        if (os == nullptr){
+            return;
+        }
+        begin_path(name);
+        reference_steps(0, path_length);
+        end_path();
+    }
+};
+
+/**
+ * Reads a contig (or a region of one, starting at contig_begin) through
+ * the FASTA index one window at a time. Each window starts at the node
+ * being read and holds at least window_size bases, so only about one
+ * window of sequence is held while a contig is built.
+ */
+struct sequence_window{
+    const gfak::mapped_fasta* fa = nullptr;
+    const gfak::fasta_record* record = nullptr;
+    std::uint64_t contig_begin = 0;
+    std::uint64_t window_size = 1 << 20;
+    std::string buf;
+    std::uint64_t buf_begin = 0;
+
+    sequence_window(const gfak::mapped_fasta& f, const gfak::fasta_record& r, std::uint64_t begin) :
+        fa(&f), record(&r), contig_begin(begin){
+
+    }
+
+    /** Set seq to <length> bases starting at begin (relative to contig_begin). **/
+    inline bool get(std::uint64_t begin, std::uint64_t length, std::string& seq){
+        gfak::field_view v;
+        if (fa->view(*record, contig_begin + begin, length, v)){
+            seq.assign(v.data, v.length);
+            return true;
+        }
+        if (begin < buf_begin || begin + length > buf_begin + buf.length()){
+            buf_begin = begin;
+            if (!fa->get_sequence(*record, contig_begin + begin, std::max(length, window_size), buf) ||
+                    buf.length() < length){
+                buf.clear();
+                seq.clear();
+                return false;
+            }
+        }
+        seq.assign(buf, begin - buf_begin, length);
+        return true;
+    }
+};
+
 
 /**
  * Convert a variant to 1 or 2 breakpoints (in basepairs)
- * input: A VCF_Variant struct, which should have
- * a sequence, a position, and reference + alternate alleles.
- * Optionally can have an SVLEN info field.
+ * input: A vcf_variant, which should have
+ * a position and reference + alternate alleles.
+ * Structural variants also have an SVTYPE and an SVLEN (or END).
  * 
  * Returns: a pair<int, int>, where the first integer is the first
  * breakpoint and the second is either the second breakpoint or
  * -1, indicating the second break is off the contig.
  * 
  */
-inline std::pair<int, int> variant_to_breakpoint(const VCF_Variant& var){
+inline std::pair<int, int> variant_to_breakpoint(const gfak::vcf_variant& var){
     int front = 0;
     int back = 0;
-    if ( var.info.find("SVTYPE") == var.info.end() &&
-        var.info.find("SVLEN") == var.info.end() && 
-        var.info.find("END") == var.info.end()){
+    if (var.svtype == gfak::SV_NONE){
         // This is an SNV or indel;
         // We'll need a break at both ends of its REF
         // sequence, and we'll wire any edges/or nodes
         // to those breakpoints.
         front = var.pos - 1;
-        back = var.pos - 1 + var.ref.length();
+        back = var.pos - 1 + var.ref_length;
     }
-    else if (var.info.at("SVTYPE") == "DEL"){
+    else if (var.svtype == gfak::SV_DEL){
         front = var.pos - 1;
-        back = var.pos - 1 + (uint32_t) stoi(var.info.at("SVLEN"));
+        back = var.pos - 1 + var.svlen;
     }
-    else if (var.info.at("SVTYPE") == "INS"){
-        front = var.pos - 1;
-        back = var.pos  - 1;
+    else if (var.svtype == gfak::SV_INS){
+        // The insertion follows the base at POS.
+        front = var.pos;
+        back = var.pos;
     }
-    else if (var.info.at("SVTYPE") == "DUP"){
+    else if (var.svtype == gfak::SV_DUP){
         front = var.pos - 1;
-        back = var.pos - 1 + (uint32_t) stoi(var.info.at("SVLEN"));
+        back = var.pos - 1 + var.svlen;
 
     }
-    else if (var.info.at("SVTYPE") == "INV"){
-        std::cerr << "inversion parsed" << std::endl;
+    else if (var.svtype == gfak::SV_INV){
         front = var.pos - 1;
-        back = var.pos - 1 + (uint32_t) stoi(var.info.at("SVLEN"));
+        back = var.pos - 1 + var.svlen;
     }
-    else if (var.info.at("SVTYPE") == "TRA"){
+    else if (var.svtype == gfak::SV_TRA){
         front = var.pos - 1;
         back = -1;
     }
-    else if (var.info.at("SVTYPE") == "BND"){
+    else if (var.svtype == gfak::SV_BND){
         front = var.pos - 1;
         back = -1;
     }
@@ -168,324 +300,248 @@ inline std::pair<int, int> variant_to_breakpoint(const VCF_Variant& var){
 
 
 /**
- * 
- * 
- */
-void make_contig_to_breakpoints(char* fasta_file,
-        char* vcf_file,
-        std::map<std::string, std::vector<VCF_Variant*>>& contig_to_variants,
-        std::map<std::string, std::map<int, std::vector<VCF_Variant*>>>& contig_to_breakpoints_to_variants,
-        std::map<std::string, std::vector<int>>& contig_to_breakpoints,
-        std::vector<VCF_Variant*>& insertions,
-        int max_node_length = 100){
-
-    std::ifstream ifi;
-    ifi.open(vcf_file);
-
-    if (ifi.good()){
-
-        std::string line;
-        while (std::getline(ifi, line)){
-            if (line[0] != '#'){
-                VCF_Variant* vv = new VCF_Variant(line);
-                std::string contig = vv->seq;
-                std::pair<int, int> breaks = variant_to_breakpoint(*vv);
-                //std::cerr << vv->seq << " " << vv->pos << " " << breaks.first << " " << breaks.second << std::endl; 
-                if (breaks.first != -1 && breaks.second != -1){
-                    contig_to_breakpoints[contig].push_back(breaks.first);
-                    contig_to_breakpoints[contig].push_back(breaks.second);
-                    contig_to_breakpoints_to_variants[contig][breaks.first].push_back(vv);
-                    contig_to_variants[contig].push_back(vv);
-                    
-                }
-
-                if (vv->info.find("SVTYPE") == vv->info.end()){
-                    insertions.push_back(vv);
-                }
-                else if ( vv->info.at("SVTYPE").empty() || 
-                            vv->info.at("SVTYPE") == "SNP" ||
-                            vv->info.at("SVTYPE") == "INS"){
-                    insertions.push_back(vv);
-                }
-                else if (vv->info.at("SVTYPE") == "TRA" ||
-                            vv->info.at("SVTYPE") == "BND"){
-                    // Get the relevant information from the alt field.
-                    // if our breaks are on the same chromosome, just tuck
-                    // them in like usual.
-                    std::cerr << "TRA/BND not yet implemented. Skipping variant." << std::endl;
-                }
-            }
-        }
-    }
-    else{
-        std::cerr << "ERROR [gfak build] : could not open VCF file " << vcf_file << std::endl;
-        exit(9);
-    }
-
-
-    TFA::tiny_faidx_t tf;
-    if (TFA::checkFAIndexFileExists(fasta_file)){
-        TFA::parseFAIndex(fasta_file, tf);
-    }
-    else{
-        TFA::createFAIndex(fasta_file, tf);   
-    }
-
-    for (auto k : contig_to_breakpoints){
-        uint32_t seq_len = 0;
-        TFA::getSequenceLength(tf, k.first.c_str(), seq_len);
-
-        for (int i = max_node_length; i <= seq_len; i += max_node_length){
-            contig_to_breakpoints[k.first].push_back(i);
-        }
-        contig_to_breakpoints[k.first].push_back(seq_len);
-        std::set<int> bpset (k.second.begin(), k.second.end());
-        std::vector<int> sbp (bpset.begin(), bpset.end());
-        //std::sort(sbp.begin(), sbp.end());
-        contig_to_breakpoints[k.first] = sbp;
-        std::sort(contig_to_breakpoints.at(k.first).begin(), contig_to_breakpoints.at(k.first).end());
-
-    
-    }
-
-};
-
-
-/**
- * Format the breakpoint vector for a single contig in a FASTA file.
+ * Find the variant breakpoints of a single contig.
  * inputs:
- *   - contig: contig name
- *   - fasta_file: fasta file containing contig sequence
- *   - variants: A vector of variants on the contig contig
+ *   - cv: the variants on the contig
+ *   - seq_len: the length of the contig
  *   - breakpoints: an empty int vector, which is modified to hold breakpoints.
- *   - bp_to_variants: a map which points from a breakpoint (in basepairs) to the variants at that breakpoint
- *   - max_node_length: the maximum length of a node
+ *   - bp_to_variants: a map which points from a breakpoint (in basepairs) to the
+ *     indices (in cv.variants) of the variants at that breakpoint
  * 
  * modified: 
- *   - breakpoints
+ *   - breakpoints: sorted and unique, within (0, seq_len]. The breaks every
+ *     max_node_length bases and at the end of the contig are added as the
+ *     contig is built, so they are never stored.
  *   - bp_to_variants
  */
-void make_breakpoints(const std::string& contig, char* fasta_file,
-        const std::vector<VCF_Variant*>& variants,
+inline void make_breakpoints(const gfak::contig_variants& cv, int seq_len,
         std::vector<int>& breakpoints,
-        std::map<int, std::vector<VCF_Variant*>>& bp_to_variants,
-        const int& max_node_length){
+        std::map<int, std::vector<std::size_t>>& bp_to_variants){
 
-    int numvars = variants.size();
-    //breakpoints.reserve(numvars * 2);
-    for (int i = 0; i < numvars; ++i){
-        std::pair<int, int> bps = variant_to_breakpoint(*variants[i]);
+    for (std::size_t i = 0; i < cv.variants.size(); ++i){
+        const gfak::vcf_variant& v = cv.variants[i];
+        std::pair<int, int> bps = variant_to_breakpoint(v);
         if (bps.first != -1 && bps.second != -1){
             breakpoints.push_back(bps.first);
             breakpoints.push_back(bps.second);
-            bp_to_variants[bps.first].push_back(variants[i]);
+            bp_to_variants[bps.first].push_back(i);
+        }
+        if (v.svtype == gfak::SV_TRA || v.svtype == gfak::SV_BND){
+            // Get the relevant information from the alt field.
+            // if our breaks are on the same chromosome, just tuck
+            // them in like usual.
+            std::cerr << "TRA/BND not yet implemented. Skipping variant." << std::endl;
         }
-        
-    }
-
-    uint32_t seq_len = 0; 
-    TFA::tiny_faidx_t tf;
-    if (TFA::checkFAIndexFileExists(fasta_file)){
-        TFA::parseFAIndex(fasta_file, tf);
-    }
-    else{
-        TFA::createFAIndex(fasta_file, tf);   
-    }
-
-    TFA::getSequenceLength(tf, contig.c_str(), seq_len);
-
-    for (int i = max_node_length; i < seq_len; i += max_node_length){
-        breakpoints.push_back(i);
     }
-    breakpoints.push_back(seq_len);
-
-    std::set<int> bpset (breakpoints.begin(), breakpoints.end());
-
-    breakpoints = std::vector<int>(bpset.begin(), bpset.end());
 
     std::sort(breakpoints.begin(), breakpoints.end());
-
+    breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+    breakpoints.erase(std::remove_if(breakpoints.begin(), breakpoints.end(), [&](int bp){
+                return bp <= 0 || bp > seq_len;
+                }), breakpoints.end());
 }
 
 
 /**
  * Constructs a contig graph
  * inputs:
- *   - contig_name:
- *   - contig_seq:
- *   - seq_len:
- *   - breakpoints:
+ *   - cv: the variants of the contig, whose name names the path
+ *   - contig_seq: a window over the contig's FASTA record
+ *   - seq_len: the length of the contig
+ *   - breakpoints: the variant breakpoints, from make_breakpoints
  *   - bp_to_variants:
- *   - variants: 
+ *   - max_node_length: the maximum length of a node
  *   - insertion_fasta: a fasta file pointer or NULL
- *   - gg: a GFAKluge object, set to the desired version
- *   - os: a std::ostream (e.g. stdout)
- *   - base_seq_id: the starting index for seq names
- *   - base_edge_id: the starting index for edge ids
+ *   - cw: a contig_writer, which gets each node and edge as it is made
  * 
  * modified:
- *   - gg may have its state modified
- *   - os is modified and elements are written to it.
- *   - base_edge_id and base_seq_id are modified
+ *   - cw has written the nodes, edges and path of the contig, and
+ *     holds its ID counts.
  * 
+ * Nodes are read and written one breakpoint at a time, so memory use
+ * depends on the window size and the number of variants, not on the
+ * length of the contig. Contigs are independent, so several can be
+ * constructed at once.
  */
-void construct_contig_graph(std::string contig_name,
-        char* contig_seq,
+void construct_contig_graph(const gfak::contig_variants& cv,
+        sequence_window& contig_seq,
         uint32_t seq_len,
         const std::vector<int>& breakpoints,
-        const std::map<int, std::vector<VCF_Variant*>>& bp_to_variants,
-        const std::vector<VCF_Variant*>& variants,
+        const std::map<int, std::vector<std::size_t>>& bp_to_variants,
+        int max_node_length,
         char* insertion_fasta,
-        gfak::GFAKluge& gg,
-        std::ostream& os,
-        int& base_seq_id,
-        int& base_edge_id){
+        contig_writer& cw){
 
-    char* dummy_name = new char[contig_name.size() + 1];
-    memcpy(dummy_name, contig_name.c_str(), contig_name.size() + 1);
+    const std::string& contig_name = cv.name;
 
-    int numbp = breakpoints.size();
-    int prev = 0;
+    // Opened (and indexed) once per process, however many contigs use it.
+    const gfak::mapped_fasta* insert_fa = insertion_fasta != NULL ? gfak::open_fasta(insertion_fasta) : nullptr;
 
-    TFA::tiny_faidx_t* insert_tf;
-    if (insertion_fasta != NULL){
-        insert_tf = new TFA::tiny_faidx_t();
 
-        if (TFA::checkFAIndexFileExists(insertion_fasta)){
-            TFA::parseFAIndex(insertion_fasta, *insert_tf);
-        }
-        else{
-            TFA::createFAIndex(insertion_fasta, *insert_tf);
-        }
-    }
-
-
-    int current_id = base_seq_id;
+    int current_id = 0;
     uint32_t current_length = 0;
-    int current_edge_id = base_edge_id;
+    int base_edge_id = 0;
     int current_pos = 0;
-    std::vector<int64_t> ins_nodes;
-    bool snptrip = false;
-
 
+    // The last reference node, the SNP / indel ALT nodes made at its end
+    // (which bypass the next reference node), the ALT nodes that bypass
+    // it (which join the next reference node) and the insertion nodes
+    // made at its end (which join the next reference node).
+    dummy_node last_ref;
+    std::vector<dummy_node> new_alts;
+    std::vector<dummy_node> bypass_alts;
+    std::vector<dummy_node> new_insertions;
 
-
-    std::vector<dummy_node*> contig_nodes;
-    std::map<std::string, std::set<int>> path_to_nodes;
     std::map<int, int> bp_to_node_id;
     std::map<int, int> node_id_to_length;
-    std::map<std::string, int> insertion_id_to_node_id;
 
+    // Only the node ends the structural variants are wired to are remembered.
+    std::set<int> sv_ends;
+    for (const gfak::vcf_variant& v : cv.variants){
+        if (v.svtype == gfak::SV_DEL || v.svtype == gfak::SV_DUP || v.svtype == gfak::SV_INV){
+            sv_ends.insert(v.pos - 1 - 1);
+            sv_ends.insert(v.pos - 1);
+            sv_ends.insert(v.pos - 1 - 1 + v.svlen);
+            sv_ends.insert(v.pos - 1 + v.svlen);
+        }
+    }
+
+    // For haplotype paths, the reference path ranks [front, back) that each
+    // variant's REF covers and the ID of its first ALT node.
+    struct allele_span{
+        int front = -1;
+        int back = -1;
+        int alt = -1;
+    };
+    bool with_haplotypes = cv.haplotypes && !cw.counting();
+    std::vector<allele_span> spans;
+    std::map<int, std::vector<std::size_t>> front_to_variants;
+    std::map<int, std::vector<std::size_t>> back_to_variants;
+    if (with_haplotypes){
+        spans.resize(cv.variants.size());
+        for (std::size_t v = 0; v < cv.variants.size(); ++v){
+            const gfak::vcf_variant& var = cv.variants[v];
+            if (var.svtype == gfak::SV_NONE || var.svtype == gfak::SV_DEL){
+                front_to_variants[var.pos - 1].push_back(v);
+                back_to_variants[var.pos - 1 + (var.svtype == gfak::SV_NONE ? (int) var.ref_length : var.svlen)].push_back(v);
+            }
+        }
+    }
 
-    for (int i = 0; i < numbp; ++i){
+    std::size_t next_vbp = 0;
+    for (int i = 0; current_pos < (int) seq_len; ++i){
 
         int ins_offset = 0;
-        int bp = breakpoints[i];
+        // The next breakpoint is the nearest of the next variant breakpoint,
+        // the next multiple of max_node_length and the end of the contig.
+        int bp = max_node_length > 0 ? (current_pos / max_node_length + 1) * max_node_length : seq_len;
+        bp = std::min(bp, (int) seq_len);
+        while (next_vbp < breakpoints.size() && breakpoints[next_vbp] <= current_pos){
+            ++next_vbp;
+        }
+        if (next_vbp < breakpoints.size()){
+            bp = std::min(bp, breakpoints[next_vbp]);
+        }
         ++current_id;
 
         gfak::sequence_elem s;
-        s.sequence.assign(contig_seq + current_pos, bp - current_pos);
+        if (!cw.counting() && !contig_seq.get(current_pos, bp - current_pos, s.sequence)){
+            std::cerr << "ERROR [gfak build] : FASTA record " << contig_name << " does not match its index." << std::endl;
+            exit(1);
+        }
         s.id = current_id;
         set_gfa_node_values(s);
         current_length = s.length;
         
-        bp_to_node_id[current_pos] = current_id;
-        bp_to_node_id[bp - 1] = current_id;
-        node_id_to_length[current_id] = current_length;
+        if (sv_ends.count(current_pos)){
+            bp_to_node_id[current_pos] = current_id;
+            node_id_to_length[current_id] = current_length;
+        }
+        if (sv_ends.count(bp - 1)){
+            bp_to_node_id[bp - 1] = current_id;
+            node_id_to_length[current_id] = current_length;
+        }
 
-        gg.write_element(os, s);
-        os << std::endl;
+        cw.add(s);
 
-        if (i > 0){
-            if (snptrip){
-                int prev_ref = 0;
-                prev_ref = contig_nodes.size() - 2;
-                while ( contig_nodes[prev_ref]->path == NULL){
-                    // std::cerr << "WARN: not handling snp nodes right now" << std::endl;
-                    // break;
-                    gfak::edge_elem e;
-                    set_gfa_edge_defaults(e, ++base_edge_id);
-                    e.source_name = std::to_string(contig_nodes[prev_ref]->id);
-                    e.sink_name = std::to_string(current_id);
-                    e.source_begin = current_length;
-                    e.source_end = current_length;
-                    
-                    gg.write_element(os, e);
-                    os << std::endl;
-                    prev_ref--;
+        if (with_haplotypes){
+            auto f = front_to_variants.find(current_pos);
+            if (f != front_to_variants.end()){
+                for (auto v : f->second){
+                    spans[v].front = i;
                 }
-                snptrip = false;
-                std::vector<dummy_node*>().swap(contig_nodes);
-                //contig_nodes.clear();
             }
-
-            // SNPs / insertions aren't on the reference path
-            if ( contig_nodes.back()->path == NULL ){
-                int prev_ref = contig_nodes.size() - 1;
-                while ( (contig_nodes[prev_ref])->path == NULL ){
-                    // SNP / insertion nodes are already connected properly.
-                    // gfak::edge_elem e;
-                    // set_gfa_edge_defaults(e, ++base_edge_id);
-                    // e.source_name = std::to_string((contig_nodes[prev_ref])->id);
-                    // e.sink_name = std::to_string(s.id);
-                    //e.source_begin = contig_nodes[prev_ref]->length;
-                    //e.source_end = contig_nodes[prev_ref]->length;
-
-                    //gg.write_element(os, e);
-                    //os << std::endl;
-                    --prev_ref;
+            auto b = back_to_variants.find(bp);
+            if (b != back_to_variants.end()){
+                for (auto v : b->second){
+                    spans[v].back = i + 1;
                 }
-                // Connect up to the last reference nodes.
+            }
+        }
+
+        if (i > 0){
+            // The ALT nodes that bypass the last reference node join the
+            // new node, and so do the insertions after it and the last
+            // reference node itself.
+            for (auto& ins : new_insertions){
                 gfak::edge_elem e;
                 set_gfa_edge_defaults(e, ++base_edge_id);
-                e.source_name = std::to_string((contig_nodes[prev_ref])->id);
+                e.source_name = std::to_string(ins.id);
                 e.sink_name = std::to_string(current_id);
-                e.source_begin = contig_nodes[prev_ref]->length;
-                e.source_end = contig_nodes[prev_ref]->length;
-                snptrip = true;
-                gg.write_element(os, e);
-                os << std::endl;
+                e.source_begin = ins.length;
+                e.source_end = ins.length;
+                cw.add(e);
             }
-            else{
+            for (auto alt = bypass_alts.rbegin(); alt != bypass_alts.rend(); ++alt){
                 gfak::edge_elem e;
                 set_gfa_edge_defaults(e, ++base_edge_id);
-                e.source_name = std::to_string((contig_nodes.back())->id);
+                e.source_name = std::to_string(alt->id);
                 e.sink_name = std::to_string(current_id);
-                e.source_begin = (contig_nodes.back())->length;
-                e.source_end = (contig_nodes.back())->length;
-                gg.write_element(os, e);
-                os << std::endl;
+                e.source_begin = alt->length;
+                e.source_end = alt->length;
+                cw.add(e);
             }
+            gfak::edge_elem e;
+            set_gfa_edge_defaults(e, ++base_edge_id);
+            e.source_name = std::to_string(last_ref.id);
+            e.sink_name = std::to_string(current_id);
+            e.source_begin = last_ref.length;
+            e.source_end = last_ref.length;
+            cw.add(e);
         }
+        // The ALT nodes made at the end of the last reference node bypass
+        // this one.
+        bypass_alts.swap(new_alts);
+        new_alts.clear();
+        new_insertions.clear();
 
-        dummy_node* dn = new dummy_node();
-        dn->id = s.id;
-        dn->length = current_length;
-        dn->path = dummy_name;
-
-        contig_nodes.push_back(dn);
-        path_to_nodes[contig_name].insert(s.id);
+        last_ref.id = s.id;
+        last_ref.length = current_length;
+        cw.add_path_node(s.id);
 
     if (bp_to_variants.find(bp) != bp_to_variants.end()){
 
-        std::vector<VCF_Variant*> bp_vars = bp_to_variants.at(bp);
-        for (int i = 0; i < bp_vars.size(); ++i){
-            VCF_Variant* bvar = bp_vars[i];
-            if (bvar->info.find("SVTYPE") == bvar->info.end()){
+        const std::vector<std::size_t>& bp_vars = bp_to_variants.at(bp);
+        for (std::size_t i = 0; i < bp_vars.size(); ++i){
+            const gfak::vcf_variant* bvar = &cv.variants[bp_vars[i]];
+            if (bvar->svtype == gfak::SV_NONE){
                 //int max_alt_size = 0;
-                for (int altp = 0; altp < bvar->alts.size(); ++altp){
+                std::size_t num_alts = cv.alt_count(*bvar);
+                for (std::size_t altp = 0; altp < num_alts; ++altp){
+                    gfak::field_view alt = cv.alt(*bvar, altp);
                     gfak::sequence_elem snp_s;
-                    snp_s.sequence.assign(bvar->alts[altp]);
+                    snp_s.sequence.assign(alt.data, alt.length);
                     snp_s.id = ++current_id;
+                    if (with_haplotypes && altp == 0){
+                        spans[bp_vars[i]].alt = snp_s.id;
+                    }
                     set_gfa_node_values(snp_s);
-                    dummy_node* snn = new dummy_node();
-                    snn->id = snp_s.id;
-                    snn->length = snp_s.length;
-                    snn->path = NULL;
-                    contig_nodes.push_back(snn);
+                    dummy_node snn;
+                    snn.id = snp_s.id;
+                    snn.length = snp_s.length;
+                    new_alts.push_back(snn);
 
-                    gg.write_element(os, snp_s);
-                    os << std::endl;
+                    cw.add(snp_s);
 
                     gfak::edge_elem e;
                     set_gfa_edge_defaults(e, ++base_edge_id);
@@ -494,96 +550,92 @@ void construct_contig_graph(std::string contig_name,
                     e.source_begin = s.length;
                     e.source_end = s.length;
                     //ins_offset = std::max(ins_offset, max_alt_size);
-                    ins_offset = std::max(ins_offset, (int) bvar->alts[altp].size());
-
-                    gg.write_element(os, e);
-                    os << std::endl;
+                    ins_offset = std::max(ins_offset, (int) alt.length);
+
+                    cw.add(e);
+
+                    // ALT nodes of a variant that ends where this one
+                    // starts lead straight into it.
+                    for (auto alt = bypass_alts.rbegin(); alt != bypass_alts.rend(); ++alt){
+                        gfak::edge_elem ae;
+                        set_gfa_edge_defaults(ae, ++base_edge_id);
+                        ae.source_name = std::to_string(alt->id);
+                        ae.sink_name = std::to_string(snp_s.id);
+                        ae.source_begin = alt->length;
+                        ae.source_end = alt->length;
+                        cw.add(ae);
+                    }
 
                     //exit(1);
                 }
             }
-            else if (bvar->info.at("SVTYPE") == "INS"){
-
-                int altp = 0;
-                std::string seq;
-                gfak::sequence_elem ins_node;
-
-                std::cerr << "Processing insertion at " << bvar->seq << " " << bvar->pos << std::endl;
-                if (bvar->info.find("SEQ") != bvar->info.end() && 
-                   bvar->info.at("SEQ").find(",") == std::string::npos){
-                // Since there is a "SEQ" field in the info, we'll use it as our
-                // node sequence.
-                // NB: no checking is done for validity.
-                    seq.assign(bvar->info.at("SEQ"));
-                    ins_node.id = ++current_id;
-                    ins_node.sequence.assign(seq);
-                    std::stringstream ins_id_st;
-                    ins_id_st << "INS_" << bvar->seq << '_' << bvar->pos << '_' << altp;
-                    insertion_id_to_node_id[ins_id_st.str()] = ins_node.id;
-                    std::cerr << ins_id_st.str() << std::endl;
-                }
-                else if (bvar->alts.size() == 1){
-                    // We will check if the single alt is canonical DNA, then if it
-                    // has a sequence (FASTA) tag, and finally we'll
-                    // and just put a run of 'N's.
-                    if (pliib::canonical(bvar->alts[0])){
-                        seq.assign(bvar->alts[0]);
-                        ins_node.id = ++current_id;
-                        ins_node.sequence.assign(seq);
-                        std::stringstream ins_id_st;
-                        ins_id_st << "INS_" << bvar->seq << '_' << bvar->pos << '_' << altp;
-                        insertion_id_to_node_id[ins_id_st.str()] = ins_node.id;
-                        std::cerr << ins_id_st.str() << std::endl;
-                    }
-                    else if (bvar->alts[0][0] == '<' && 
-                        bvar->alts[0][bvar->alts[0].size() - 1] == '>' ){
-
-                        }
+            else if (bvar->svtype == gfak::SV_INS){
+                // The inserted sequence is the INFO SEQ, or else each ALT:
+                // a DNA allele (without the REF base it is padded with) or
+                // a symbolic allele (<ID>) whose sequence is the record
+                // named ID in the insertion FASTA.
+                std::vector<std::string> ins_seqs;
+                gfak::field_view info_seq = cv.seq(*bvar);
+                if (!info_seq.empty() &&
+                   std::memchr(info_seq.data, ',', info_seq.length) == nullptr){
+                    // NB: no checking is done for validity.
+                    ins_seqs.push_back(info_seq.str());
                 }
                 else{
-                    // There are multiple alt sequences.
-                    // Iterate over each one and wire up a single node and a single edge.
-                    std::cerr << "Multiple alt sequences" << std::endl;
+                    gfak::field_view ref = cv.ref(*bvar);
+                    for (std::size_t altp = 0; altp < cv.alt_count(*bvar); ++altp){
+                        std::string alt = cv.alt(*bvar, altp).str();
+                        std::string seq;
+                        if (pliib::canonical(alt)){
+                            seq = alt.substr(ref.length == 1 && alt.size() > 1 && alt[0] == ref.front() ? 1 : 0);
+                        }
+                        else if (alt.size() > 2 && alt[0] == '<' && alt[alt.size() - 1] == '>'){
+                            const gfak::fasta_record* ins_rec = insert_fa == nullptr ? nullptr :
+                                insert_fa->find(alt.substr(1, alt.size() - 2));
+                            if (ins_rec == nullptr || !insert_fa->get_sequence(*ins_rec, seq)){
+                                seq.clear();
+                            }
+                        }
+                        if (seq.empty()){
+                            std::cerr << "No sequence for insertion " << alt << " at " << contig_name << ":" << bvar->pos <<
+                                "; skipping it." << std::endl;
+                            continue;
+                        }
+                        ins_seqs.push_back(seq);
+                    }
                 }
 
-            //    for (altp = 0; altp < bvar->alts[altp].size(); ++altp){
-            //         gfak::sequence_elem ins_node;
-            //         std::string seq = bvar->alts[altp];
-            //         if (seq[0] == '<' && insertion_fasta != NULL){
-            //             //pliib::strip(seq, '<');
-            //             //pliib::strip(seq, '>');
-            //             if (insert_tf->hasSeqID(seq.c_str())){
-            //                 char* ins_seq;
-            //                 TFA::getSequence(*insert_tf, seq.c_str(), ins_seq);
-            //             }
-            //         }
-            //         else if (pliib::canonical(seq)){
-            //             // Don't do anything, as the alt sequence was already valid DNA
-            //         }
-            //         else{
-            //             seq = "N";
-            //             continue;
-            //         }
-
-                    //string insert_id = "INS_" + to_string(bvar->pos) + "_" + std::to_string(0);
-                    //ins_node.sequence.assign(seq);
-                    //ins_node.id = ++current_id;
-                    //insertion_id_to_node_id[insert_id] = ins_node.id;
-                    //set_gfa_node_values(ins_node);
-
-                    //gg.write_element(os, ins_node);
-                    //os << std::endl;
-
-                    // gfak::edge_elem e;
-                    // set_gfa_edge_defaults(e, ++base_edge_id);
-                    // e.source_name = std::to_string(s.id);
-                    // e.sink_name = std::to_string(ins_node.id);
-                    // ins_offset = max(ins_offset, (int) seq.length());
-
-                    // gg.write_element(os, e);
-                    // os << std::endl;
-
-               //}
+                // Each insertion branches from this node and joins the next.
+                for (auto& seq : ins_seqs){
+                    gfak::sequence_elem ins_node;
+                    ins_node.sequence.swap(seq);
+                    ins_node.id = ++current_id;
+                    set_gfa_node_values(ins_node);
+                    dummy_node inn;
+                    inn.id = ins_node.id;
+                    inn.length = ins_node.length;
+                    new_insertions.push_back(inn);
+
+                    cw.add(ins_node);
+
+                    gfak::edge_elem e;
+                    set_gfa_edge_defaults(e, ++base_edge_id);
+                    e.source_name = std::to_string(s.id);
+                    e.sink_name = std::to_string(ins_node.id);
+                    e.source_begin = s.length;
+                    e.source_end = s.length;
+                    cw.add(e);
+
+                    for (auto alt = bypass_alts.rbegin(); alt != bypass_alts.rend(); ++alt){
+                        gfak::edge_elem ae;
+                        set_gfa_edge_defaults(ae, ++base_edge_id);
+                        ae.source_name = std::to_string(alt->id);
+                        ae.sink_name = std::to_string(ins_node.id);
+                        ae.source_begin = alt->length;
+                        ae.source_end = alt->length;
+                        cw.add(ae);
+                    }
+                }
             }
             else{
                 continue;
@@ -591,56 +643,33 @@ void construct_contig_graph(std::string contig_name,
         }
     }
         // update current_pos here??
-        current_pos = breakpoints[i];
+        current_pos = bp;
     }
 
-    std::cerr << "Processing tail edges" << std::endl;
-
-    for (auto vvar : variants){
-        if (vvar->info.find("SVTYPE") != vvar->info.end()){
+    for (const gfak::vcf_variant& var : cv.variants){
+        const gfak::vcf_variant* vvar = &var;
+        if (vvar->svtype != gfak::SV_NONE){
             
-            if (vvar->info.at("SVTYPE") == "DEL"){
+            if (vvar->svtype == gfak::SV_DEL){
                 gfak::edge_elem e_from;
                 set_gfa_edge_defaults(e_from, ++base_edge_id);
                 e_from.source_name = std::to_string(bp_to_node_id.at( vvar->pos - 1 - 1));
-                e_from.sink_name = std::to_string(bp_to_node_id.at(vvar->pos -1 + stoi(vvar->info.at("SVLEN"))));
+                e_from.sink_name = std::to_string(bp_to_node_id.at(vvar->pos -1 + vvar->svlen));
                 e_from.source_begin = node_id_to_length.at(bp_to_node_id.at( vvar->pos - 1 - 1));
                 e_from.source_end = node_id_to_length.at(bp_to_node_id.at( vvar->pos - 1 - 1));
 
-                gg.write_element(os, e_from);
-                os << std::endl;
+                cw.add(e_from);
             }
-            else if (vvar->info.at("SVTYPE") == "INS"){
-                gfak::edge_elem e_to;
-                set_gfa_edge_defaults(e_to, ++base_edge_id);
-                std::string ins_id;
-                int altp = 0;
-                //for (int altp = 0; altp < vvar->alts.size(); ++altp){
-                ins_id = "INS_" + vvar->seq + "_"  + std::to_string(vvar->pos) + "_" + std::to_string(altp);
-                //}
-                std::cerr << ins_id << std::endl;
-
-                e_to.source_name = std::to_string(bp_to_node_id.at(vvar->pos - 1));
-                e_to.source_begin = node_id_to_length.at(bp_to_node_id.at( vvar->pos - 1));
-                e_to.source_end = node_id_to_length.at(bp_to_node_id.at( vvar->pos - 1));
-                e_to.sink_name = std::to_string(insertion_id_to_node_id.at(ins_id));
-                
-                // TODO double check this bit above, as it might be funky.
-
-                gg.write_element(os, e_to);
-                os << std::endl;
-            }
-            else if (vvar->info.at("SVTYPE") == "DUP"){
+            else if (vvar->svtype == gfak::SV_DUP){
                 gfak::edge_elem e_cycle;
                 set_gfa_edge_defaults(e_cycle, ++base_edge_id);
-                e_cycle.source_name = std::to_string(bp_to_node_id.at(vvar->pos - 1 - 1 + stoi(vvar->info.at("SVLEN"))));
+                e_cycle.source_name = std::to_string(bp_to_node_id.at(vvar->pos - 1 - 1 + vvar->svlen));
                 e_cycle.sink_name = std::to_string(bp_to_node_id.at(vvar->pos - 1));
                 e_cycle.source_begin = node_id_to_length.at(bp_to_node_id.at(vvar->pos - 1));
                 e_cycle.source_end = node_id_to_length.at(bp_to_node_id.at(vvar->pos - 1));
-                gg.write_element(os, e_cycle);
-                os << std::endl;
+                cw.add(e_cycle);
             }
-            else if (vvar->info.at("SVTYPE") == "INV"){
+            else if (vvar->svtype == gfak::SV_INV){
                 gfak::edge_elem e_from;
                 gfak::edge_elem e_to;
 
@@ -648,49 +677,71 @@ void construct_contig_graph(std::string contig_name,
                 set_gfa_edge_defaults(e_to, ++base_edge_id);
                 
                 e_from.source_name = std::to_string(bp_to_node_id[vvar->pos - 1 - 1]);
-                e_from.sink_name = std::to_string(bp_to_node_id[vvar->pos -1 + stoi(vvar->info.at("SVLEN")) - 1]);
+                e_from.sink_name = std::to_string(bp_to_node_id[vvar->pos -1 + vvar->svlen - 1]);
                 e_from.source_orientation_forward = true;
                 e_from.sink_orientation_forward = false;
                 e_from.source_begin = node_id_to_length.at(bp_to_node_id.at(vvar->pos - 1 - 1));
                 
                 e_to.source_name = std::to_string(bp_to_node_id[vvar->pos - 1]);
-                e_to.sink_name = std::to_string(bp_to_node_id[ vvar->pos - 1 + stoi(vvar->info.at("SVLEN"))]);
+                e_to.sink_name = std::to_string(bp_to_node_id[ vvar->pos - 1 + vvar->svlen]);
                 e_to.source_orientation_forward = false;
                 e_to.sink_orientation_forward = true;
                 // Set node begin / ends
 
-                gg.write_element(os, e_from);
-                os << std::endl;
-                gg.write_element(os, e_to);
-                os << std::endl;
+                cw.add(e_from);
+                cw.add(e_to);
             }
-            else if (vvar->info.at("SVTYPE") == "TRA"){
+            else if (vvar->svtype == gfak::SV_TRA){
 
             }
-            else if (vvar->info.at("SVTYPE") == "BND"){
+            else if (vvar->svtype == gfak::SV_BND){
                 
             }
         }
         else{
             // SNV / indels
         }
-        delete vvar;
     }
 
-    for (auto p : path_to_nodes){
-        os << "O" << '\t' << p.first << '\t';
-        std::vector<int> zs (p.second.begin(), p.second.end());
-        std::vector<std::string> z_to_str(zs.size());
-        for (int i = 0; i < zs.size(); ++i){
-            z_to_str[i] = std::to_string(zs[i]) + "+";
+    cw.name = contig_name;
+    cw.node_count = current_id;
+    cw.edge_count = base_edge_id;
+    cw.finish();
+
+    if (with_haplotypes){
+        // Each haplotype follows the reference path, taking the ALT node
+        // (or skipping the deleted nodes) of each non-reference allele it
+        // carries. Alleles that overlap an earlier one are left out.
+        cv.haplotypes->for_each_haplotype([&](std::size_t h, const std::vector<gfak::haplotype_allele>& alleles){
+                cw.begin_path(cv.haplotypes->haplotype_name(h, contig_name));
+                int rank = 0;
+                for (auto& a : alleles){
+                    const allele_span& sp = spans[a.variant];
+                    const gfak::vcf_variant& v = cv.variants[a.variant];
+                    if (sp.front < rank || sp.back < sp.front){
+                        continue;
+                    }
+                    if (v.svtype == gfak::SV_NONE && (sp.alt < 0 || a.allele > cv.alt_count(v))){
+                        continue;
+                    }
+                    if (v.svtype == gfak::SV_DEL && a.allele != 1){
+                        continue;
+                    }
+                    cw.reference_steps(rank, sp.front);
+                    if (v.svtype == gfak::SV_NONE){
+                        cw.step(sp.alt + a.allele - 1);
+                    }
+                    rank = sp.back;
+                }
+                cw.reference_steps(rank, cw.path_length);
+                cw.end_path();
+                });
+        if (cv.haplotypes->unphased_count() > 0){
+            std::cerr << "Warning: " << cv.haplotypes->unphased_count() << " unphased heterozygous genotypes on " <<
+                contig_name << " were read as reference." << std::endl;
         }
-        std::string zstring = pliib::join(z_to_str, ' ');
-        os << zstring << std::endl;
     }
 
-    for (auto cc : contig_nodes){
-        delete cc;
-    }
     // for (auto vv : variants){
     //     delete vv;
     // }
@@ -698,76 +749,214 @@ void construct_contig_graph(std::string contig_name,
 
 };
 
-void construct_gfa(char* fasta_file, char* vcf_file, char* insertion_fasta, gfak::GFAKluge gg, int max_node_length = 128){
-
-    
-    std::map<std::string, std::vector<VCF_Variant*>> contig_to_variants;
-    std::map<std::string, std::map<int, std::vector<VCF_Variant*>>> contig_to_breakpoints_to_variants;
-    std::vector<VCF_Variant*> insertions;
-    std::map<std::string, std::vector<int>> contig_to_breakpoints;
-    // Read in vcf file and transform to variants
-
-    make_contig_to_breakpoints(fasta_file, vcf_file, 
-                        contig_to_variants,
-                        contig_to_breakpoints_to_variants,
-                        contig_to_breakpoints,
-                        insertions, max_node_length);
-
-    std::cerr << contig_to_variants.size() << " contigs to process" << std::endl;
+/**
+ * Build one contig (or region) through cw: find its variant breakpoints,
+ * then construct and write it, reading its sequence <window_size> bases
+ * at a time from fa starting at contig_begin.
+ */
+inline void build_contig(const gfak::contig_variants& cv, const gfak::mapped_fasta& fa,
+        const gfak::fasta_record& r, std::uint64_t contig_begin, uint32_t seq_len,
+        int max_node_length, std::uint64_t window_size, char* insertion_fasta, contig_writer& cw){
+    std::vector<int> bps;
+    std::map<int, std::vector<std::size_t>> bp_to_var;
+    make_breakpoints(cv, seq_len, bps, bp_to_var);
+    sequence_window window(fa, r, contig_begin);
+    window.window_size = window_size;
+    construct_contig_graph(cv, window, seq_len, bps, bp_to_var,
+            max_node_length, insertion_fasta, cw);
+}
 
+/**
+ * Build a variation graph from a FASTA reference and a VCF and write it to stdout.
+ * The VCF is read one contig at a time, and each contig is streamed out
+ * one window of <window_size> bases at a time, so memory use is bounded by
+ * the window size and the variants of the contigs being built rather than
+ * by the length of the genome.
+ * Contigs are constructed in parallel, <threads> at a time. The node and
+ * edge IDs of a batch are counted first and assigned by a prefix sum over
+ * the per-contig counts, so they are the same for any number of threads;
+ * each contig is then written to its own temporary file and the files are
+ * copied to stdout in contig order.
+ * With haplotype_paths, each contig's reference path is followed by a path
+ * for each haplotype of each sample with phased genotypes (GT), named
+ * sample#haplotype#contig. The non-reference alleles are spooled to disk
+ * while the VCF is read and written out a group of haplotypes at a time.
+ */
+void construct_gfa(char* fasta_file, char* vcf_file, char* insertion_fasta, gfak::GFAKluge gg,
+        int max_node_length = 128, int threads = 1, std::uint64_t window_size = 1 << 20,
+        bool haplotype_paths = false){
 
-    // For each contig, get the relevant sequence from 
-    // the FASTA file
-    TFA::tiny_faidx_t tf;
-    if (TFA::checkFAIndexFileExists(fasta_file)){
-        TFA::parseFAIndex(fasta_file, tf);
-    }
-    else{
-        TFA::createFAIndex(fasta_file, tf);
-        TFA::writeFAIndex(fasta_file, tf);
+    const gfak::mapped_fasta* fap = gfak::open_fasta(fasta_file);
+    if (fap == nullptr){
+        std::cerr << "ERROR [gfak build] : could not open FASTA file " << fasta_file << std::endl;
+        exit(9);
     }
+    const gfak::mapped_fasta& fa = *fap;
 
+    int nthreads = threads > 1 ? threads : 1;
     int base_seq_id = 0;
     int base_edge_id = 0;
+    std::vector<gfak::contig_variants> batch;
     
-    std:: cout << gg.header_string();
-    for (auto contig : contig_to_variants){
-        std::cerr << "Processing contig: " << contig.first  << " with " <<
-        contig.second.size() << " variants." << std::endl;
-        if (tf.hasSeqID(contig.first.c_str())){
-            
-            char* seq;
-            uint32_t len = 0;
-            TFA::getSequence(tf, contig.first.c_str(), seq);
-            TFA::getSequenceLength(tf, contig.first.c_str(), len);
-
-            std::vector<VCF_Variant*> vars = contig.second;
-            std::vector<int> bps = contig_to_breakpoints.at(contig.first);
-            std::map<int, std::vector<VCF_Variant*>> bp_to_var = contig_to_breakpoints_to_variants.at(contig.first);
-            construct_contig_graph(contig.first, seq, len, bps,
-                    bp_to_var, vars, insertion_fasta,
-                    gg, std::cout,
-                    base_seq_id, base_edge_id);
-            delete [] seq;
-            std::vector<VCF_Variant*>().swap(vars);
-
+    auto build_batch = [&](){
+        std::size_t batch_size = batch.size();
+        if (batch_size == 1){
+            const gfak::fasta_record* r = fa.find(batch[0].name);
+            contig_writer cw(gg, std::cout, base_seq_id, base_edge_id);
+            build_contig(batch[0], fa, *r, 0, r->length, max_node_length, window_size, insertion_fasta, cw);
+            base_seq_id += cw.node_count;
+            base_edge_id += cw.edge_count;
         }
+        else if (batch_size > 1){
+            // Count the IDs of each contig, then prefix sum the counts.
+            std::vector<contig_writer> counts(batch_size);
+            #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (std::size_t i = 0; i < batch_size; ++i){
+                const gfak::fasta_record* r = fa.find(batch[i].name);
+                build_contig(batch[i], fa, *r, 0, r->length, max_node_length, window_size, insertion_fasta, counts[i]);
+            }
+            std::vector<int> node_offsets(batch_size);
+            std::vector<int> edge_offsets(batch_size);
+            for (std::size_t i = 0; i < batch_size; ++i){
+                node_offsets[i] = base_seq_id;
+                edge_offsets[i] = base_edge_id;
+                base_seq_id += counts[i].node_count;
+                base_edge_id += counts[i].edge_count;
+            }
+            std::vector<std::string> tmp_files(batch_size);
+            for (auto& t : tmp_files){
+                t = gfak::make_temp_file();
+            }
+            #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (std::size_t i = 0; i < batch_size; ++i){
+                const gfak::fasta_record* r = fa.find(batch[i].name);
+                std::ofstream ofi(tmp_files[i].c_str());
+                contig_writer cw(gg, ofi, node_offsets[i], edge_offsets[i]);
+                build_contig(batch[i], fa, *r, 0, r->length, max_node_length, window_size, insertion_fasta, cw);
+            }
+            for (auto& t : tmp_files){
+                std::ifstream ifi(t.c_str());
+                if (ifi.peek() != std::ifstream::traits_type::eof()){
+                    std::cout << ifi.rdbuf();
+                }
+                std::remove(t.c_str());
+            }
+        }
+        batch.clear();
+    };
+
+    std::cout << gg.header_string();
+    bool ok = gfak::for_each_vcf_contig(vcf_file, [&](gfak::contig_variants& cv){
+            const gfak::fasta_record* r = fa.find(cv.name);
+            if (r == nullptr){
+                std::cerr << "Contig " << cv.name << " is not in " << fasta_file << "; skipping it." << std::endl;
+                return;
+            }
+            if (!fa.in_file(*r)){
+                std::cerr << "Contig " << cv.name << " does not match the index of " << fasta_file << "; skipping it." << std::endl;
+                return;
+            }
+            std::cerr << "Processing contig: " << cv.name << " with " <<
+                cv.variants.size() << " variants." << std::endl;
+            batch.push_back(gfak::contig_variants());
+            std::swap(batch.back(), cv);
+            if ((int) batch.size() == nthreads){
+                build_batch();
+            }
+            }, haplotype_paths);
+    build_batch();
+    std::cout.flush();
+    if (!ok){
+        std::cerr << "ERROR [gfak build] : could not read VCF file " << vcf_file << std::endl;
+        exit(9);
     }
-    
 
+};
 
-    /* void construct_contig_graph(string contig_name,
-        char* contig_seq,
-        uint32_t seq_len,
-        std::vector<int>& breakpoints,
-        std::map<int, std::vector<VCF_Variant*>>& bp_to_variants,
-        std::vector<VCF_Variant*> variants,
-        char* insertion_fasta,
-        gg,
-        cout); **/
+/**
+ * Build the graph of a single region of the reference, given as
+ * chr, chr:start or chr:start-end (1-based, inclusive). Only the
+ * VCF records in the region are read (through the VCF's index; see read_vcf_region)
+ * and only the region's slice of the FASTA is read, so a small region
+ * is quick to build from a whole-genome VCF.
+ * Variants that run past the end of the region are left out. The
+ * contig path is named after the region.
+ */
+void construct_region_gfa(char* fasta_file, char* vcf_file, char* insertion_fasta, gfak::GFAKluge gg,
+        const std::string& region_string, int max_node_length = 128, std::uint64_t window_size = 1 << 20){
 
+    gfak::vcf_region region;
+    if (!gfak::parse_region(region_string, region)){
+        std::cerr << "ERROR [gfak build] : invalid region " << region_string << std::endl;
+        exit(1);
+    }
+
+    const gfak::mapped_fasta* fap = gfak::open_fasta(fasta_file);
+    if (fap == nullptr){
+        std::cerr << "ERROR [gfak build] : could not open FASTA file " << fasta_file << std::endl;
+        exit(9);
+    }
+    const gfak::mapped_fasta& fa = *fap;
+    const gfak::fasta_record* r = fa.find(region.contig);
+    if (r == nullptr){
+        std::cerr << "ERROR [gfak build] : contig " << region.contig << " is not in " << fasta_file << std::endl;
+        exit(1);
+    }
+    if (region.end == 0 || (std::uint64_t) region.end > r->length){
+        region.end = r->length;
+    }
+    if (region.start > region.end || !fa.in_file(*r)){
+        std::cerr << "ERROR [gfak build] : region " << region_string << " is not on contig " << region.contig << std::endl;
+        exit(1);
+    }
+    uint32_t seq_len = region.end - region.start + 1;
 
+    gfak::contig_variants cv;
+    if (!gfak::read_vcf_region(vcf_file, region, cv)){
+        std::cerr << "ERROR [gfak build] : could not read VCF file " << vcf_file << std::endl;
+        exit(9);
+    }
+    cv.name = region.contig + ":" + std::to_string(region.start) + "-" + std::to_string(region.end);
+
+    // Move the variants into the coordinates of the slice. A variant at the
+    // first base has no breakpoint in front of it to branch from, and
+    // make_breakpoints would drop it, so leave it out (and count it) here.
+    std::size_t dropped = 0;
+    std::size_t dropped_front = 0;
+    std::vector<gfak::vcf_variant> kept;
+    for (auto& v : cv.variants){
+        v.pos -= region.start - 1;
+        int back = v.pos - 1;
+        if (v.svtype == gfak::SV_NONE){
+            back += v.ref_length;
+        }
+        else if (v.svtype == gfak::SV_DEL || v.svtype == gfak::SV_DUP || v.svtype == gfak::SV_INV){
+            back += v.svlen;
+        }
+        if (back > (int) seq_len){
+            ++dropped;
+            continue;
+        }
+        if (v.pos <= 1){
+            ++dropped_front;
+            continue;
+        }
+        kept.push_back(v);
+    }
+    cv.variants.swap(kept);
+    if (dropped > 0){
+        std::cerr << "Skipped " << dropped << " variants that run past the end of " << cv.name << "." << std::endl;
+    }
+    if (dropped_front > 0){
+        std::cerr << "Skipped " << dropped_front << " variants at the first base of " << cv.name << "." << std::endl;
+    }
+    std::cerr << "Processing region: " << cv.name << " with " <<
+        cv.variants.size() << " variants." << std::endl;
 
+    std::cout << gg.header_string();
+    contig_writer cw(gg, std::cout, 0, 0);
+    build_contig(cv, fa, *r, region.start - 1, seq_len, max_node_length, window_size, insertion_fasta, cw);
+    std::cout.flush();
 };
 
 #endif
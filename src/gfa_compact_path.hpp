@@ -0,0 +1,238 @@
+#ifndef GFA_COMPACT_PATH_HPP
+#define GFA_COMPACT_PATH_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+namespace gfak{
+
+    /** LEB128-style unsigned varints and zigzag encoding for signed deltas. **/
+    inline void write_varint(std::vector<std::uint8_t>& buf, std::uint64_t v){
+        while (v >= 0x80){
+            buf.push_back((std::uint8_t) (v | 0x80));
+            v >>= 7;
+        }
+        buf.push_back((std::uint8_t) v);
+    }
+    inline std::uint64_t read_varint(const std::uint8_t*& p){
+        std::uint64_t v = 0;
+        int shift = 0;
+        while (*p & 0x80){
+            v |= (std::uint64_t) (*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        v |= (std::uint64_t) (*p++) << shift;
+        return v;
+    }
+    inline std::uint64_t zigzag_encode(const std::int64_t& v){
+        return ((std::uint64_t) v << 1) ^ (std::uint64_t) (v >> 63);
+    }
+    inline std::int64_t zigzag_decode(const std::uint64_t& v){
+        return (std::int64_t) (v >> 1) ^ -((std::int64_t) (v & 1));
+    }
+
+    /**
+     *  Handles name an oriented segment by its rank in a segment_dictionary:
+     *  rank << 1 | is_reverse.
+     */
+    inline std::uint64_t make_handle(const std::uint64_t& rank, const bool& forward){
+        return (rank << 1) | (forward ? 0 : 1);
+    }
+    inline std::uint64_t handle_rank(const std::uint64_t& handle){
+        return handle >> 1;
+    }
+    inline bool handle_is_forward(const std::uint64_t& handle){
+        return !(handle & 1);
+    }
+
+    /**
+     *  The segment names that the handles of a set of compact_paths refer to.
+     *  Names are only ever added, so handles stay valid.
+     */
+    class segment_dictionary{
+        private:
+            std::vector<std::string> names;
+            std::unordered_map<std::string, std::uint64_t> ranks;
+
+        public:
+            /** The rank of name, which is added if it's new. **/
+            inline std::uint64_t rank(const std::string& name){
+                auto r = ranks.find(name);
+                if (r != ranks.end()){
+                    return r->second;
+                }
+                std::uint64_t n = names.size();
+                ranks.emplace(name, n);
+                names.push_back(name);
+                return n;
+            }
+            inline const std::string& name(const std::uint64_t& rank) const{
+                return names[rank];
+            }
+            inline std::size_t size() const{
+                return names.size();
+            }
+
+            /** Rename every entry in place with func(std::string&), keeping ranks. **/
+            template<typename Func>
+            inline void rename(const Func& func){
+                ranks.clear();
+                for (std::size_t i = 0; i < names.size(); ++i){
+                    func(names[i]);
+                    ranks.emplace(names[i], i);
+                }
+            }
+
+            /** Approximate heap footprint in bytes. **/
+            inline std::size_t memory_bytes() const{
+                std::size_t b = names.capacity() * sizeof(std::string) +
+                    ranks.size() * (sizeof(std::string) + sizeof(std::uint64_t) + 2 * sizeof(void*));
+                for (auto& n : names){
+                    b += n.capacity() > 15 ? 2 * (n.capacity() + 1) : 0;
+                }
+                return b;
+            }
+    };
+
+    /**
+     *  The steps and overlaps of a path stored as a byte string of encoded handles.
+     *
+     *  Steps are stored as zigzagged deltas from the previous handle, and consecutive
+     *  identical deltas are collapsed into runs. Each token is a varint of
+     *  (delta << 1 | has_run), followed by a varint holding (run length - 2) when has_run
+     *  is set. A path walking forward along segments with consecutive ranks collapses
+     *  to a few bytes.
+     *
+     *  Overlaps are stored once when every step has the same overlap
+     *  (usually "*" or "0M"), and per step otherwise.
+     */
+    struct compact_path{
+        std::string name;
+        std::uint64_t step_count = 0;
+        std::vector<std::uint8_t> steps;
+        // GFA1 paths may carry one overlap per step or one per junction,
+        // so the count is kept alongside the uniform value.
+        bool uniform_overlap = true;
+        std::uint64_t overlap_count = 0;
+        std::string overlap = "*";
+        std::vector<std::string> overlaps;
+
+        /** Decodes handles on the fly. **/
+        class const_iterator{
+            private:
+                const std::uint8_t* pos = nullptr;
+                std::uint64_t handle = 0;
+                std::int64_t delta = 0;
+                std::uint64_t run_left = 0;
+                std::uint64_t remaining = 0;
+
+                inline void advance(){
+                    if (remaining == 0 || --remaining == 0){
+                        return;
+                    }
+                    if (run_left == 0){
+                        std::uint64_t token = read_varint(pos);
+                        delta = zigzag_decode(token >> 1);
+                        run_left = (token & 1) ? read_varint(pos) + 1 : 0;
+                    }
+                    else{
+                        --run_left;
+                    }
+                    handle += delta;
+                }
+            public:
+                const_iterator(){
+
+                }
+                const_iterator(const std::uint8_t* p, const std::uint64_t& count) : pos(p), remaining(count + 1){
+                    advance();
+                }
+                inline std::uint64_t operator*() const{
+                    return handle;
+                }
+                inline const_iterator& operator++(){
+                    advance();
+                    return *this;
+                }
+                inline bool operator==(const const_iterator& other) const{
+                    return remaining == other.remaining;
+                }
+                inline bool operator!=(const const_iterator& other) const{
+                    return remaining != other.remaining;
+                }
+        };
+
+        inline const_iterator begin() const{
+            return steps.empty() ? end() : const_iterator(steps.data(), step_count);
+        }
+        inline const_iterator end() const{
+            return const_iterator();
+        }
+
+        /** Encode a sequence of handles, replacing any existing steps. **/
+        inline void encode(const std::vector<std::uint64_t>& handles){
+            steps.clear();
+            step_count = handles.size();
+            std::uint64_t prev = 0;
+            std::size_t i = 0;
+            while (i < handles.size()){
+                std::int64_t d = (std::int64_t) (handles[i] - prev);
+                std::size_t j = i + 1;
+                while (j < handles.size() && (std::int64_t) (handles[j] - handles[j - 1]) == d){
+                    ++j;
+                }
+                std::uint64_t run = j - i;
+                write_varint(steps, (zigzag_encode(d) << 1) | (run > 1 ? 1 : 0));
+                if (run > 1){
+                    write_varint(steps, run - 2);
+                }
+                prev = handles[j - 1];
+                i = j;
+            }
+            steps.shrink_to_fit();
+        }
+
+        /** Store ovs, once if they are all the same. **/
+        inline void set_overlaps(const std::vector<std::string>& ovs){
+            uniform_overlap = true;
+            overlap_count = ovs.size();
+            overlap = ovs.empty() ? "*" : ovs[0];
+            overlaps.clear();
+            for (auto& o : ovs){
+                if (o != overlap){
+                    uniform_overlap = false;
+                    break;
+                }
+            }
+            if (!uniform_overlap){
+                overlaps = ovs;
+                overlap.clear();
+            }
+        }
+        inline void get_overlaps(std::vector<std::string>& ovs) const{
+            if (uniform_overlap){
+                ovs.assign(overlap_count, overlap);
+            }
+            else{
+                ovs = overlaps;
+            }
+        }
+        inline const std::string& overlap_at(const std::uint64_t& i) const{
+            return uniform_overlap ? overlap : overlaps[i];
+        }
+
+        /** Approximate heap + inline footprint in bytes. **/
+        inline std::size_t memory_bytes() const{
+            std::size_t b = sizeof(compact_path) + steps.capacity();
+            for (auto& o : overlaps){
+                b += sizeof(std::string) + (o.capacity() > 15 ? o.capacity() + 1 : 0);
+            }
+            return b;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef GFA_DIFF_HPP
+#define GFA_DIFF_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "gfa_stream.hpp"
+#include "gfa_hash.hpp"
+
+namespace gfak{
+
+    /**
+     *  Read the element_hash of every record of a GFA file in a single
+     *  streaming pass, on up to <threads> threads. Memory use is 24 bytes per
+     *  element however long its sequence. Returns false if the file can't be read.
+     */
+    inline bool hash_file_elements(const std::string& filename, std::vector<element_hash>& out, int threads = 1){
+        int nthreads = threads > 1 ? threads : 1;
+        std::vector<std::vector<element_hash>> chunks(nthreads);
+        int n = for_each_line_in_file(filename, nthreads, [&](const char* line, std::size_t len, int chunk){
+                element_hash e;
+                if (hash_record(line, len, e)){
+                    chunks[chunk].push_back(e);
+                }
+                });
+        if (n == 0){
+            return false;
+        }
+        for (auto& c : chunks){
+            out.insert(out.end(), c.begin(), c.end());
+            std::vector<element_hash>().swap(c);
+        }
+        return true;
+    }
+
+    /**
+     *  The difference between two graphs, element by element. An element
+     *  (identified by its key: a segment or path name, or the segment ends an
+     *  edge joins) is removed if only the first graph has it, added if only the
+     *  second does and changed if both do but its content differs.
+     */
+    struct graph_diff{
+        // Counts per element kind, indexed by element_kind_index().
+        std::vector<std::uint64_t> added = std::vector<std::uint64_t>(9, 0);
+        std::vector<std::uint64_t> removed = std::vector<std::uint64_t>(9, 0);
+        std::vector<std::uint64_t> changed = std::vector<std::uint64_t>(9, 0);
+        // Sorted keys of the elements in each class.
+        std::vector<std::uint64_t> added_keys;
+        std::vector<std::uint64_t> removed_keys;
+        std::vector<std::uint64_t> changed_keys;
+
+        inline bool identical() const{
+            return added_keys.empty() && removed_keys.empty() && changed_keys.empty();
+        }
+    };
+
+    /**
+     *  Compare two sets of element hashes (both are reordered). The elements
+     *  are partitioned by key into buckets that are sorted and merge-joined
+     *  in parallel.
+     */
+    inline graph_diff diff_elements(std::vector<element_hash>& a, std::vector<element_hash>& b, int threads = 1){
+        const int bucket_bits = 8;
+        const std::size_t buckets = (std::size_t) 1 << bucket_bits;
+        auto bucket_of = [&](const element_hash& e){
+            return (std::size_t) (e.key >> (64 - bucket_bits));
+        };
+        // Counting-sort both vectors by bucket.
+        std::vector<element_hash>* sides[2] = {&a, &b};
+        std::vector<std::size_t> starts[2];
+        for (int s = 0; s < 2; ++s){
+            std::vector<element_hash>& v = *sides[s];
+            std::vector<std::size_t>& st = starts[s];
+            st.assign(buckets + 1, 0);
+            for (auto& e : v){
+                ++st[bucket_of(e) + 1];
+            }
+            for (std::size_t i = 1; i <= buckets; ++i){
+                st[i] += st[i - 1];
+            }
+            std::vector<std::size_t> fill(st.begin(), st.end() - 1);
+            std::vector<element_hash> sorted(v.size());
+            for (auto& e : v){
+                sorted[fill[bucket_of(e)]++] = e;
+            }
+            v.swap(sorted);
+        }
+
+        int nthreads = threads > 1 ? threads : 1;
+        std::vector<graph_diff> partial(buckets);
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (std::size_t k = 0; k < buckets; ++k){
+            element_hash* ab = a.data() + starts[0][k];
+            element_hash* ae = a.data() + starts[0][k + 1];
+            element_hash* bb = b.data() + starts[1][k];
+            element_hash* be = b.data() + starts[1][k + 1];
+            std::sort(ab, ae);
+            std::sort(bb, be);
+            graph_diff& d = partial[k];
+            while (ab < ae || bb < be){
+                if (bb == be || (ab < ae && ab->key < bb->key)){
+                    ++d.removed[element_kind_index(ab->kind)];
+                    d.removed_keys.push_back(ab->key);
+                    std::uint64_t key = ab->key;
+                    while (ab < ae && ab->key == key){
+                        ++ab;
+                    }
+                }
+                else if (ab == ae || bb->key < ab->key){
+                    ++d.added[element_kind_index(bb->kind)];
+                    d.added_keys.push_back(bb->key);
+                    std::uint64_t key = bb->key;
+                    while (bb < be && bb->key == key){
+                        ++bb;
+                    }
+                }
+                else{
+                    // Same key: compare the (sorted) contents of every element with it.
+                    std::uint64_t key = ab->key;
+                    char kind = ab->kind;
+                    bool same = true;
+                    while (ab < ae && ab->key == key && bb < be && bb->key == key){
+                        same = same && ab->content == bb->content;
+                        ++ab;
+                        ++bb;
+                    }
+                    if ((ab < ae && ab->key == key) || (bb < be && bb->key == key)){
+                        same = false;
+                    }
+                    while (ab < ae && ab->key == key){
+                        ++ab;
+                    }
+                    while (bb < be && bb->key == key){
+                        ++bb;
+                    }
+                    if (!same){
+                        ++d.changed[element_kind_index(kind)];
+                        d.changed_keys.push_back(key);
+                    }
+                }
+            }
+        }
+
+        graph_diff ret;
+        for (auto& d : partial){
+            for (std::size_t i = 0; i < ret.added.size(); ++i){
+                ret.added[i] += d.added[i];
+                ret.removed[i] += d.removed[i];
+                ret.changed[i] += d.changed[i];
+            }
+            // Buckets are in key order, so the concatenated keys stay sorted.
+            ret.added_keys.insert(ret.added_keys.end(), d.added_keys.begin(), d.added_keys.end());
+            ret.removed_keys.insert(ret.removed_keys.end(), d.removed_keys.begin(), d.removed_keys.end());
+            ret.changed_keys.insert(ret.changed_keys.end(), d.changed_keys.begin(), d.changed_keys.end());
+        }
+        return ret;
+    }
+
+    /**
+     *  Re-read a GFA file and write "<mark>\t<label>" for each element whose
+     *  key is in one of the sorted key lists, using the mark given for that
+     *  list. Lines are written in file order. The file must be a regular file
+     *  (see is_mappable_file), since it has already been read once to hash it.
+     */
+    inline bool write_diff_elements(std::ostream& os, const std::string& filename, int threads,
+            const std::vector<const std::vector<std::uint64_t>*>& keys, const std::vector<char>& marks){
+        int nthreads = threads > 1 ? threads : 1;
+        std::vector<std::string> out(nthreads);
+        int n = for_each_line_in_file(filename, nthreads, [&](const char* line, std::size_t len, int chunk){
+                element_hash e;
+                if (!hash_record(line, len, e)){
+                    return;
+                }
+                for (std::size_t i = 0; i < keys.size(); ++i){
+                    if (std::binary_search(keys[i]->begin(), keys[i]->end(), e.key)){
+                        std::string label;
+                        hash_record(line, len, e, &label);
+                        out[chunk].push_back(marks[i]);
+                        out[chunk].push_back('\t');
+                        out[chunk].append(label);
+                        out[chunk].push_back('\n');
+                        break;
+                    }
+                }
+                });
+        for (int i = 0; i < n; ++i){
+            os << out[i];
+        }
+        return n > 0;
+    }
+
+}
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef GFA_FASTA_HPP
+#define GFA_FASTA_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "gfa_kernels.hpp"
+#include "gfa_stream.hpp"
+
+namespace gfak{
+
+    /** One line of a FASTA index (.fai). **/
+    struct fasta_record{
+        std::string name;
+        std::uint64_t length = 0;
+        // File offset of the first base.
+        std::uint64_t offset = 0;
+        // Bases per line, and bytes per line including the line break.
+        std::uint64_t line_bases = 0;
+        std::uint64_t line_width = 0;
+
+        /** Number of bytes the sequence spans in the file, line breaks included. **/
+        inline std::uint64_t span() const{
+            if (length == 0 || line_bases == 0){
+                return 0;
+            }
+            std::uint64_t full_lines = (length - 1) / line_bases;
+            return full_lines * line_width + (length - full_lines * line_bases);
+        }
+    };
+
+    /**
+     *  A FASTA file, memory-mapped, with its samtools-style index. Records are
+     *  copied straight out of the mapping, so any number of threads may read
+     *  from the same mapped_fasta at once.
+     */
+    class mapped_fasta{
+        private:
+            mapped_file mf;
+            std::vector<fasta_record> records;
+            std::unordered_map<std::string, std::size_t> by_name;
+
+            inline bool read_index(const std::string& fai_file){
+                std::ifstream fi(fai_file.c_str());
+                if (!fi.good()){
+                    return false;
+                }
+                std::string line;
+                while (std::getline(fi, line)){
+                    field_view fields[6];
+                    std::size_t n = split_fields(line.c_str(), line.length(), fields, 6);
+                    if (n < 5){
+                        continue;
+                    }
+                    fasta_record r;
+                    r.name = fields[0].str();
+                    r.length = fields[1].to_uint();
+                    r.offset = fields[2].to_uint();
+                    r.line_bases = fields[3].to_uint();
+                    r.line_width = fields[4].to_uint();
+                    add_record(r);
+                }
+                return true;
+            }
+
+            /** Index the mapped file in a single scan. **/
+            inline void build_index(){
+                const char* buf = mf.data();
+                std::size_t fsize = mf.size();
+                std::size_t pos = 0;
+                fasta_record* cur = nullptr;
+                bool last_line = false;
+                while (pos < fsize){
+                    const char* nl = (const char*) std::memchr(buf + pos, '\n', fsize - pos);
+                    std::size_t end = nl == nullptr ? fsize : nl - buf;
+                    std::size_t width = end - pos + (nl != nullptr);
+                    std::size_t bases = end - pos - (end > pos && buf[end - 1] == '\r');
+                    if (buf[pos] == '>'){
+                        fasta_record r;
+                        const char* name_end = buf + pos + 1;
+                        while (name_end < buf + end && !std::isspace((unsigned char) *name_end)){
+                            ++name_end;
+                        }
+                        r.name.assign(buf + pos + 1, name_end);
+                        r.offset = pos + width;
+                        add_record(r);
+                        cur = &records.back();
+                        last_line = false;
+                    }
+                    else if (cur != nullptr && bases > 0){
+                        if (cur->line_bases == 0){
+                            cur->line_bases = bases;
+                            cur->line_width = width;
+                        }
+                        else if (last_line || bases > cur->line_bases){
+                            std::cerr << "Warning: inconsistent line lengths in FASTA record " << cur->name << "." << std::endl;
+                        }
+                        last_line = bases < cur->line_bases;
+                        cur->length += bases;
+                    }
+                    pos += width;
+                }
+            }
+
+            inline void write_index(const std::string& fai_file) const{
+                std::ofstream fo(fai_file.c_str());
+                for (auto& r : records){
+                    fo << r.name << '\t' << r.length << '\t' << r.offset << '\t'
+                        << r.line_bases << '\t' << r.line_width << '\n';
+                }
+            }
+
+            inline void add_record(const fasta_record& r){
+                by_name[r.name] = records.size();
+                records.push_back(r);
+            }
+
+        public:
+            mapped_fasta(){
+
+            }
+            mapped_fasta(const mapped_fasta&) = delete;
+            mapped_fasta& operator=(const mapped_fasta&) = delete;
+
+            /**
+             *  Map fasta_file and read its index (<fasta_file>.fai), creating
+             *  and writing the index first if there isn't one.
+             *  Returns false if the FASTA file cannot be mapped.
+             */
+            inline bool open(const std::string& fasta_file){
+                records.clear();
+                by_name.clear();
+                if (!mf.open(fasta_file)){
+                    return false;
+                }
+                std::string fai_file = fasta_file + ".fai";
+                if (!read_index(fai_file)){
+                    std::cerr << "Creating index for " << fasta_file << "." << std::endl;
+                    build_index();
+                    write_index(fai_file);
+                    std::cerr << "Wrote index to file." << std::endl;
+                }
+                return true;
+            }
+
+            /** The index record for name, or nullptr if the file has no such sequence. **/
+            inline const fasta_record* find(const std::string& name) const{
+                auto r = by_name.find(name);
+                return r == by_name.end() ? nullptr : &records[r->second];
+            }
+
+            inline const std::vector<fasta_record>& get_records() const{
+                return records;
+            }
+
+            /** True if the bytes the index gives for record r are all in the file. **/
+            inline bool in_file(const fasta_record& r) const{
+                return r.offset + r.span() <= mf.size();
+            }
+
+            /**
+             *  Copy the bases of record r to out, dropping line breaks, and return
+             *  the number copied. out must have room for r.span() bytes; if the
+             *  file matches its index, r.length of them are used.
+             */
+            inline std::uint64_t copy_sequence(const fasta_record& r, char* out) const{
+                std::uint64_t span = r.span();
+                if (r.offset >= mf.size()){
+                    return 0;
+                }
+                span = std::min<std::uint64_t>(span, mf.size() - r.offset);
+                return strip_line_breaks(mf.data() + r.offset, span, out);
+            }
+
+            /**
+             *  Fill seq with the sequence of record r. Returns false (and
+             *  leaves seq empty) if the file doesn't match its index.
+             */
+            inline bool get_sequence(const fasta_record& r, std::string& seq) const{
+                seq.resize(r.span());
+                if (copy_sequence(r, &seq[0]) != r.length){
+                    seq.clear();
+                    return false;
+                }
+                seq.resize(r.length);
+                return true;
+            }
+
+            /**
+             *  Point view at <length> bases of record r starting at the 0-based
+             *  position begin, straight in the mapping, without copying.
+             *  Returns false if the bases cross a line break (or run past
+             *  the record or the file), in which case they have to be copied
+             *  with get_sequence.
+             */
+            inline bool view(const fasta_record& r, std::uint64_t begin, std::uint64_t length, field_view& v) const{
+                if (begin + length > r.length || length == 0 || r.line_bases == 0 ||
+                        begin % r.line_bases + length > r.line_bases){
+                    return false;
+                }
+                std::uint64_t start = r.offset + (begin / r.line_bases) * r.line_width + begin % r.line_bases;
+                if (start + length > mf.size()){
+                    return false;
+                }
+                v = field_view(mf.data() + start, length);
+                return true;
+            }
+
+            /**
+             *  Fill seq with <length> bases of record r starting at the 0-based
+             *  position begin (fewer if the record ends first). Returns false (and
+             *  leaves seq empty) if begin is past the end of the record or the file
+             *  doesn't match its index.
+             */
+            inline bool get_sequence(const fasta_record& r, std::uint64_t begin, std::uint64_t length, std::string& seq) const{
+                seq.clear();
+                if (begin >= r.length || length == 0 || r.line_bases == 0){
+                    return false;
+                }
+                length = std::min(length, r.length - begin);
+                std::uint64_t last = begin + length - 1;
+                std::uint64_t start = r.offset + (begin / r.line_bases) * r.line_width + begin % r.line_bases;
+                std::uint64_t end = r.offset + (last / r.line_bases) * r.line_width + last % r.line_bases + 1;
+                if (end > mf.size()){
+                    return false;
+                }
+                seq.resize(end - start);
+                if (strip_line_breaks(mf.data() + start, end - start, &seq[0]) != length){
+                    seq.clear();
+                    return false;
+                }
+                seq.resize(length);
+                return true;
+            }
+    };
+
+
+    /**
+     *  Open fasta_file through a process-wide cache, so each FASTA is mapped
+     *  and indexed once however many times (and from however many threads)
+     *  it is asked for. The handle stays open until the process exits.
+     *  Returns nullptr if the file can't be mapped; the failure isn't cached.
+     */
+    inline const mapped_fasta* open_fasta(const std::string& fasta_file){
+        static std::mutex cache_mutex;
+        static std::unordered_map<std::string, std::unique_ptr<mapped_fasta>> cache;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(fasta_file);
+        if (it != cache.end()){
+            return it->second.get();
+        }
+        std::unique_ptr<mapped_fasta> fa(new mapped_fasta());
+        if (!fa->open(fasta_file)){
+            return nullptr;
+        }
+        const mapped_fasta* ret = fa.get();
+        cache[fasta_file] = std::move(fa);
+        return ret;
+    }
+
+
+    /**
+     *  Copy a GFA file to os, replacing the "*" sequence of each S line that
+     *  names a record of fa with that record's sequence. Every other line is
+     *  written unchanged and the graph is never loaded, so memory use is bounded
+     *  by the FASTA index. Both GFA1 (S <name> <seq>) and GFA2 (S <name> <length> <seq>)
+     *  segments are filled. Returns the number of segments filled, or -1 if
+     *  the GFA file can't be read.
+     */
+    inline std::int64_t stream_fill_sequences(const std::string& gfa_file, const mapped_fasta& fa, std::ostream& os){
+        const std::size_t flush_size = 1 << 22;
+        std::string out;
+        out.reserve(flush_size * 2);
+        std::int64_t filled = 0;
+        int n = for_each_line_in_file(gfa_file, 1, [&](const char* line, std::size_t len, int){
+                const fasta_record* r = nullptr;
+                field_view fields[5];
+                if (len > 1 && line[0] == 'S' && line[1] == '\t'){
+                    std::size_t nf = split_fields(line, len, fields, 5);
+                    std::size_t slot = nf > 2 && fields[2] == "*" ? 2 :
+                        (nf > 3 && fields[2].is_number() && fields[3].length == 1 && fields[3].front() == '*' ? 3 : 0);
+                    if (slot > 0){
+                        r = fa.find(fields[1].str());
+                    }
+                    if (r != nullptr){
+                        std::size_t start = out.length();
+                        out.append(line, fields[slot].data - line);
+                        std::size_t seq_start = out.length();
+                        out.resize(seq_start + r->span());
+                        if (fa.copy_sequence(*r, &out[seq_start]) == r->length){
+                            out.resize(seq_start + r->length);
+                            out.append(fields[slot].data + 1, line + len - fields[slot].data - 1);
+                            out.push_back('\n');
+                            ++filled;
+                        }
+                        else{
+                            std::cerr << "Warning: FASTA record " << r->name << " does not match its index; not filled." << std::endl;
+                            out.resize(start);
+                            r = nullptr;
+                        }
+                    }
+                }
+                if (r == nullptr){
+                    out.append(line, len);
+                    out.push_back('\n');
+                }
+                if (out.length() >= flush_size){
+                    os.write(out.data(), out.length());
+                    out.clear();
+                }
+                });
+        os.write(out.data(), out.length());
+        return n == 0 ? -1 : filled;
+    }
+
+}
+
+#endif
@@ -0,0 +1,464 @@
+#ifndef GFA_HASH_HPP
+#define GFA_HASH_HPP
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <tuple>
+#include <cstdio>
+#include "gfa_stream.hpp"
+
+namespace gfak{
+
+    /** 64-bit finalizer (MurmurHash3 fmix64). **/
+    inline std::uint64_t hash_mix(std::uint64_t x){
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /** Fold v into h; the result depends on the order of the folds. **/
+    inline std::uint64_t hash_combine(std::uint64_t h, std::uint64_t v){
+        return hash_mix(h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+
+    /** MurmurHash64A of len bytes. **/
+    inline std::uint64_t hash_bytes(const char* data, std::size_t len, std::uint64_t seed = 0){
+        const std::uint64_t m = 0xc6a4a7935bd1e995ULL;
+        const int r = 47;
+        std::uint64_t h = seed ^ (len * m);
+        const char* end = data + (len & ~(std::size_t) 7);
+        for (const char* p = data; p != end; p += 8){
+            std::uint64_t k;
+            std::memcpy(&k, p, 8);
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+        const unsigned char* tail = (const unsigned char*) end;
+        switch (len & 7){
+            case 7: h ^= std::uint64_t(tail[6]) << 48; // fall through
+            case 6: h ^= std::uint64_t(tail[5]) << 40; // fall through
+            case 5: h ^= std::uint64_t(tail[4]) << 32; // fall through
+            case 4: h ^= std::uint64_t(tail[3]) << 24; // fall through
+            case 3: h ^= std::uint64_t(tail[2]) << 16; // fall through
+            case 2: h ^= std::uint64_t(tail[1]) << 8; // fall through
+            case 1: h ^= std::uint64_t(tail[0]);
+                    h *= m;
+        }
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    inline std::uint64_t hash_bytes(const field_view& f, std::uint64_t seed = 0){
+        return hash_bytes(f.data, f.length, seed);
+    }
+
+    /**
+     *  Hash a CIGAR string, optionally as it reads from the other segment's
+     *  point of view (operations reversed, I and D swapped).
+     */
+    inline std::uint64_t hash_cigar(const field_view& cigar, bool reverse){
+        if (!reverse || cigar == "*"){
+            return hash_bytes(cigar);
+        }
+        std::string r;
+        r.reserve(cigar.length);
+        std::size_t op_end = cigar.length;
+        while (op_end > 0){
+            std::size_t op_start = op_end - 1;
+            while (op_start > 0 && cigar.data[op_start - 1] >= '0' && cigar.data[op_start - 1] <= '9'){
+                --op_start;
+            }
+            char op = cigar.data[op_end - 1];
+            r.append(cigar.data + op_start, op_end - 1 - op_start);
+            r.push_back(op == 'I' ? 'D' : (op == 'D' ? 'I' : op));
+            op_end = op_start;
+        }
+        return hash_bytes(r.c_str(), r.length());
+    }
+
+    /**
+     *  The hash of one graph element. key identifies the element (a segment
+     *  or path name, or the pair of segment ends an edge joins) and content
+     *  covers everything compared between graphs (sequence, overlap, steps).
+     *  Both include the element kind.
+     */
+    struct element_hash{
+        std::uint64_t key = 0;
+        std::uint64_t content = 0;
+        // S: segment, L: dovetail (L line or E line), C: containment (C or E),
+        // E: other GFA2 edge, P: path (P, O or W), U: unordered group,
+        // F: fragment, G: gap, w: GFA 0.1 per-step path line.
+        char kind = 0;
+
+        inline bool operator<(const element_hash& o) const{
+            return key < o.key || (key == o.key && content < o.content);
+        }
+    };
+
+    /** Index of kind in {S, L, C, E, P, U, F, G, w}, or -1. **/
+    inline int element_kind_index(char kind){
+        static const char kinds[] = "SLCEPUFGw";
+        const char* k = std::strchr(kinds, kind);
+        return kind != 0 && k != nullptr ? k - kinds : -1;
+    }
+
+    inline const char* element_kind_name(int index){
+        static const char* names[] = {"segments", "dovetail edges", "containments", "other edges",
+            "paths", "unordered groups", "fragments", "gaps", "GFA 0.1 path steps"};
+        return names[index];
+    }
+
+    namespace detail{
+        inline std::uint64_t hash_step(std::uint64_t h, const char* name, std::size_t len, bool forward){
+            return hash_combine(h, hash_combine(hash_bytes(name, len), forward));
+        }
+
+        /**
+         *  Fold the steps "a+,b-" (P), "a+ b-" (O) or ">a<b" (W, when sep is 0)
+         *  into h. P and O steps end at a ',' or ' ' that follows a '+' or '-'.
+         */
+        inline std::uint64_t hash_steps(std::uint64_t h, const field_view& steps, char sep){
+            const char* p = steps.data;
+            const char* end = steps.data + steps.length;
+            if (sep == 0){
+                while (p < end){
+                    bool forward = *p == '>';
+                    const char* q = p + 1;
+                    while (q < end && *q != '>' && *q != '<'){
+                        ++q;
+                    }
+                    h = hash_step(h, p + 1, q - p - 1, forward);
+                    p = q;
+                }
+                return h;
+            }
+            const char* q = p;
+            while (p < end){
+                while (q < end && !((*q == ',' || *q == ' ') && q > p && (q[-1] == '+' || q[-1] == '-'))){
+                    ++q;
+                }
+                if (q - p > 1){
+                    h = hash_step(h, p, q - p - 1, q[-1] == '+');
+                }
+                p = ++q;
+            }
+            return h;
+        }
+
+        inline void append_end(std::string* label, const field_view& name, bool forward){
+            label->push_back('\t');
+            label->append(name.data, name.length);
+            label->push_back(forward ? '+' : '-');
+        }
+
+        /**
+         *  Hash a dovetail between a (in orientation oa) and b. The same
+         *  overlap read from the other strand, b' -> a', hashes identically.
+         */
+        inline void hash_dovetail(const field_view& a, bool oa, const field_view& b, bool ob,
+                const field_view& cigar, element_hash& e, std::string* label){
+            std::uint64_t ha = hash_bytes(a);
+            std::uint64_t hb = hash_bytes(b);
+            bool flip = std::make_tuple(hb, !ob, ha, !oa) < std::make_tuple(ha, oa, hb, ob);
+            std::uint64_t k = flip ?
+                hash_combine(hash_combine(hash_combine(hash_combine('L', hb), !ob), ha), !oa) :
+                hash_combine(hash_combine(hash_combine(hash_combine('L', ha), oa), hb), ob);
+            e.kind = 'L';
+            e.key = k;
+            e.content = hash_combine(k, hash_cigar(cigar, flip));
+            if (label != nullptr){
+                *label = "L";
+                if (flip){
+                    append_end(label, b, !ob);
+                    append_end(label, a, !oa);
+                }
+                else{
+                    append_end(label, a, oa);
+                    append_end(label, b, ob);
+                }
+            }
+        }
+
+        inline void hash_segment(const field_view& name, std::uint64_t length, const field_view& seq,
+                element_hash& e, std::string* label){
+            e.kind = 'S';
+            e.key = hash_combine('S', hash_bytes(name));
+            e.content = hash_combine(hash_combine(e.key, length), seq == "*" ? 0 : hash_bytes(seq));
+            if (label != nullptr){
+                *label = "S\t" + name.str();
+            }
+        }
+
+        inline void hash_path(const field_view& name, element_hash& e, std::string* label){
+            e.kind = 'P';
+            e.key = hash_combine('P', hash_bytes(name));
+            e.content = e.key;
+            if (label != nullptr){
+                *label = "P\t" + name.str();
+            }
+        }
+
+        inline void hash_containment(const field_view& a, bool oa, const field_view& b, bool ob,
+                std::uint64_t pos, const field_view& cigar, element_hash& e, std::string* label){
+            e.kind = 'C';
+            e.key = hash_combine(hash_combine(hash_combine(hash_combine(hash_combine('C', hash_bytes(a)), oa), hash_bytes(b)), ob), pos);
+            e.content = hash_combine(e.key, hash_bytes(cigar));
+            if (label != nullptr){
+                *label = "C";
+                append_end(label, a, oa);
+                append_end(label, b, ob);
+                label->append("\t" + std::to_string(pos));
+            }
+        }
+
+        /** Elements compared only as a whole line (fragments, gaps, GFA 0.1 path steps). **/
+        inline void hash_line(char kind, const char* line, std::size_t len, element_hash& e, std::string* label){
+            e.kind = kind;
+            e.key = e.content = hash_bytes(line, len, kind);
+            if (label != nullptr){
+                label->assign(line, len);
+            }
+        }
+
+        inline field_view strip_orientation(const field_view& f){
+            return field_view(f.data, f.length > 0 ? f.length - 1 : 0);
+        }
+    }
+
+    /**
+     *  Compute the element_hash of one GFA record (a line without its newline).
+     *  Returns false for headers, comments and malformed lines. If label is
+     *  not null it is set to a short, tab-separated description of the element.
+     *
+     *  Hashes do not depend on the GFA version a graph is written in: a GFA2
+     *  segment, dovetail E line or O line hashes like the equivalent GFA1 S,
+     *  L or P line, and a link hashes the same when written from either
+     *  strand. Optional tags, edge IDs and path overlaps are ignored.
+     */
+    inline bool hash_record(const char* line, std::size_t len, element_hash& e, std::string* label = nullptr){
+        if (len == 0){
+            return false;
+        }
+        field_view f[10];
+        std::size_t n;
+        switch (line[0]){
+            case 'S':{
+                n = split_fields(line, len, f, 5);
+                if (n < 3){
+                    return false;
+                }
+                std::uint64_t length = 0;
+                field_view seq;
+                if (n >= 4 && f[2].is_number()){
+                    length = f[2].to_uint();
+                    seq = f[3];
+                }
+                else{
+                    seq = f[2];
+                    if (seq != "*"){
+                        length = seq.length;
+                    }
+                    else{
+                        const char* end = line + len;
+                        for (const char* p = seq.data + seq.length; p + 6 <= end; ++p){
+                            if (p[0] == '\t' && std::memcmp(p + 1, "LN:i:", 5) == 0){
+                                length = field_view(p + 6, end - p - 6).to_uint();
+                                break;
+                            }
+                        }
+                    }
+                }
+                detail::hash_segment(f[1], length, seq, e, label);
+                return true;
+            }
+            case 'L':{
+                n = split_fields(line, len, f, 7);
+                if (n < 5){
+                    return false;
+                }
+                field_view cigar = n >= 6 ? f[5] : field_view("*", 1);
+                detail::hash_dovetail(f[1], f[2] == "+", f[3], f[4] == "+", cigar, e, label);
+                return true;
+            }
+            case 'C':{
+                n = split_fields(line, len, f, 8);
+                if (n < 6){
+                    return false;
+                }
+                field_view cigar = n >= 7 ? f[6] : field_view("*", 1);
+                detail::hash_containment(f[1], f[2] == "+", f[3], f[4] == "+", f[5].to_uint(), cigar, e, label);
+                return true;
+            }
+            case 'E':{
+                n = split_fields(line, len, f, 10);
+                if (n < 9){
+                    return false;
+                }
+                field_view a = detail::strip_orientation(f[2]);
+                field_view b = detail::strip_orientation(f[3]);
+                bool oa = f[2].back() == '+';
+                bool ob = f[3].back() == '+';
+                const field_view& aln = f[8];
+                bool b1 = f[4].to_uint() == 0, e1 = f[5].back() == '$';
+                bool b2 = f[6].to_uint() == 0, e2 = f[7].back() == '$';
+                if (b2 && e2){
+                    detail::hash_containment(a, oa, b, ob, f[4].to_uint(), aln, e, label);
+                }
+                else if (b1 && e1){
+                    detail::hash_containment(b, ob, a, oa, f[6].to_uint(), aln, e, label);
+                }
+                else if ((b1 || e1) && (b2 || e2)){
+                    // An overlap at the start of a means b comes first (L b a).
+                    if (b1 && !e1){
+                        detail::hash_dovetail(b, ob, a, oa, aln, e, label);
+                    }
+                    else{
+                        detail::hash_dovetail(a, oa, b, ob, aln, e, label);
+                    }
+                }
+                else{
+                    std::uint64_t ea = hash_combine(hash_combine(hash_combine(hash_bytes(a), oa), hash_bytes(f[4])), hash_bytes(f[5]));
+                    std::uint64_t eb = hash_combine(hash_combine(hash_combine(hash_bytes(b), ob), hash_bytes(f[6])), hash_bytes(f[7]));
+                    e.kind = 'E';
+                    e.key = hash_combine(hash_combine('E', std::min(ea, eb)), std::max(ea, eb));
+                    e.content = hash_combine(e.key, hash_bytes(aln));
+                    if (label != nullptr){
+                        *label = "E\t" + f[2].str() + "\t" + f[3].str();
+                    }
+                }
+                return true;
+            }
+            case 'P':
+                n = split_fields(line, len, f, 4);
+                if (n >= 3 && !f[2].empty() && (f[2].back() == '+' || f[2].back() == '-')){
+                    detail::hash_path(f[1], e, label);
+                    e.content = detail::hash_steps(e.key, f[2], ',');
+                    return true;
+                }
+                detail::hash_line('w', line, len, e, label);
+                return true;
+            case 'O':{
+                n = split_fields(line, len, f, 4);
+                if (n < 3){
+                    return false;
+                }
+                detail::hash_path(f[1], e, label);
+                e.content = detail::hash_steps(e.key, f[2], ' ');
+                return true;
+            }
+            case 'W':{
+                n = split_fields(line, len, f, 8);
+                if (n < 7){
+                    detail::hash_line('w', line, len, e, label);
+                    return true;
+                }
+                std::string name = f[1].str() + "#" + f[2].str() + "#" + f[3].str() + ":" + f[4].str() + "-" + f[5].str();
+                detail::hash_path(field_view(name.c_str(), name.length()), e, label);
+                e.content = detail::hash_steps(e.key, f[6], 0);
+                return true;
+            }
+            case 'U':{
+                n = split_fields(line, len, f, 4);
+                if (n < 3){
+                    return false;
+                }
+                // Members of an unordered group are summed, so their order doesn't matter.
+                std::uint64_t sum = 0;
+                const char* p = f[2].data;
+                const char* end = f[2].data + f[2].length;
+                while (p < end){
+                    const char* q = std::find(p, end, ' ');
+                    if (q > p){
+                        sum += hash_mix(hash_bytes(p, q - p));
+                    }
+                    p = q + 1;
+                }
+                e.kind = 'U';
+                e.key = hash_combine('U', hash_bytes(f[1]));
+                e.content = hash_combine(e.key, sum);
+                if (label != nullptr){
+                    *label = "U\t" + f[1].str();
+                }
+                return true;
+            }
+            case 'F':
+                // F <segment> <external+-> <sbeg> <send> <fbeg> <fend> <alignment>
+                n = split_fields(line, len, f, 9);
+                if (n < 8){
+                    return false;
+                }
+                detail::hash_line('F', line, f[7].data + f[7].length - line, e, label);
+                return true;
+            case 'G':
+                // G <id> <sid1+-> <sid2+-> <distance> [<variance>]; the ID is ignored.
+                n = split_fields(line, len, f, 6);
+                if (n < 5){
+                    return false;
+                }
+                detail::hash_line('G', f[2].data, f[4].data + f[4].length - f[2].data, e, nullptr);
+                if (label != nullptr){
+                    label->assign(line, len);
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    /**
+     *  An order-independent digest of a set of element hashes. Each kind of
+     *  element is summed separately (so the elements can be added in any order,
+     *  and on any number of threads) and the per-kind sums and counts are then
+     *  hashed in a fixed order.
+     */
+    struct graph_fingerprint{
+        std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(9, 0);
+        std::vector<std::uint64_t> sums = std::vector<std::uint64_t>(9, 0);
+
+        inline void add(const element_hash& e){
+            int i = element_kind_index(e.kind);
+            ++counts[i];
+            sums[i] += hash_mix(hash_combine(e.key, e.content));
+        }
+        inline graph_fingerprint& operator+=(const graph_fingerprint& o){
+            for (std::size_t i = 0; i < counts.size(); ++i){
+                counts[i] += o.counts[i];
+                sums[i] += o.sums[i];
+            }
+            return *this;
+        }
+        inline bool operator==(const graph_fingerprint& o) const{
+            return counts == o.counts && sums == o.sums;
+        }
+        inline std::uint64_t digest() const{
+            std::uint64_t h = hash_mix('G');
+            for (std::size_t i = 0; i < counts.size(); ++i){
+                if (counts[i] > 0){
+                    h = hash_combine(hash_combine(hash_combine(h, i), counts[i]), sums[i]);
+                }
+            }
+            return h;
+        }
+        /** The digest as 16 hexadecimal digits. **/
+        inline std::string hex() const{
+            char buf[17];
+            snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) digest());
+            return std::string(buf);
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,463 @@
+#ifndef GFA_IDS_HPP
+#define GFA_IDS_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <unordered_map>
+#include <unordered_set>
+#include "gfa_stream.hpp"
+
+namespace gfak{
+
+    /**
+     *  The largest numeric segment, edge and gap IDs of a GFA file, the names
+     *  of its paths, groups and non-numeric segments, and its version, gathered
+     *  in one pass over the file (see scan_id_maxima). Everything but the names
+     *  is a fixed handful of counters.
+     */
+    struct gfa_id_maxima{
+        std::uint64_t segment = 0;
+        std::uint64_t edge = 0;
+        std::uint64_t gap = 0;
+        std::uint64_t segments = 0;
+        // Segments whose names aren't numbers, and so can't be offset.
+        std::uint64_t non_numeric_segments = 0;
+        // The VN tag of the header, or "" if there is none.
+        std::string version;
+        // Names of P and O/U lines, in file order.
+        std::vector<std::string> group_names;
+        // Segment names that aren't numbers, in file order.
+        std::vector<std::string> segment_names;
+
+        inline void add_record(const char* line, std::size_t len){
+            if (len < 2 || line[1] != '\t'){
+                return;
+            }
+            field_view f[3];
+            std::size_t n = split_fields(line, len, f, 3);
+            if (n < 2){
+                return;
+            }
+            switch (line[0]){
+                case 'S':
+                    ++segments;
+                    if (f[1].is_number()){
+                        segment = std::max(segment, f[1].to_uint());
+                    }
+                    else{
+                        ++non_numeric_segments;
+                        segment_names.push_back(f[1].str());
+                    }
+                    break;
+                case 'E':
+                    if (f[1].is_number()){
+                        edge = std::max(edge, f[1].to_uint());
+                    }
+                    break;
+                case 'G':
+                    if (f[1].is_number()){
+                        gap = std::max(gap, f[1].to_uint());
+                    }
+                    break;
+                case 'P':
+                case 'O':
+                case 'U':
+                    if (f[1] != "*"){
+                        group_names.push_back(f[1].str());
+                    }
+                    break;
+                case 'H':
+                    for (const char* p = line + 2; p + 5 <= line + len; ++p){
+                        if (std::memcmp(p, "VN:Z:", 5) == 0){
+                            const char* end = p + 5;
+                            while (end < line + len && *end != '\t'){
+                                ++end;
+                            }
+                            version.assign(p + 5, end);
+                            break;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        inline gfa_id_maxima& operator+=(const gfa_id_maxima& o){
+            segment = std::max(segment, o.segment);
+            edge = std::max(edge, o.edge);
+            gap = std::max(gap, o.gap);
+            segments += o.segments;
+            non_numeric_segments += o.non_numeric_segments;
+            if (version.empty()){
+                version = o.version;
+            }
+            group_names.insert(group_names.end(), o.group_names.begin(), o.group_names.end());
+            segment_names.insert(segment_names.end(), o.segment_names.begin(), o.segment_names.end());
+            return *this;
+        }
+    };
+
+    /**
+     *  Gather the gfa_id_maxima of a GFA file ("-" for stdin), reading chunks
+     *  of the file on up to <threads> threads. Returns false if the file
+     *  cannot be read.
+     */
+    inline bool scan_id_maxima(const std::string& filename, gfa_id_maxima& maxima, int threads = 1){
+        int max_chunks = threads > 1 ? threads : 1;
+        std::vector<gfa_id_maxima> chunk_maxima(max_chunks);
+        int chunks = for_each_line_in_file(filename, threads, [&](const char* line, std::size_t len, int chunk){
+                chunk_maxima[chunk].add_record(line, len);
+                });
+        if (chunks == 0){
+            return false;
+        }
+        for (int c = 0; c < chunks; ++c){
+            maxima += chunk_maxima[c];
+        }
+        return true;
+    }
+
+    /**
+     *  What to add to the numeric segment, edge and gap IDs of one file's
+     *  records, and the paths, groups and non-numeric segments to rename,
+     *  when its records are rewritten by offset_record.
+     */
+    struct id_offsets{
+        std::uint64_t segment = 0;
+        std::uint64_t edge = 0;
+        std::uint64_t gap = 0;
+        std::unordered_map<std::string, std::string> group_renames;
+        std::unordered_map<std::string, std::string> segment_renames;
+    };
+
+    /** Append a decimal unsigned integer to out. **/
+    inline void append_uint(std::string& out, std::uint64_t v){
+        char digits[20];
+        int n = 0;
+        do{
+            digits[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v > 0);
+        while (n > 0){
+            out.push_back(digits[--n]);
+        }
+    }
+
+    /** Append an ID to out, adding offset to it if it is a number. **/
+    inline void append_id(std::string& out, const char* id, std::size_t len, std::uint64_t offset){
+        field_view v(id, len);
+        if (offset == 0 || !v.is_number()){
+            out.append(id, len);
+        }
+        else{
+            append_uint(out, v.to_uint() + offset);
+        }
+    }
+
+    /** Append a segment ID to out, offset if it is a number and renamed if it is in off.segment_renames. **/
+    inline void append_segment_id(std::string& out, const char* id, std::size_t len, const id_offsets& off){
+        if (!off.segment_renames.empty() && !field_view(id, len).is_number()){
+            auto r = off.segment_renames.find(std::string(id, len));
+            if (r != off.segment_renames.end()){
+                out.append(r->second);
+                return;
+            }
+        }
+        append_id(out, id, len, off.segment);
+    }
+
+    /** Append a segment reference with a trailing orientation (e.g. 12+) to out. **/
+    inline void append_oriented_id(std::string& out, const char* ref, std::size_t len, const id_offsets& off){
+        if (len > 0 && (ref[len - 1] == '+' || ref[len - 1] == '-')){
+            append_segment_id(out, ref, len - 1, off);
+            out.push_back(ref[len - 1]);
+        }
+        else{
+            append_segment_id(out, ref, len, off);
+        }
+    }
+
+    /** Append a sep-separated list of segment references to out. **/
+    inline void append_id_list(std::string& out, const char* list, std::size_t len, char sep, const id_offsets& off){
+        const char* end = list + len;
+        while (list < end){
+            const char* next = (const char*) std::memchr(list, sep, end - list);
+            const char* item_end = next == nullptr ? end : next;
+            append_oriented_id(out, list, item_end - list, off);
+            if (next == nullptr){
+                break;
+            }
+            out.push_back(sep);
+            list = next + 1;
+        }
+    }
+
+    /** Append a GFA1.1 walk (e.g. >12<13>14) to out. **/
+    inline void append_walk(std::string& out, const char* walk, std::size_t len, const id_offsets& off){
+        const char* end = walk + len;
+        while (walk < end){
+            out.push_back(*walk);
+            const char* step = ++walk;
+            while (walk < end && *walk != '>' && *walk != '<'){
+                ++walk;
+            }
+            append_segment_id(out, step, walk - step, off);
+        }
+    }
+
+    /**
+     *  Append a GFA1 or GFA2 record to out, followed by a newline, with the
+     *  offsets added to every numeric segment, edge and gap ID it holds, its
+     *  non-numeric segment IDs replaced if they are renamed, and its name
+     *  replaced if it is a path or group that is renamed. Other
+     *  fields, and records of other types, are copied unchanged.
+     */
+    inline void offset_record(const char* line, std::size_t len, const id_offsets& off, std::string& out){
+        field_view f[8];
+        std::size_t n = len > 1 && line[1] == '\t' ? split_fields(line, len, f, 8) : 0;
+        std::size_t done = 0;
+        auto rename_group = [&](const field_view& name){
+            auto r = off.group_renames.empty() ? off.group_renames.end() : off.group_renames.find(name.str());
+            if (r != off.group_renames.end()){
+                out.append(r->second);
+            }
+            else{
+                out.append(name.data, name.length);
+            }
+        };
+        auto copy_to = [&](const field_view& fv){
+            out.append(line + done, fv.data - line - done);
+            done = fv.data + fv.length - line;
+        };
+        if (n > 1){
+            switch (line[0]){
+                case 'S':
+                case 'F':
+                    copy_to(f[1]);
+                    append_segment_id(out, f[1].data, f[1].length, off);
+                    break;
+                case 'L':
+                case 'C':
+                    if (n > 3){
+                        copy_to(f[1]);
+                        append_segment_id(out, f[1].data, f[1].length, off);
+                        copy_to(f[3]);
+                        append_segment_id(out, f[3].data, f[3].length, off);
+                    }
+                    break;
+                case 'E':
+                case 'G':
+                    if (n > 3){
+                        copy_to(f[1]);
+                        append_id(out, f[1].data, f[1].length, line[0] == 'E' ? off.edge : off.gap);
+                        copy_to(f[2]);
+                        append_oriented_id(out, f[2].data, f[2].length, off);
+                        copy_to(f[3]);
+                        append_oriented_id(out, f[3].data, f[3].length, off);
+                    }
+                    break;
+                case 'P':
+                case 'O':
+                case 'U':
+                    copy_to(f[1]);
+                    rename_group(f[1]);
+                    if (n > 2){
+                        copy_to(f[2]);
+                        append_id_list(out, f[2].data, f[2].length, line[0] == 'P' ? ',' : ' ', off);
+                    }
+                    break;
+                case 'W':
+                    if (n > 6){
+                        copy_to(f[6]);
+                        append_walk(out, f[6].data, f[6].length, off);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        out.append(line + done, len - done);
+        out.push_back('\n');
+    }
+
+    /**
+     *  Gather the gfa_id_maxima of each of files, on up to <threads> threads:
+     *  one file per thread, or chunks of the file if there is only one.
+     *  The files are read again once they are scanned, so they must be
+     *  regular files, not stdin or pipes. Returns false (and prints an error)
+     *  if a file can't be read, or can't be read twice.
+     */
+    inline bool scan_id_maxima(const std::vector<std::string>& files, std::vector<gfa_id_maxima>& maxima, int threads = 1){
+        int nthreads = threads > 1 ? threads : 1;
+        maxima.assign(files.size(), gfa_id_maxima());
+        for (auto& f : files){
+            if (!is_mappable_file(f)){
+                std::cerr << "Error: could not read GFA file " << f << " twice; stdin and pipes can't be streamed." << std::endl;
+                return false;
+            }
+        }
+        std::vector<char> ok(files.size(), 0);
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (std::size_t i = 0; i < files.size(); ++i){
+            ok[i] = scan_id_maxima(files[i], maxima[i], files.size() == 1 ? nthreads : 1);
+        }
+        for (std::size_t i = 0; i < files.size(); ++i){
+            if (!ok[i]){
+                std::cerr << "Error: could not read GFA file " << files[i] << "." << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     *  The offsets of each file when files with the given maxima are
+     *  concatenated: a prefix sum of the maxima, starting from start.
+     */
+    inline std::vector<id_offsets> prefix_id_offsets(const std::vector<gfa_id_maxima>& maxima, const id_offsets& start){
+        std::vector<id_offsets> offsets(maxima.size());
+        id_offsets next = start;
+        for (std::size_t i = 0; i < maxima.size(); ++i){
+            offsets[i].segment = next.segment;
+            offsets[i].edge = next.edge;
+            offsets[i].gap = next.gap;
+            next.segment += maxima[i].segment;
+            next.edge += maxima[i].edge;
+            next.gap += maxima[i].gap;
+        }
+        return offsets;
+    }
+
+    /**
+     *  Write a GFA file to os record by record through offset_record,
+     *  leaving out its header lines if keep_header is false.
+     *  Returns false if the file can't be read.
+     */
+    inline bool stream_offset_ids(const std::string& filename, const id_offsets& off, std::ostream& os, bool keep_header = true){
+        const std::size_t flush_size = 1 << 22;
+        std::string out;
+        out.reserve(flush_size * 2);
+        int n = for_each_line_in_file(filename, 1, [&](const char* line, std::size_t len, int){
+                if (len == 0 || (line[0] == 'H' && !keep_header)){
+                    return;
+                }
+                offset_record(line, len, off, out);
+                if (out.length() >= flush_size){
+                    os.write(out.data(), out.length());
+                    out.clear();
+                }
+                });
+        os.write(out.data(), out.length());
+        return n > 0;
+    }
+
+    /**
+     *  Rewrite each of files with its offsets, <threads> files at a time.
+     *  If outputs is empty, the files are concatenated into os in order
+     *  (through temporary files when there is more than one thread), with
+     *  only the first header if keep_headers is false; otherwise file i is
+     *  written to outputs[i]. Returns false if a file can't be read or an
+     *  output can't be written.
+     */
+    inline bool write_offset_files(const std::vector<std::string>& files, const std::vector<id_offsets>& offsets,
+            const std::vector<std::string>& outputs, std::ostream& os, int threads = 1, bool keep_headers = true){
+        int nthreads = threads > 1 ? threads : 1;
+        std::vector<std::string> targets(outputs);
+        bool concatenate = targets.empty();
+        if (concatenate){
+            if (nthreads == 1 || files.size() == 1){
+                for (std::size_t i = 0; i < files.size(); ++i){
+                    if (!stream_offset_ids(files[i], offsets[i], os, keep_headers || i == 0)){
+                        std::cerr << "Error: could not read GFA file " << files[i] << "." << std::endl;
+                        return false;
+                    }
+                }
+                return true;
+            }
+            targets.resize(files.size());
+            for (auto& t : targets){
+                t = make_temp_file();
+            }
+        }
+        std::vector<char> ok(files.size(), 0);
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (std::size_t i = 0; i < files.size(); ++i){
+            std::ofstream ofi(targets[i].c_str());
+            ok[i] = ofi.good() && stream_offset_ids(files[i], offsets[i], ofi, keep_headers || i == 0);
+        }
+        bool all_ok = true;
+        for (std::size_t i = 0; i < files.size(); ++i){
+            if (!ok[i]){
+                std::cerr << "Error: could not rewrite " << files[i] << " to " << targets[i] << "." << std::endl;
+                all_ok = false;
+            }
+            if (concatenate){
+                std::ifstream ifi(targets[i].c_str());
+                if (ifi.peek() != std::ifstream::traits_type::eof()){
+                    os << ifi.rdbuf();
+                }
+                std::remove(targets[i].c_str());
+            }
+        }
+        return all_ok;
+    }
+
+    /**
+     *  Concatenate GFA files into os, streaming them record by record. A
+     *  pre-pass over the files (on up to <threads> threads) finds the largest
+     *  numeric segment, edge and gap IDs of each, and each file's IDs are offset by
+     *  the sums of those of the files before it, so no two files share an ID.
+     *  Paths, groups and non-numeric segments whose names were used by an
+     *  earlier file get a _<n> suffix. Only the header of the first file is
+     *  written. Memory use doesn't depend on the size or number of the graphs,
+     *  beyond the names of paths, groups and non-numeric segments.
+     *  Returns false (having written nothing) if a file can't be read or the
+     *  files are of different GFA versions.
+     */
+    inline bool stream_merge(const std::vector<std::string>& files, std::ostream& os, int threads = 1){
+        std::vector<gfa_id_maxima> maxima;
+        if (!scan_id_maxima(files, maxima, threads)){
+            return false;
+        }
+        std::vector<id_offsets> offsets = prefix_id_offsets(maxima, id_offsets());
+        // Give names already used by an earlier file the first free _<n> suffix.
+        auto rename_taken = [](const std::vector<std::string>& names, std::unordered_set<std::string>& used,
+                std::unordered_map<std::string, std::string>& renames){
+            std::unordered_set<std::string> file_names;
+            for (auto& name : names){
+                if (!file_names.insert(name).second || used.insert(name).second){
+                    continue;
+                }
+                std::uint64_t k = 1;
+                std::string renamed;
+                do{
+                    renamed = name + "_" + std::to_string(k++);
+                } while (used.count(renamed));
+                used.insert(renamed);
+                renames[name] = renamed;
+            }
+        };
+        std::unordered_set<std::string> used_names;
+        std::unordered_set<std::string> used_segments;
+        for (std::size_t i = 0; i < files.size(); ++i){
+            const gfa_id_maxima& m = maxima[i];
+            if (m.version != maxima[0].version){
+                std::cerr << "Error: " << files[i] << " is GFA version " << (m.version.empty() ? "unknown" : m.version) <<
+                    " but " << files[0] << " is " << (maxima[0].version.empty() ? "unknown" : maxima[0].version) << "." << std::endl;
+                return false;
+            }
+            rename_taken(m.group_names, used_names, offsets[i].group_renames);
+            rename_taken(m.segment_names, used_segments, offsets[i].segment_renames);
+        }
+        return write_offset_files(files, offsets, std::vector<std::string>(), os, threads, false);
+    }
+
+}
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef GFA_KERNELS_HPP
+#define GFA_KERNELS_HPP
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GFAK_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+/**
+ *  Byte-level sequence kernels: reverse complement, non-ACGT detection,
+ *  base composition, case folding and line break removal.
+ *
+ *  Each kernel has a scalar version and, on x86, SSE and AVX2 versions
+ *  compiled with target attributes. The best version supported by the
+ *  running CPU is picked once, at first use; setting GFAK_KERNELS to
+ *  "scalar", "sse" or "avx2" caps the level.
+ */
+
+namespace gfak{
+
+    /** Counts of base classes in a sequence. Lowercase bases are also counted in their class. **/
+    struct base_composition{
+        std::uint64_t length = 0;
+        std::uint64_t gc = 0;
+        std::uint64_t at = 0;
+        std::uint64_t n = 0;
+        std::uint64_t lowercase = 0;
+
+        /** Bases other than A, C, G, T and N (e.g. IUPAC ambiguity codes). **/
+        inline std::uint64_t other() const{
+            return length - gc - at - n;
+        }
+        inline base_composition& operator+=(const base_composition& c){
+            length += c.length;
+            gc += c.gc;
+            at += c.at;
+            n += c.n;
+            lowercase += c.lowercase;
+            return *this;
+        }
+    };
+
+    // Complement table covering upper- and lowercase IUPAC codes.
+    // Any other character complements to itself.
+    struct complement_table{
+        char table[256];
+        complement_table(){
+            for (int i = 0; i < 256; ++i){
+                table[i] = (char) i;
+            }
+            const char* from = "ACGTURYKMBVDHSWNacgturykmbvdhswn";
+            const char* to =   "TGCAAYRMKVBHDSWNtgcaayrmkvbhdswn";
+            for (int i = 0; from[i] != '\0'; ++i){
+                table[(unsigned char) from[i]] = to[i];
+            }
+        }
+    };
+
+    // Per-byte class bits for the scalar kernels.
+    struct base_class_table{
+        enum {GC = 1, AT = 2, N = 4, LOWER = 8};
+        std::uint8_t table[256];
+        base_class_table(){
+            std::memset(table, 0, 256);
+            for (int c = 'a'; c <= 'z'; ++c){
+                table[c] = LOWER;
+            }
+            const char* gc = "GCgc";
+            const char* at = "ATat";
+            for (int i = 0; i < 4; ++i){
+                table[(unsigned char) gc[i]] |= GC;
+                table[(unsigned char) at[i]] |= AT;
+            }
+            table[(unsigned char) 'N'] |= N;
+            table[(unsigned char) 'n'] |= N;
+        }
+    };
+
+    /** Scalar kernels. **/
+    inline void reverse_complement_scalar(const char* seq, std::size_t len, char* out){
+        static const complement_table comp;
+        for (std::size_t i = 0; i < len; ++i){
+            out[i] = comp.table[(unsigned char) seq[len - 1 - i]];
+        }
+    }
+    inline std::size_t first_non_acgt_scalar(const char* seq, std::size_t len){
+        static const base_class_table classes;
+        for (std::size_t i = 0; i < len; ++i){
+            if (!(classes.table[(unsigned char) seq[i]] & (base_class_table::GC | base_class_table::AT))){
+                return i;
+            }
+        }
+        return len;
+    }
+    inline void composition_scalar(const char* seq, std::size_t len, base_composition& comp){
+        static const base_class_table classes;
+        std::uint64_t counts[16] = {0};
+        for (std::size_t i = 0; i < len; ++i){
+            ++counts[classes.table[(unsigned char) seq[i]]];
+        }
+        comp.length += len;
+        for (int k = 0; k < 16; ++k){
+            comp.gc += (k & base_class_table::GC) ? counts[k] : 0;
+            comp.at += (k & base_class_table::AT) ? counts[k] : 0;
+            comp.n += (k & base_class_table::N) ? counts[k] : 0;
+            comp.lowercase += (k & base_class_table::LOWER) ? counts[k] : 0;
+        }
+    }
+    inline void to_upper_scalar(char* seq, std::size_t len){
+        for (std::size_t i = 0; i < len; ++i){
+            seq[i] -= (seq[i] >= 'a' && seq[i] <= 'z') ? 0x20 : 0;
+        }
+    }
+    inline std::size_t strip_line_breaks_scalar(const char* seq, std::size_t len, char* out){
+        std::size_t w = 0;
+        for (std::size_t i = 0; i < len; ++i){
+            out[w] = seq[i];
+            w += seq[i] != '\n' && seq[i] != '\r';
+        }
+        return w;
+    }
+
+#ifdef GFAK_X86_KERNELS
+    /**
+     *  SSE kernels. Reverse complement needs SSSE3 (pshufb); the rest are SSE2.
+     *  Bytes in 0x40-0x7F are complemented by looking up their low nibble in one
+     *  of two 16-entry tables (the @A-O row and the P-_ row) and restoring the
+     *  case bit; all other bytes pass through. This matches complement_table.
+     */
+    __attribute__((target("ssse3")))
+    inline void reverse_complement_sse(const char* seq, std::size_t len, char* out){
+        const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        // @ A B C D E F G H I J K L M N O
+        const __m128i row4 = _mm_setr_epi8('@', 'T', 'V', 'G', 'H', 'E', 'F', 'C',
+                'D', 'I', 'J', 'M', 'L', 'K', 'N', 'O');
+        // P Q R S T U V W X Y Z [ \ ] ^ _
+        const __m128i row5 = _mm_setr_epi8('P', 'Q', 'Y', 'S', 'A', 'A', 'B', 'W',
+                'X', 'R', 'Z', '[', '\\', ']', '^', '_');
+        const __m128i low_nibble = _mm_set1_epi8(0x0F);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        const __m128i row_bits = _mm_set1_epi8((char) 0xD0);
+        const __m128i letter_bits = _mm_set1_epi8((char) 0xC0);
+        const __m128i is_row5 = _mm_set1_epi8(0x50);
+        const __m128i is_letter = _mm_set1_epi8(0x40);
+
+        std::size_t i = 0;
+        for (; i + 16 <= len; i += 16){
+            __m128i v = _mm_loadu_si128((const __m128i*) (seq + len - i - 16));
+            v = _mm_shuffle_epi8(v, reverse);
+            __m128i lo = _mm_and_si128(v, low_nibble);
+            __m128i r5 = _mm_cmpeq_epi8(_mm_and_si128(v, row_bits), is_row5);
+            __m128i comp = _mm_or_si128(_mm_andnot_si128(r5, _mm_shuffle_epi8(row4, lo)),
+                    _mm_and_si128(r5, _mm_shuffle_epi8(row5, lo)));
+            comp = _mm_or_si128(comp, _mm_and_si128(v, case_bit));
+            __m128i letter = _mm_cmpeq_epi8(_mm_and_si128(v, letter_bits), is_letter);
+            v = _mm_or_si128(_mm_and_si128(letter, comp), _mm_andnot_si128(letter, v));
+            _mm_storeu_si128((__m128i*) (out + i), v);
+        }
+        reverse_complement_scalar(seq, len - i, out + i);
+    }
+
+    __attribute__((target("sse2")))
+    inline std::size_t first_non_acgt_sse(const char* seq, std::size_t len){
+        const __m128i fold = _mm_set1_epi8((char) 0xDF);
+        const __m128i a = _mm_set1_epi8('A');
+        const __m128i c = _mm_set1_epi8('C');
+        const __m128i g = _mm_set1_epi8('G');
+        const __m128i t = _mm_set1_epi8('T');
+        std::size_t i = 0;
+        for (; i + 16 <= len; i += 16){
+            __m128i u = _mm_and_si128(_mm_loadu_si128((const __m128i*) (seq + i)), fold);
+            __m128i ok = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(u, a), _mm_cmpeq_epi8(u, c)),
+                    _mm_or_si128(_mm_cmpeq_epi8(u, g), _mm_cmpeq_epi8(u, t)));
+            unsigned bad = ~_mm_movemask_epi8(ok) & 0xFFFF;
+            if (bad){
+                return i + __builtin_ctz(bad);
+            }
+        }
+        return i + first_non_acgt_scalar(seq + i, len - i);
+    }
+
+    __attribute__((target("sse2")))
+    inline std::uint64_t horizontal_sum_sse(const __m128i& bytes){
+        std::uint64_t lanes[2];
+        _mm_storeu_si128((__m128i*) lanes, _mm_sad_epu8(bytes, _mm_setzero_si128()));
+        return lanes[0] + lanes[1];
+    }
+
+    // Byte counters are flushed to 64-bit totals every 255 blocks.
+    __attribute__((target("sse2")))
+    inline void composition_sse(const char* seq, std::size_t len, base_composition& comp){
+        const __m128i fold = _mm_set1_epi8((char) 0xDF);
+        const __m128i a = _mm_set1_epi8('A');
+        const __m128i c = _mm_set1_epi8('C');
+        const __m128i g = _mm_set1_epi8('G');
+        const __m128i t = _mm_set1_epi8('T');
+        const __m128i n = _mm_set1_epi8('N');
+        const __m128i lower_a = _mm_set1_epi8('a');
+        const __m128i alphabet = _mm_set1_epi8(25);
+        std::size_t i = 0;
+        while (i + 16 <= len){
+            __m128i gc_count = _mm_setzero_si128();
+            __m128i at_count = _mm_setzero_si128();
+            __m128i n_count = _mm_setzero_si128();
+            __m128i lower_count = _mm_setzero_si128();
+            std::size_t stop = i + 16 * std::min<std::size_t>(255, (len - i) / 16);
+            for (; i < stop; i += 16){
+                __m128i v = _mm_loadu_si128((const __m128i*) (seq + i));
+                __m128i u = _mm_and_si128(v, fold);
+                gc_count = _mm_sub_epi8(gc_count, _mm_or_si128(_mm_cmpeq_epi8(u, g), _mm_cmpeq_epi8(u, c)));
+                at_count = _mm_sub_epi8(at_count, _mm_or_si128(_mm_cmpeq_epi8(u, a), _mm_cmpeq_epi8(u, t)));
+                n_count = _mm_sub_epi8(n_count, _mm_cmpeq_epi8(u, n));
+                __m128i off = _mm_sub_epi8(v, lower_a);
+                lower_count = _mm_sub_epi8(lower_count, _mm_cmpeq_epi8(_mm_min_epu8(off, alphabet), off));
+            }
+            comp.gc += horizontal_sum_sse(gc_count);
+            comp.at += horizontal_sum_sse(at_count);
+            comp.n += horizontal_sum_sse(n_count);
+            comp.lowercase += horizontal_sum_sse(lower_count);
+        }
+        comp.length += i;
+        composition_scalar(seq + i, len - i, comp);
+    }
+
+    __attribute__((target("sse2")))
+    inline void to_upper_sse(char* seq, std::size_t len){
+        const __m128i lower_a = _mm_set1_epi8('a');
+        const __m128i alphabet = _mm_set1_epi8(25);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        std::size_t i = 0;
+        for (; i + 16 <= len; i += 16){
+            __m128i v = _mm_loadu_si128((const __m128i*) (seq + i));
+            __m128i off = _mm_sub_epi8(v, lower_a);
+            __m128i lower = _mm_cmpeq_epi8(_mm_min_epu8(off, alphabet), off);
+            _mm_storeu_si128((__m128i*) (seq + i), _mm_sub_epi8(v, _mm_and_si128(lower, case_bit)));
+        }
+        to_upper_scalar(seq + i, len - i);
+    }
+
+    // Blocks without a line break are stored whole; the others go byte by byte.
+    __attribute__((target("sse2")))
+    inline std::size_t strip_line_breaks_sse(const char* seq, std::size_t len, char* out){
+        const __m128i nl = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+        std::size_t i = 0;
+        std::size_t w = 0;
+        for (; i + 16 <= len; i += 16){
+            __m128i v = _mm_loadu_si128((const __m128i*) (seq + i));
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr))) == 0){
+                _mm_storeu_si128((__m128i*) (out + w), v);
+                w += 16;
+            }
+            else{
+                w += strip_line_breaks_scalar(seq + i, 16, out + w);
+            }
+        }
+        return w + strip_line_breaks_scalar(seq + i, len - i, out + w);
+    }
+
+    /**
+     *  AVX2 kernels: the SSE kernels widened to 32 bytes. pshufb works within
+     *  128-bit lanes, so reversal swaps the lanes after the in-lane shuffle.
+     */
+    __attribute__((target("avx2")))
+    inline void reverse_complement_avx2(const char* seq, std::size_t len, char* out){
+        const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        const __m256i row4 = _mm256_setr_epi8('@', 'T', 'V', 'G', 'H', 'E', 'F', 'C',
+                'D', 'I', 'J', 'M', 'L', 'K', 'N', 'O',
+                '@', 'T', 'V', 'G', 'H', 'E', 'F', 'C',
+                'D', 'I', 'J', 'M', 'L', 'K', 'N', 'O');
+        const __m256i row5 = _mm256_setr_epi8('P', 'Q', 'Y', 'S', 'A', 'A', 'B', 'W',
+                'X', 'R', 'Z', '[', '\\', ']', '^', '_',
+                'P', 'Q', 'Y', 'S', 'A', 'A', 'B', 'W',
+                'X', 'R', 'Z', '[', '\\', ']', '^', '_');
+        const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+        const __m256i case_bit = _mm256_set1_epi8(0x20);
+        const __m256i row_bits = _mm256_set1_epi8((char) 0xD0);
+        const __m256i letter_bits = _mm256_set1_epi8((char) 0xC0);
+        const __m256i is_row5 = _mm256_set1_epi8(0x50);
+        const __m256i is_letter = _mm256_set1_epi8(0x40);
+
+        std::size_t i = 0;
+        for (; i + 32 <= len; i += 32){
+            __m256i v = _mm256_loadu_si256((const __m256i*) (seq + len - i - 32));
+            v = _mm256_shuffle_epi8(v, reverse);
+            v = _mm256_permute2x128_si256(v, v, 0x01);
+            __m256i lo = _mm256_and_si256(v, low_nibble);
+            __m256i r5 = _mm256_cmpeq_epi8(_mm256_and_si256(v, row_bits), is_row5);
+            __m256i comp = _mm256_blendv_epi8(_mm256_shuffle_epi8(row4, lo), _mm256_shuffle_epi8(row5, lo), r5);
+            comp = _mm256_or_si256(comp, _mm256_and_si256(v, case_bit));
+            __m256i letter = _mm256_cmpeq_epi8(_mm256_and_si256(v, letter_bits), is_letter);
+            _mm256_storeu_si256((__m256i*) (out + i), _mm256_blendv_epi8(v, comp, letter));
+        }
+        reverse_complement_sse(seq, len - i, out + i);
+    }
+
+    __attribute__((target("avx2")))
+    inline std::size_t first_non_acgt_avx2(const char* seq, std::size_t len){
+        const __m256i fold = _mm256_set1_epi8((char) 0xDF);
+        const __m256i a = _mm256_set1_epi8('A');
+        const __m256i c = _mm256_set1_epi8('C');
+        const __m256i g = _mm256_set1_epi8('G');
+        const __m256i t = _mm256_set1_epi8('T');
+        std::size_t i = 0;
+        for (; i + 32 <= len; i += 32){
+            __m256i u = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (seq + i)), fold);
+            __m256i ok = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(u, a), _mm256_cmpeq_epi8(u, c)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(u, g), _mm256_cmpeq_epi8(u, t)));
+            unsigned bad = ~(unsigned) _mm256_movemask_epi8(ok);
+            if (bad){
+                return i + __builtin_ctz(bad);
+            }
+        }
+        return i + first_non_acgt_sse(seq + i, len - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline std::uint64_t horizontal_sum_avx2(const __m256i& bytes){
+        std::uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i*) lanes, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    __attribute__((target("avx2")))
+    inline void composition_avx2(const char* seq, std::size_t len, base_composition& comp){
+        const __m256i fold = _mm256_set1_epi8((char) 0xDF);
+        const __m256i a = _mm256_set1_epi8('A');
+        const __m256i c = _mm256_set1_epi8('C');
+        const __m256i g = _mm256_set1_epi8('G');
+        const __m256i t = _mm256_set1_epi8('T');
+        const __m256i n = _mm256_set1_epi8('N');
+        const __m256i lower_a = _mm256_set1_epi8('a');
+        const __m256i alphabet = _mm256_set1_epi8(25);
+        std::size_t i = 0;
+        while (i + 32 <= len){
+            __m256i gc_count = _mm256_setzero_si256();
+            __m256i at_count = _mm256_setzero_si256();
+            __m256i n_count = _mm256_setzero_si256();
+            __m256i lower_count = _mm256_setzero_si256();
+            std::size_t stop = i + 32 * std::min<std::size_t>(255, (len - i) / 32);
+            for (; i < stop; i += 32){
+                __m256i v = _mm256_loadu_si256((const __m256i*) (seq + i));
+                __m256i u = _mm256_and_si256(v, fold);
+                gc_count = _mm256_sub_epi8(gc_count, _mm256_or_si256(_mm256_cmpeq_epi8(u, g), _mm256_cmpeq_epi8(u, c)));
+                at_count = _mm256_sub_epi8(at_count, _mm256_or_si256(_mm256_cmpeq_epi8(u, a), _mm256_cmpeq_epi8(u, t)));
+                n_count = _mm256_sub_epi8(n_count, _mm256_cmpeq_epi8(u, n));
+                __m256i off = _mm256_sub_epi8(v, lower_a);
+                lower_count = _mm256_sub_epi8(lower_count, _mm256_cmpeq_epi8(_mm256_min_epu8(off, alphabet), off));
+            }
+            comp.gc += horizontal_sum_avx2(gc_count);
+            comp.at += horizontal_sum_avx2(at_count);
+            comp.n += horizontal_sum_avx2(n_count);
+            comp.lowercase += horizontal_sum_avx2(lower_count);
+        }
+        comp.length += i;
+        composition_sse(seq + i, len - i, comp);
+    }
+
+    __attribute__((target("avx2")))
+    inline void to_upper_avx2(char* seq, std::size_t len){
+        const __m256i lower_a = _mm256_set1_epi8('a');
+        const __m256i alphabet = _mm256_set1_epi8(25);
+        const __m256i case_bit = _mm256_set1_epi8(0x20);
+        std::size_t i = 0;
+        for (; i + 32 <= len; i += 32){
+            __m256i v = _mm256_loadu_si256((const __m256i*) (seq + i));
+            __m256i off = _mm256_sub_epi8(v, lower_a);
+            __m256i lower = _mm256_cmpeq_epi8(_mm256_min_epu8(off, alphabet), off);
+            _mm256_storeu_si256((__m256i*) (seq + i), _mm256_sub_epi8(v, _mm256_and_si256(lower, case_bit)));
+        }
+        to_upper_sse(seq + i, len - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline std::size_t strip_line_breaks_avx2(const char* seq, std::size_t len, char* out){
+        const __m256i nl = _mm256_set1_epi8('\n');
+        const __m256i cr = _mm256_set1_epi8('\r');
+        std::size_t i = 0;
+        std::size_t w = 0;
+        for (; i + 32 <= len; i += 32){
+            __m256i v = _mm256_loadu_si256((const __m256i*) (seq + i));
+            if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr))) == 0){
+                _mm256_storeu_si256((__m256i*) (out + w), v);
+                w += 32;
+            }
+            else{
+                w += strip_line_breaks_sse(seq + i, 32, out + w);
+            }
+        }
+        return w + strip_line_breaks_sse(seq + i, len - i, out + w);
+    }
+#endif
+
+    enum kernel_level {SCALAR_KERNELS, SSE_KERNELS, AVX2_KERNELS};
+
+    /** The kernel implementations chosen for this CPU. **/
+    struct sequence_kernels{
+        kernel_level level = SCALAR_KERNELS;
+        void (*reverse_complement)(const char*, std::size_t, char*) = reverse_complement_scalar;
+        std::size_t (*first_non_acgt)(const char*, std::size_t) = first_non_acgt_scalar;
+        void (*composition)(const char*, std::size_t, base_composition&) = composition_scalar;
+        void (*to_upper)(char*, std::size_t) = to_upper_scalar;
+        std::size_t (*strip_line_breaks)(const char*, std::size_t, char*) = strip_line_breaks_scalar;
+
+        sequence_kernels(){
+            int cap = AVX2_KERNELS;
+            const char* env = std::getenv("GFAK_KERNELS");
+            if (env != nullptr){
+                cap = std::strcmp(env, "scalar") == 0 ? SCALAR_KERNELS :
+                    std::strcmp(env, "sse") == 0 ? SSE_KERNELS : AVX2_KERNELS;
+            }
+#ifdef GFAK_X86_KERNELS
+            __builtin_cpu_init();
+            if (cap >= SSE_KERNELS && __builtin_cpu_supports("ssse3")){
+                level = SSE_KERNELS;
+                reverse_complement = reverse_complement_sse;
+                first_non_acgt = first_non_acgt_sse;
+                composition = composition_sse;
+                to_upper = to_upper_sse;
+                strip_line_breaks = strip_line_breaks_sse;
+            }
+            if (cap >= AVX2_KERNELS && __builtin_cpu_supports("avx2")){
+                level = AVX2_KERNELS;
+                reverse_complement = reverse_complement_avx2;
+                first_non_acgt = first_non_acgt_avx2;
+                composition = composition_avx2;
+                to_upper = to_upper_avx2;
+                strip_line_breaks = strip_line_breaks_avx2;
+            }
+#else
+            (void) cap;
+#endif
+        }
+    };
+
+    inline const sequence_kernels& get_sequence_kernels(){
+        static const sequence_kernels kernels;
+        return kernels;
+    }
+
+    /**
+     *  Write the reverse complement of seq[0, len) to out, which must
+     *  have room for len chars and must not overlap seq.
+     */
+    static inline void reverse_complement(const char* seq, std::size_t len, char* out){
+        get_sequence_kernels().reverse_complement(seq, len, out);
+    }
+    static inline std::string reverse_complement(const std::string& seq){
+        std::string ret(seq.length(), 'N');
+        reverse_complement(seq.c_str(), seq.length(), &ret[0]);
+        return ret;
+    }
+
+    /** Index of the first byte of seq[0, len) that is not one of ACGTacgt, or len if there is none. **/
+    inline std::size_t first_non_acgt(const char* seq, std::size_t len){
+        return get_sequence_kernels().first_non_acgt(seq, len);
+    }
+    /** True if seq contains only ACGTacgt. **/
+    inline bool is_acgt(const std::string& seq){
+        return first_non_acgt(seq.c_str(), seq.length()) == seq.length();
+    }
+
+    /** Add the composition of seq[0, len) to comp. **/
+    inline void add_composition(const char* seq, std::size_t len, base_composition& comp){
+        get_sequence_kernels().composition(seq, len, comp);
+    }
+    inline void add_composition(const std::string& seq, base_composition& comp){
+        add_composition(seq.c_str(), seq.length(), comp);
+    }
+
+    /** Convert a-z to A-Z in place. **/
+    inline void to_upper(char* seq, std::size_t len){
+        get_sequence_kernels().to_upper(seq, len);
+    }
+    inline void to_upper(std::string& seq){
+        to_upper(&seq[0], seq.length());
+    }
+
+    /**
+     *  Copy seq[0, len) to out without its '\n' and '\r' bytes, returning the
+     *  number of bytes written. out must have room for all the bytes kept.
+     */
+    inline std::size_t strip_line_breaks(const char* seq, std::size_t len, char* out){
+        return get_sequence_kernels().strip_line_breaks(seq, len, out);
+    }
+
+}
+
+#endif
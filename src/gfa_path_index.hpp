@@ -0,0 +1,479 @@
+#ifndef GFA_PATH_INDEX_HPP
+#define GFA_PATH_INDEX_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "gfakluge.hpp"
+
+namespace gfak{
+
+    /**
+     *  The location of a single step on a path: the rank of the path
+     *  within a path_position_index and the 0-based rank of the step
+     *  within that path.
+     */
+    struct path_step_t{
+        std::uint32_t path_rank = 0;
+        std::uint64_t step_rank = 0;
+    };
+
+    /**
+     *  A positional index over the paths of a graph.
+     *
+     *  For every path we keep its steps as handles (segment rank << 1 | is_reverse)
+     *  along with prefix sums of the segment lengths, so that a path offset can
+     *  be resolved to a step with a binary search. An inverted table maps each
+     *  segment to all of its (path, step) occurrences, stored contiguously per segment
+     *  and sorted by path and then step.
+     *
+     *  Both directions (segment -> path offsets and path offset -> segment)
+     *  are answered in O(log n).
+     */
+    class path_position_index{
+        private:
+            std::vector<std::string> node_names;
+            std::vector<std::uint64_t> node_lengths;
+            std::unordered_map<std::string, std::uint32_t> node_to_rank;
+
+            std::vector<std::string> path_names;
+            std::unordered_map<std::string, std::uint32_t> path_to_rank;
+            // Per-path step handles and length prefix sums.
+            // path_offsets[p] has one more entry than path_steps[p];
+            // the last entry is the length of the path.
+            std::vector<std::vector<std::uint64_t> > path_steps;
+            std::vector<std::vector<std::uint64_t> > path_offsets;
+
+            // Segment -> step occurrences, in CSR form.
+            std::vector<std::uint64_t> occurrence_starts;
+            std::vector<path_step_t> occurrences;
+
+            inline static std::uint64_t make_handle(const std::uint32_t& rank, const bool& forward){
+                return ((std::uint64_t) rank << 1) | (forward ? 0 : 1);
+            }
+
+            inline std::uint32_t add_node(const std::string& name, const std::uint64_t& length){
+                std::uint32_t rank = node_names.size();
+                node_to_rank[name] = rank;
+                node_names.push_back(name);
+                node_lengths.push_back(length);
+                return rank;
+            }
+
+            // Translate a path's segment names to handles and compute its prefix sums.
+            // Returns false if the path references a segment which is not in the graph.
+            inline bool index_path(const path_elem& p, std::vector<std::uint64_t>& steps,
+                    std::vector<std::uint64_t>& offsets) const{
+                steps.resize(p.segment_names.size());
+                offsets.resize(p.segment_names.size() + 1);
+                std::uint64_t pos = 0;
+                for (std::size_t i = 0; i < p.segment_names.size(); ++i){
+                    auto r = node_to_rank.find(p.segment_names[i]);
+                    if (r == node_to_rank.end()){
+                        return false;
+                    }
+                    steps[i] = make_handle(r->second, p.orientations[i]);
+                    offsets[i] = pos;
+                    pos += node_lengths[r->second];
+                }
+                offsets[p.segment_names.size()] = pos;
+                return true;
+            }
+
+        public:
+            path_position_index(){
+
+            }
+            path_position_index(const GFAKluge& gg, int threads = 1){
+                build(gg, threads);
+            }
+
+            /**
+             *  Index all paths in gg. Paths are indexed in parallel
+             *  using up to <threads> threads.
+             */
+            inline void build(const GFAKluge& gg, int threads = 1){
+                clear();
+
+                gg.for_each_sequence([&](const sequence_elem& s){
+                        std::uint64_t len = s.sequence != "*" ? s.sequence.length() :
+                                (s.length == UINT64_MAX ? 0 : s.length);
+                        add_node(s.name, len);
+                        });
+
+                // Each thread decodes the paths it indexes from the graph.
+                path_names = gg.path_names();
+                path_steps.resize(path_names.size());
+                path_offsets.resize(path_names.size());
+                std::vector<char> complete(path_names.size(), 1);
+
+                #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+                for (std::size_t i = 0; i < path_names.size(); ++i){
+                    path_elem p;
+                    gg.get_path(path_names[i], p);
+                    complete[i] = index_path(p, path_steps[i], path_offsets[i]);
+                }
+
+                // Paths that step on segments absent from the graph get those
+                // segments added as zero-length placeholders, then are re-indexed.
+                for (std::size_t i = 0; i < path_names.size(); ++i){
+                    path_to_rank[path_names[i]] = i;
+                    if (!complete[i]){
+                        path_elem p;
+                        gg.get_path(path_names[i], p);
+                        for (auto& n : p.segment_names){
+                            if (node_to_rank.find(n) == node_to_rank.end()){
+                                std::cerr << "Warning: path " << path_names[i] << " references missing segment " <<
+                                    n << "; indexing it with length 0." << std::endl;
+                                add_node(n, 0);
+                            }
+                        }
+                        index_path(p, path_steps[i], path_offsets[i]);
+                    }
+                }
+
+                // Build the occurrence table with a counting sort over segment ranks.
+                // Walking the paths in order leaves each segment's occurrences
+                // sorted by (path, step).
+                occurrence_starts.assign(node_names.size() + 1, 0);
+                for (auto& steps : path_steps){
+                    for (auto& h : steps){
+                        ++occurrence_starts[(h >> 1) + 1];
+                    }
+                }
+                for (std::size_t i = 1; i < occurrence_starts.size(); ++i){
+                    occurrence_starts[i] += occurrence_starts[i - 1];
+                }
+                occurrences.resize(occurrence_starts.back());
+                std::vector<std::uint64_t> fill(occurrence_starts.begin(), occurrence_starts.end() - 1);
+                for (std::uint32_t p = 0; p < path_steps.size(); ++p){
+                    for (std::uint64_t s = 0; s < path_steps[p].size(); ++s){
+                        path_step_t& o = occurrences[fill[path_steps[p][s] >> 1]++];
+                        o.path_rank = p;
+                        o.step_rank = s;
+                    }
+                }
+            }
+
+            inline void clear(){
+                node_names.clear();
+                node_lengths.clear();
+                node_to_rank.clear();
+                path_names.clear();
+                path_to_rank.clear();
+                path_steps.clear();
+                path_offsets.clear();
+                occurrence_starts.clear();
+                occurrences.clear();
+            }
+
+            /** Path-level accessors **/
+            inline std::size_t path_count() const{
+                return path_names.size();
+            }
+            inline bool has_path(const std::string& path_name) const{
+                return path_to_rank.find(path_name) != path_to_rank.end();
+            }
+            inline std::uint32_t path_rank(const std::string& path_name) const{
+                return path_to_rank.at(path_name);
+            }
+            inline const std::string& path_name(const std::uint32_t& path_rank) const{
+                return path_names[path_rank];
+            }
+            inline std::uint64_t path_length(const std::string& path_name) const{
+                return path_offsets[path_rank(path_name)].back();
+            }
+            inline std::uint64_t step_count(const std::string& path_name) const{
+                return path_steps[path_rank(path_name)].size();
+            }
+
+            /** Step-level accessors **/
+            inline const std::string& step_segment(const path_step_t& step) const{
+                return node_names[path_steps[step.path_rank][step.step_rank] >> 1];
+            }
+            inline bool step_is_forward(const path_step_t& step) const{
+                return !(path_steps[step.path_rank][step.step_rank] & 1);
+            }
+            // 0-based offset of the first base of the step on its path.
+            inline std::uint64_t step_offset(const path_step_t& step) const{
+                return path_offsets[step.path_rank][step.step_rank];
+            }
+            inline std::uint64_t step_length(const path_step_t& step) const{
+                return path_offsets[step.path_rank][step.step_rank + 1] -
+                    path_offsets[step.path_rank][step.step_rank];
+            }
+
+            /**
+             *  Find the step covering the 0-based <offset> on path <path_name>.
+             *  Returns false if the path doesn't exist or the offset lies past its end.
+             */
+            inline bool step_at_offset(const std::string& path_name, const std::uint64_t& offset, path_step_t& step) const{
+                auto p = path_to_rank.find(path_name);
+                if (p == path_to_rank.end()){
+                    return false;
+                }
+                const std::vector<std::uint64_t>& offs = path_offsets[p->second];
+                if (offset >= offs.back()){
+                    return false;
+                }
+                // The last prefix sum <= offset; zero-length steps are skipped
+                // because upper_bound lands past them.
+                auto it = std::upper_bound(offs.begin(), offs.end(), offset);
+                step.path_rank = p->second;
+                step.step_rank = (it - offs.begin()) - 1;
+                return true;
+            }
+
+            /**
+             *  All (path, step) occurrences of a segment, sorted by path and step.
+             *  begin and end are set to the bounds of the occurrence list; both
+             *  are null if the segment is not in the index.
+             */
+            inline void segment_occurrences(const std::string& segment_name,
+                    const path_step_t*& begin, const path_step_t*& end) const{
+                begin = end = nullptr;
+                auto r = node_to_rank.find(segment_name);
+                if (r == node_to_rank.end() || occurrences.empty()){
+                    return;
+                }
+                begin = occurrences.data() + occurrence_starts[r->second];
+                end = occurrences.data() + occurrence_starts[r->second + 1];
+            }
+
+            /**
+             *  The 0-based offsets at which a segment occurs on a single path,
+             *  in path order.
+             */
+            inline std::vector<std::uint64_t> segment_offsets(const std::string& segment_name, const std::string& path_name) const{
+                std::vector<std::uint64_t> ret;
+                auto p = path_to_rank.find(path_name);
+                if (p == path_to_rank.end()){
+                    return ret;
+                }
+                const path_step_t* b;
+                const path_step_t* e;
+                segment_occurrences(segment_name, b, e);
+                if (b == nullptr){
+                    return ret;
+                }
+                std::uint32_t rank = p->second;
+                const path_step_t* lo = std::lower_bound(b, e, rank, [](const path_step_t& s, const std::uint32_t& r){
+                        return s.path_rank < r;
+                        });
+                for (; lo != e && lo->path_rank == rank; ++lo){
+                    ret.push_back(step_offset(*lo));
+                }
+                return ret;
+            }
+
+            /**
+             *  Find the first and last steps overlapping the 0-based, half-open
+             *  interval [start, end) on path <path_name>. The interval is clipped
+             *  to the end of the path. Returns false if no step overlaps it.
+             */
+            inline bool steps_in_range(const std::string& path_name, const std::uint64_t& start, std::uint64_t end,
+                    path_step_t& first, path_step_t& last) const{
+                if (!has_path(path_name)){
+                    return false;
+                }
+                end = std::min(end, path_length(path_name));
+                if (start >= end || !step_at_offset(path_name, start, first)){
+                    return false;
+                }
+                step_at_offset(path_name, end - 1, last);
+                return true;
+            }
+    };
+
+    /**
+     *  Parse a region string of the form "path", "path:start" or "path:start-end"
+     *  (1-based, inclusive, commas allowed in the coordinates) to a path name and a
+     *  0-based, half-open interval. The last ':' separates the path name from
+     *  the coordinates, so path names may themselves contain ':'.
+     *  Returns false if the coordinates are malformed.
+     */
+    inline bool parse_region(const std::string& region, std::string& path_name,
+            std::uint64_t& start, std::uint64_t& end){
+        start = 0;
+        end = UINT64_MAX;
+        std::size_t colon = region.rfind(':');
+        if (colon == std::string::npos){
+            path_name = region;
+            return !path_name.empty();
+        }
+        path_name = region.substr(0, colon);
+        std::string coords;
+        for (std::size_t i = colon + 1; i < region.length(); ++i){
+            if (region[i] != ','){
+                coords.push_back(region[i]);
+            }
+        }
+        std::size_t dash = coords.find('-');
+        std::string s = coords.substr(0, dash);
+        std::string e = dash == std::string::npos ? "" : coords.substr(dash + 1);
+        if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos ||
+                e.find_first_not_of("0123456789") != std::string::npos){
+            return false;
+        }
+        start = std::stoull(s);
+        if (start == 0){
+            return false;
+        }
+        --start;
+        if (!e.empty()){
+            end = std::stoull(e);
+        }
+        return end > start && !path_name.empty();
+    }
+
+    /**
+     *  Write the sequence of the interval [start, end) of a path to seq.
+     *  Reverse steps contribute their reverse complement.
+     *  Returns false if the path or interval is invalid or if a step
+     *  lacks a sequence.
+     */
+    inline bool region_sequence(const GFAKluge& gg, const path_position_index& pi,
+            const std::string& path_name, const std::uint64_t& start, const std::uint64_t& end,
+            std::string& seq){
+        path_step_t first;
+        path_step_t last;
+        seq.clear();
+        if (!pi.steps_in_range(path_name, start, end, first, last)){
+            return false;
+        }
+        std::uint64_t clipped_end = std::min(end, pi.path_length(path_name));
+        seq.reserve(clipped_end - start);
+        path_step_t step = first;
+        for (; step.step_rank <= last.step_rank; ++step.step_rank){
+            const sequence_elem* s = gg.find_sequence(pi.step_segment(step));
+            std::uint64_t len = pi.step_length(step);
+            if (s == nullptr || s->sequence == "*" || s->sequence.length() != len){
+                std::cerr << "Error: segment " << pi.step_segment(step) << " on path " << path_name <<
+                    " has no sequence." << std::endl;
+                return false;
+            }
+            std::uint64_t off = pi.step_offset(step);
+            std::uint64_t b = start > off ? start - off : 0;
+            std::uint64_t e = std::min(len, clipped_end - off);
+            std::size_t pos = seq.length();
+            seq.resize(pos + (e - b));
+            if (pi.step_is_forward(step)){
+                seq.replace(pos, e - b, s->sequence, b, e - b);
+            }
+            else{
+                // Offsets on a reverse step count from the end of the segment.
+                reverse_complement(s->sequence.c_str() + (len - e), e - b, &seq[pos]);
+            }
+        }
+        return true;
+    }
+
+    /**
+     *  Extract the subgraph spanning [start, end) on path <path_name> into out.
+     *  out receives every segment with a step in the interval, the edges, gaps and
+     *  fragments among those segments, and every path that visits them, cut into
+     *  the sub-walks that stay within the retained segments.
+     *
+     *  Sub-walks are named "<path>:<start>-<end>" in 1-based inclusive
+     *  path coordinates, except when a path is retained whole.
+     *  Returns false if the interval does not overlap the path.
+     */
+    inline bool extract_region(const GFAKluge& gg, const path_position_index& pi,
+            const std::string& path_name, const std::uint64_t& start, const std::uint64_t& end,
+            GFAKluge& out){
+        path_step_t first;
+        path_step_t last;
+        if (!pi.steps_in_range(path_name, start, end, first, last)){
+            return false;
+        }
+
+        std::unordered_set<std::string> kept;
+        path_step_t step = first;
+        for (; step.step_rank <= last.step_rank; ++step.step_rank){
+            kept.insert(pi.step_segment(step));
+        }
+        // Emit segments in graph order.
+        std::vector<std::string> kept_sorted(kept.begin(), kept.end());
+        std::sort(kept_sorted.begin(), kept_sorted.end(), custom_key());
+
+        // Collect every step of every path that lands on a kept segment.
+        std::map<std::uint32_t, std::vector<std::uint64_t> > path_to_steps;
+        for (auto& name : kept_sorted){
+            const sequence_elem* s = gg.find_sequence(name);
+            if (s != nullptr){
+                out.add_sequence(*s);
+            }
+            gg.for_each_edge(name, [&](const edge_elem& e){
+                    if (kept.count(e.sink_name)){
+                        out.add_edge(name, e);
+                    }
+                    });
+            gg.for_each_gap(name, [&](const gap_elem& g){
+                    if (kept.count(g.sink_name)){
+                        out.add_gap(g);
+                    }
+                    });
+            gg.for_each_fragment(name, [&](const fragment_elem& f){
+                    out.add_fragment(name, f);
+                    });
+            const path_step_t* b;
+            const path_step_t* e;
+            pi.segment_occurrences(name, b, e);
+            for (; b != e; ++b){
+                path_to_steps[b->path_rank].push_back(b->step_rank);
+            }
+        }
+
+        // Cut each path into runs of consecutive kept steps.
+        for (auto& ps : path_to_steps){
+            const std::string& pname = pi.path_name(ps.first);
+            path_elem orig;
+            gg.get_path(pname, orig);
+            std::vector<std::uint64_t>& steps = ps.second;
+            std::sort(steps.begin(), steps.end());
+            bool has_overlaps = orig.overlaps.size() == orig.segment_names.size();
+            std::size_t i = 0;
+            while (i < steps.size()){
+                std::size_t j = i;
+                while (j + 1 < steps.size() && steps[j + 1] == steps[j] + 1){
+                    ++j;
+                }
+                path_elem p;
+                p.opt_fields = orig.opt_fields;
+                for (std::uint64_t s = steps[i]; s <= steps[j]; ++s){
+                    p.segment_names.push_back(orig.segment_names[s]);
+                    p.orientations.push_back(orig.orientations[s]);
+                    if (has_overlaps){
+                        p.overlaps.push_back(orig.overlaps[s]);
+                    }
+                }
+                if (steps[i] == 0 && steps[j] + 1 == orig.segment_names.size()){
+                    p.name = pname;
+                }
+                else{
+                    path_step_t b;
+                    b.path_rank = ps.first;
+                    b.step_rank = steps[i];
+                    path_step_t e = b;
+                    e.step_rank = steps[j];
+                    p.name = pname + ":" + std::to_string(pi.step_offset(b) + 1) + "-" +
+                        std::to_string(pi.step_offset(e) + pi.step_length(e));
+                }
+                out.add_path(p.name, p);
+                i = j + 1;
+            }
+        }
+        return true;
+    }
+
+}
+
+#endif
@@ -0,0 +1,374 @@
+#ifndef GFA_STATS_HPP
+#define GFA_STATS_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include "gfa_kernels.hpp"
+#include "gfa_stream.hpp"
+
+namespace gfak{
+
+    /**
+     *  Counts and segment length distribution gathered in a single pass over
+     *  the records of a GFA file, without building a GFAKluge object.
+     *  Memory use is constant unless segment lengths are kept (for N50 and friends),
+     *  which costs 8 bytes per segment.
+     */
+    struct gfa_stream_stats{
+        std::uint64_t segments = 0;
+        std::uint64_t links = 0;
+        std::uint64_t containments = 0;
+        // GFA2 E lines that are neither dovetails nor containments.
+        std::uint64_t other_edges = 0;
+        // P and W lines (GFA1), and O lines (GFA2).
+        std::uint64_t paths = 0;
+        std::uint64_t path_steps = 0;
+        // Per-step P and W lines of GFA 0.1.
+        std::uint64_t walk_steps = 0;
+        std::uint64_t unordered_groups = 0;
+        std::uint64_t fragments = 0;
+        std::uint64_t gaps = 0;
+
+        // Segment lengths; segments with neither a sequence nor a length are not included.
+        std::uint64_t total_length = 0;
+        std::uint64_t segments_without_length = 0;
+        std::uint64_t min_length = UINT64_MAX;
+        std::uint64_t max_length = 0;
+        // length_histogram[i] counts segments of length [2^(i-1), 2^i), and [0] counts length 0.
+        std::vector<std::uint64_t> length_histogram = std::vector<std::uint64_t>(65, 0);
+        bool keep_lengths = false;
+        std::vector<std::uint64_t> lengths;
+
+        bool count_composition = false;
+        base_composition composition;
+
+        inline std::uint64_t edges() const{
+            return links + containments + other_edges;
+        }
+        inline double mean_length() const{
+            std::uint64_t n = segments - segments_without_length;
+            return n > 0 ? (double) total_length / n : 0.0;
+        }
+
+        inline void add_length(const std::uint64_t& len){
+            total_length += len;
+            min_length = std::min(min_length, len);
+            max_length = std::max(max_length, len);
+            ++length_histogram[len == 0 ? 0 : 64 - __builtin_clzll(len)];
+            if (keep_lengths){
+                lengths.push_back(len);
+            }
+        }
+
+        inline gfa_stream_stats& operator+=(const gfa_stream_stats& o){
+            segments += o.segments;
+            links += o.links;
+            containments += o.containments;
+            other_edges += o.other_edges;
+            paths += o.paths;
+            path_steps += o.path_steps;
+            walk_steps += o.walk_steps;
+            unordered_groups += o.unordered_groups;
+            fragments += o.fragments;
+            gaps += o.gaps;
+            total_length += o.total_length;
+            segments_without_length += o.segments_without_length;
+            min_length = std::min(min_length, o.min_length);
+            max_length = std::max(max_length, o.max_length);
+            for (std::size_t i = 0; i < length_histogram.size(); ++i){
+                length_histogram[i] += o.length_histogram[i];
+            }
+            lengths.insert(lengths.end(), o.lengths.begin(), o.lengths.end());
+            composition += o.composition;
+            return *this;
+        }
+
+        /** Tally a single GFA record (one line, without its newline). **/
+        inline void add_record(const char* line, std::size_t len){
+            if (len == 0){
+                return;
+            }
+            field_view f[9];
+            std::size_t n;
+            switch (line[0]){
+                case 'S':
+                    n = split_fields(line, len, f, 5);
+                    if (n < 3){
+                        return;
+                    }
+                    ++segments;
+                    // GFA2: S <name> <length> <sequence>
+                    if (n >= 4 && f[2].is_number()){
+                        add_length(f[2].to_uint());
+                        if (count_composition && f[3] != "*"){
+                            add_composition(f[3].data, f[3].length, composition);
+                        }
+                    }
+                    else if (f[2] != "*"){
+                        add_length(f[2].length);
+                        if (count_composition){
+                            add_composition(f[2].data, f[2].length, composition);
+                        }
+                    }
+                    else{
+                        // GFA1 segment without sequence: look for an LN tag.
+                        const char* tags = f[2].data + f[2].length;
+                        const char* end = line + len;
+                        const char* ln = nullptr;
+                        for (const char* p = tags; p + 6 <= end; ++p){
+                            if (p[0] == '\t' && std::memcmp(p + 1, "LN:i:", 5) == 0){
+                                ln = p + 6;
+                                break;
+                            }
+                        }
+                        if (ln != nullptr){
+                            add_length(field_view(ln, end - ln).to_uint());
+                        }
+                        else{
+                            ++segments_without_length;
+                        }
+                    }
+                    break;
+                case 'L':
+                    ++links;
+                    break;
+                case 'C':
+                    ++containments;
+                    break;
+                case 'E':
+                    n = split_fields(line, len, f, 9);
+                    if (n < 8){
+                        return;
+                    }
+                    else{
+                        // An alignment reaching a segment end is marked with '$'.
+                        bool b1 = f[4].to_uint() == 0, e1 = f[5].back() == '$';
+                        bool b2 = f[6].to_uint() == 0, e2 = f[7].back() == '$';
+                        if ((b1 && e1) || (b2 && e2)){
+                            ++containments;
+                        }
+                        else if ((b1 || e1) && (b2 || e2)){
+                            ++links;
+                        }
+                        else{
+                            ++other_edges;
+                        }
+                    }
+                    break;
+                case 'P':
+                    n = split_fields(line, len, f, 4);
+                    // GFA1: P <name> <seg+>,<seg->... ; GFA 0.1: P <segment> <path> [rank] <orientation> <overlap>
+                    if (n >= 3 && !f[2].empty() && (f[2].back() == '+' || f[2].back() == '-')){
+                        ++paths;
+                        path_steps += 1 + std::count(f[2].data, f[2].data + f[2].length, ',');
+                    }
+                    else{
+                        ++walk_steps;
+                    }
+                    break;
+                case 'W':
+                    n = split_fields(line, len, f, 8);
+                    // GFA1.1: W <sample> <hap> <seq> <start> <end> <walk>
+                    if (n >= 7){
+                        ++paths;
+                        path_steps += std::count(f[6].data, f[6].data + f[6].length, '>') +
+                            std::count(f[6].data, f[6].data + f[6].length, '<');
+                    }
+                    else{
+                        ++walk_steps;
+                    }
+                    break;
+                case 'O':
+                    n = split_fields(line, len, f, 4);
+                    ++paths;
+                    if (n >= 3){
+                        path_steps += 1 + std::count(f[2].data, f[2].data + f[2].length, ' ');
+                    }
+                    break;
+                case 'U':
+                    ++unordered_groups;
+                    break;
+                case 'F':
+                    ++fragments;
+                    break;
+                case 'G':
+                    ++gaps;
+                    break;
+                default:
+                    break;
+            }
+        }
+    };
+
+    /**
+     *  Gather gfa_stream_stats for a GFA file ("-" for stdin) in one pass,
+     *  reading chunks of the file on up to <threads> threads.
+     *  Returns false if the file cannot be read.
+     */
+    inline bool stream_stats(const std::string& filename, gfa_stream_stats& stats, int threads = 1){
+        int max_chunks = threads > 1 ? threads : 1;
+        std::vector<gfa_stream_stats> chunk_stats(max_chunks);
+        for (auto& c : chunk_stats){
+            c.keep_lengths = stats.keep_lengths;
+            c.count_composition = stats.count_composition;
+        }
+        int chunks = for_each_line_in_file(filename, threads, [&](const char* line, std::size_t len, int chunk){
+                chunk_stats[chunk].add_record(line, len);
+                });
+        if (chunks == 0){
+            return false;
+        }
+        std::size_t total_segments = 0;
+        for (auto& c : chunk_stats){
+            total_segments += c.lengths.size();
+        }
+        stats.lengths.reserve(stats.lengths.size() + total_segments);
+        for (int c = 0; c < chunks; ++c){
+            stats += chunk_stats[c];
+            std::vector<std::uint64_t>().swap(chunk_stats[c].lengths);
+        }
+        return true;
+    }
+
+    /**
+     *  Sort v in ascending order with an LSD radix sort on 11-bit digits,
+     *  using only as many passes as the largest value needs (three for
+     *  lengths below 8 Gbp). Small inputs fall back to std::sort.
+     */
+    inline void radix_sort(std::vector<std::uint64_t>& v){
+        if (v.size() < 4096){
+            std::sort(v.begin(), v.end());
+            return;
+        }
+        const int digit_bits = 11;
+        const std::size_t buckets = 1 << digit_bits;
+        std::uint64_t max_value = *std::max_element(v.begin(), v.end());
+        // Left uninitialized; every pass overwrites it completely.
+        std::unique_ptr<std::uint64_t[]> buf(new std::uint64_t[v.size()]);
+        std::uint64_t* src = v.data();
+        std::uint64_t* dst = buf.get();
+        std::vector<std::size_t> counts(buckets);
+        for (int shift = 0; shift < 64 && (max_value >> shift) > 0; shift += digit_bits){
+            std::fill(counts.begin(), counts.end(), 0);
+            for (std::size_t i = 0; i < v.size(); ++i){
+                ++counts[(src[i] >> shift) & (buckets - 1)];
+            }
+            std::size_t offset = 0;
+            for (auto& c : counts){
+                std::size_t n = c;
+                c = offset;
+                offset += n;
+            }
+            for (std::size_t i = 0; i < v.size(); ++i){
+                dst[counts[(src[i] >> shift) & (buckets - 1)]++] = src[i];
+            }
+            std::swap(src, dst);
+        }
+        if (src != v.data()){
+            std::copy(src, src + v.size(), v.data());
+        }
+    }
+
+    /**
+     *  Contiguity statistics of a set of segment lengths.
+     *  For each requested x, nx[i] / lx[i] are the Nx / Lx: the length L such that
+     *  segments of length >= L hold at least x% of the total length, and the number
+     *  of such segments. ngx / lgx are the same relative to genome_size (NGx / LGx),
+     *  and are 0 when the segments don't reach x% of it.
+     *  auN is the area under the Nx curve (sum of squared lengths / total length);
+     *  auNG uses genome_size as the denominator.
+     */
+    struct contiguity_stats{
+        std::uint64_t count = 0;
+        std::uint64_t total = 0;
+        std::uint64_t genome_size = 0;
+        std::vector<double> xs;
+        std::vector<std::uint64_t> nx;
+        std::vector<std::uint64_t> lx;
+        std::vector<std::uint64_t> ngx;
+        std::vector<std::uint64_t> lgx;
+        double auN = 0.0;
+        double auNG = 0.0;
+        // histogram[i] counts segments of length [2^(i-1), 2^i), and [0] counts length 0.
+        std::vector<std::uint64_t> histogram = std::vector<std::uint64_t>(65, 0);
+
+        /** The Nx or Lx for a value of x passed to contiguity(); 0 if x was not requested. **/
+        inline std::uint64_t get_nx(const double& x) const{
+            for (std::size_t i = 0; i < xs.size(); ++i){
+                if (xs[i] == x){
+                    return nx[i];
+                }
+            }
+            return 0;
+        }
+        inline std::uint64_t get_lx(const double& x) const{
+            for (std::size_t i = 0; i < xs.size(); ++i){
+                if (xs[i] == x){
+                    return lx[i];
+                }
+            }
+            return 0;
+        }
+    };
+
+    /**
+     *  Compute contiguity_stats for every x in xs (percentages) with a single
+     *  sort and a single pass over lengths, which is sorted in place.
+     *  genome_size defaults to the total length.
+     */
+    inline contiguity_stats contiguity(std::vector<std::uint64_t>& lengths, const std::vector<double>& xs,
+            const std::uint64_t& genome_size = 0){
+        contiguity_stats c;
+        c.count = lengths.size();
+        c.xs = xs;
+        c.nx.assign(xs.size(), 0);
+        c.lx.assign(xs.size(), 0);
+        c.ngx.assign(xs.size(), 0);
+        c.lgx.assign(xs.size(), 0);
+
+        radix_sort(lengths);
+        double squares = 0.0;
+        for (auto l : lengths){
+            c.total += l;
+            squares += (double) l * l;
+            ++c.histogram[l == 0 ? 0 : 64 - __builtin_clzll(l)];
+        }
+        c.genome_size = genome_size > 0 ? genome_size : c.total;
+        c.auN = c.total > 0 ? squares / c.total : 0.0;
+        c.auNG = c.genome_size > 0 ? squares / c.genome_size : 0.0;
+
+        // Visit thresholds in increasing order while walking from the longest segment down.
+        std::vector<std::size_t> order(xs.size());
+        for (std::size_t i = 0; i < order.size(); ++i){
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](const std::size_t& a, const std::size_t& b){
+                return xs[a] < xs[b];
+                });
+        std::size_t next_n = 0;
+        std::size_t next_ng = 0;
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = lengths.size(); i-- > 0 && (next_n < order.size() || next_ng < order.size());){
+            cumulative += lengths[i];
+            std::uint64_t rank = lengths.size() - i;
+            while (next_n < order.size() && cumulative >= c.total * xs[order[next_n]] / 100.0){
+                c.nx[order[next_n]] = lengths[i];
+                c.lx[order[next_n]] = rank;
+                ++next_n;
+            }
+            while (next_ng < order.size() && cumulative >= c.genome_size * xs[order[next_ng]] / 100.0){
+                c.ngx[order[next_ng]] = lengths[i];
+                c.lgx[order[next_ng]] = rank;
+                ++next_ng;
+            }
+        }
+        return c;
+    }
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef GFA_STREAM_HPP
+#define GFA_STREAM_HPP
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace gfak{
+
+    /** A (pointer, length) view into a line; GFA fields are not NUL-terminated. **/
+    struct field_view{
+        const char* data = nullptr;
+        std::size_t length = 0;
+
+        field_view(){
+
+        }
+        field_view(const char* d, std::size_t l) : data(d), length(l){
+
+        }
+        inline bool empty() const{
+            return length == 0;
+        }
+        inline char front() const{
+            return data[0];
+        }
+        inline char back() const{
+            return data[length - 1];
+        }
+        inline bool operator==(const char* s) const{
+            return std::strlen(s) == length && std::memcmp(data, s, length) == 0;
+        }
+        inline bool operator!=(const char* s) const{
+            return !(*this == s);
+        }
+        inline bool starts_with(const char* s) const{
+            std::size_t l = std::strlen(s);
+            return l <= length && std::memcmp(data, s, l) == 0;
+        }
+        inline bool is_number() const{
+            if (length == 0){
+                return false;
+            }
+            for (std::size_t i = 0; i < length; ++i){
+                if (data[i] < '0' || data[i] > '9'){
+                    return false;
+                }
+            }
+            return true;
+        }
+        /** Parse a leading unsigned integer, ignoring any trailing '$'. **/
+        inline std::uint64_t to_uint() const{
+            std::uint64_t v = 0;
+            for (std::size_t i = 0; i < length && data[i] >= '0' && data[i] <= '9'; ++i){
+                v = v * 10 + (data[i] - '0');
+            }
+            return v;
+        }
+        inline std::string str() const{
+            return std::string(data, length);
+        }
+    };
+
+    /**
+     *  Split a tab-separated line into at most max_fields fields. The last
+     *  field holds the remainder of the line. Returns the number of fields.
+     */
+    inline std::size_t split_fields(const char* line, std::size_t len, field_view* fields, std::size_t max_fields){
+        std::size_t n = 0;
+        const char* end = line + len;
+        while (n < max_fields){
+            const char* tab = n + 1 == max_fields ? nullptr : (const char*) std::memchr(line, '\t', end - line);
+            if (tab == nullptr){
+                fields[n++] = field_view(line, end - line);
+                break;
+            }
+            fields[n++] = field_view(line, tab - line);
+            line = tab + 1;
+        }
+        return n;
+    }
+
+    /** A read-only memory mapping of a file. **/
+    class mapped_file{
+        private:
+            int fd = -1;
+            char* buf = nullptr;
+            std::size_t fsize = 0;
+        public:
+            mapped_file(){
+
+            }
+            ~mapped_file(){
+                close();
+            }
+            mapped_file(const mapped_file&) = delete;
+            mapped_file& operator=(const mapped_file&) = delete;
+
+            /** Map filename; returns false if it cannot be opened or mapped. **/
+            inline bool open(const std::string& filename){
+                close();
+                fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd == -1){
+                    return false;
+                }
+                struct stat stats;
+                if (fstat(fd, &stats) == -1 || !S_ISREG(stats.st_mode)){
+                    close();
+                    return false;
+                }
+                fsize = stats.st_size;
+                if (fsize > 0){
+                    void* m = mmap(NULL, fsize, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (m == MAP_FAILED){
+                        close();
+                        return false;
+                    }
+                    buf = (char*) m;
+                    madvise(buf, fsize, MADV_SEQUENTIAL | MADV_WILLNEED);
+                }
+                return true;
+            }
+            inline void close(){
+                if (buf != nullptr){
+                    munmap(buf, fsize);
+                    buf = nullptr;
+                }
+                if (fd != -1){
+                    ::close(fd);
+                    fd = -1;
+                }
+                fsize = 0;
+            }
+            inline const char* data() const{
+                return buf;
+            }
+            inline std::size_t size() const{
+                return fsize;
+            }
+            inline bool is_open() const{
+                return fd != -1;
+            }
+    };
+
+    /**
+     *  True if filename can be memory-mapped, and so read more than once.
+     *  "-", pipes and process substitutions can't; anything that makes two
+     *  passes over a file has to check this first.
+     */
+    inline bool is_mappable_file(const std::string& filename){
+        mapped_file mf;
+        return filename != "-" && mf.open(filename);
+    }
+
+    /** Make an empty temporary file in $TMPDIR (or /tmp) and return its name. **/
+    inline std::string make_temp_file(){
+        const char* tmpdir = std::getenv("TMPDIR");
+        std::string tmpl = std::string(tmpdir != NULL && *tmpdir != '\0' ? tmpdir : "/tmp") + "/gfak_XXXXXX";
+        std::vector<char> name(tmpl.begin(), tmpl.end());
+        name.push_back('\0');
+        int fd = mkstemp(name.data());
+        if (fd == -1){
+            std::cerr << "ERROR: could not create a temporary file in " << tmpl << std::endl;
+            exit(1);
+        }
+        ::close(fd);
+        return std::string(name.data());
+    }
+
+    /**
+     *  Call func(line, length, chunk) on every line of a GFA file, without the
+     *  trailing newline (or carriage return). Regular files are memory-mapped
+     *  and split at line boundaries into up to <threads> chunks, each of which
+     *  is read by its own thread, so func must be safe to call concurrently for
+     *  different chunk indices; lines within a chunk are visited in order.
+     *  "-" and other unmappable inputs (e.g. pipes) are read line by line as chunk 0.
+     *  Returns the number of chunks used, or 0 if the file cannot be opened.
+     */
+    inline int for_each_line_in_file(const std::string& filename, int threads,
+            const std::function<void(const char*, std::size_t, int)>& func){
+        mapped_file mf;
+        if (filename == "-" || !mf.open(filename)){
+            std::ifstream gfi;
+            std::istream* in = &std::cin;
+            if (filename != "-"){
+                gfi.open(filename.c_str(), std::ifstream::in);
+                if (!gfi.good()){
+                    return 0;
+                }
+                in = &gfi;
+            }
+            std::string line;
+            while (std::getline(*in, line)){
+                std::size_t len = line.length();
+                if (len > 0 && line[len - 1] == '\r'){
+                    --len;
+                }
+                func(line.c_str(), len, 0);
+            }
+            return 1;
+        }
+
+        const char* buf = mf.data();
+        std::size_t fsize = mf.size();
+        int chunks = threads > 1 ? threads : 1;
+        // Don't split files into chunks smaller than 1 MB.
+        std::size_t max_chunks = std::max<std::size_t>(1, fsize >> 20);
+        if ((std::size_t) chunks > max_chunks){
+            chunks = max_chunks;
+        }
+        std::vector<std::size_t> starts(chunks + 1, fsize);
+        starts[0] = 0;
+        for (int c = 1; c < chunks; ++c){
+            std::size_t pos = std::max(starts[c - 1], fsize / chunks * c);
+            const char* nl = pos < fsize ? (const char*) std::memchr(buf + pos, '\n', fsize - pos) : nullptr;
+            starts[c] = nl == nullptr ? fsize : nl - buf + 1;
+        }
+
+        #pragma omp parallel for schedule(static, 1) num_threads(chunks)
+        for (int c = 0; c < chunks; ++c){
+            const char* p = buf + starts[c];
+            const char* end = buf + starts[c + 1];
+            while (p < end){
+                const char* nl = (const char*) std::memchr(p, '\n', end - p);
+                const char* line_end = nl == nullptr ? end : nl;
+                std::size_t len = line_end - p;
+                if (len > 0 && p[len - 1] == '\r'){
+                    --len;
+                }
+                func(p, len, c);
+                p = line_end + 1;
+            }
+        }
+        return chunks;
+    }
+
+}
+
+#endif
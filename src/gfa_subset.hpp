@@ -0,0 +1,354 @@
+#ifndef GFA_SUBSET_HPP
+#define GFA_SUBSET_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <unordered_set>
+#include "gfa_stream.hpp"
+#include "gfa_ids.hpp"
+
+namespace gfak{
+
+    /**
+     *  The segments to keep in a subset: either the numeric IDs in the
+     *  inclusive range [start, end], or the names listed in a node-list file.
+     */
+    struct node_selection{
+        std::uint64_t start = 0;
+        std::uint64_t end = UINT64_MAX;
+        bool use_names = false;
+        std::unordered_set<std::string> names;
+
+        /**
+         *  Select the segments named in node_file, one per line (only the first
+         *  whitespace-separated word of a line is read, and blank lines and
+         *  lines starting with '#' are skipped). Returns false if the file
+         *  can't be read.
+         */
+        inline bool load_names(const std::string& node_file){
+            std::ifstream fi(node_file.c_str());
+            if (!fi.good()){
+                return false;
+            }
+            use_names = true;
+            std::string line;
+            while (std::getline(fi, line)){
+                std::size_t b = line.find_first_not_of(" \t\r");
+                if (b == std::string::npos || line[b] == '#'){
+                    continue;
+                }
+                std::size_t e = line.find_first_of(" \t\r", b);
+                names.insert(line.substr(b, e == std::string::npos ? std::string::npos : e - b));
+            }
+            return true;
+        }
+
+        /** True if the segment named by the len bytes at id is selected. **/
+        inline bool contains(const char* id, std::size_t len) const{
+            if (use_names){
+                return names.count(std::string(id, len)) > 0;
+            }
+            field_view v(id, len);
+            if (!v.is_number()){
+                return false;
+            }
+            std::uint64_t x = v.to_uint();
+            return x >= start && x <= end;
+        }
+
+        /** As contains, for a reference with a trailing orientation (e.g. 12+). **/
+        inline bool contains_oriented(const char* ref, std::size_t len) const{
+            if (len > 0 && (ref[len - 1] == '+' || ref[len - 1] == '-')){
+                --len;
+            }
+            return contains(ref, len);
+        }
+    };
+
+    /** Split the sep-separated list at list into items. **/
+    inline void split_list(const char* list, std::size_t len, char sep, std::vector<field_view>& items){
+        items.clear();
+        const char* end = list + len;
+        while (list < end){
+            const char* next = (const char*) std::memchr(list, sep, end - list);
+            const char* item_end = next == nullptr ? end : next;
+            items.push_back(field_view(list, item_end - list));
+            if (next == nullptr){
+                break;
+            }
+            list = next + 1;
+        }
+    }
+
+    /** Append items [b, e) to out, separated by sep. **/
+    inline void append_items(std::string& out, const std::vector<field_view>& items, std::size_t b, std::size_t e, char sep){
+        for (std::size_t i = b; i < e; ++i){
+            if (i > b){
+                out.push_back(sep);
+            }
+            out.append(items[i].data, items[i].length);
+        }
+    }
+
+    /**
+     *  Fill runs with the [begin, end) ranges of consecutive selected steps.
+     *  Returns true if every step is selected.
+     */
+    template<typename Pred>
+    inline bool selected_runs(const std::vector<field_view>& steps, const Pred& is_selected,
+            std::vector<std::pair<std::size_t, std::size_t>>& runs){
+        runs.clear();
+        std::size_t start = 0;
+        for (std::size_t i = 0; i <= steps.size(); ++i){
+            if (i == steps.size() || !is_selected(steps[i])){
+                if (i > start){
+                    runs.push_back(std::make_pair(start, i));
+                }
+                start = i + 1;
+            }
+        }
+        return runs.size() == 1 && runs[0].first == 0 && runs[0].second == steps.size();
+    }
+
+    /**
+     *  Add the names of the paths, groups and walks of a GFA file to names (a
+     *  walk as "<sample>\t<haplotype>\t<sequence>"). Returns false if the file
+     *  can't be read.
+     */
+    inline bool collect_path_names(const std::string& filename, std::unordered_set<std::string>& names){
+        return for_each_line_in_file(filename, 1, [&](const char* line, std::size_t len, int){
+                if (len < 2 || line[1] != '\t' || (line[0] != 'P' && line[0] != 'O' && line[0] != 'U' && line[0] != 'W')){
+                    return;
+                }
+                field_view f[5];
+                std::size_t nf = split_fields(line, len, f, 5);
+                if (line[0] == 'W'){
+                    if (nf > 3){
+                        names.insert(std::string(f[1].data, f[3].data + f[3].length - f[1].data));
+                    }
+                }
+                // A GFA0.1 path line is named in its third field.
+                else if (line[0] == 'P' && nf > 4 && f[3].length == 1 && (f[3].front() == '+' || f[3].front() == '-')){
+                    names.insert(f[2].str());
+                }
+                else if (nf > 1){
+                    names.insert(f[1].str());
+                }
+                }) != 0;
+    }
+
+    /**
+     *  Append the name of a piece of a path cut into pieces to out: name itself
+     *  if there is one piece, or else <name>_<next>, for the first next
+     *  (counting up) for which <prefix><name>_<next> isn't in taken, which
+     *  then holds it.
+     */
+    inline void append_piece_name(std::string& out, const field_view& prefix, const field_view& name, std::size_t pieces,
+            std::uint64_t& next, std::unordered_set<std::string>& taken){
+        if (pieces == 1){
+            out.append(name.data, name.length);
+            return;
+        }
+        std::string piece;
+        do {
+            piece.assign(prefix.data, prefix.length);
+            piece.append(name.data, name.length);
+            piece.push_back('_');
+            append_uint(piece, next++);
+        } while (!taken.insert(piece).second);
+        out.append(piece, prefix.length, std::string::npos);
+    }
+
+    /**
+     *  Copy the records of a GFA1 or GFA2 file that fall inside sel to os,
+     *  without loading the graph. Segments and fragments are kept if their
+     *  segment is selected, and links, containments, edges and gaps if both
+     *  of their segments are. Paths, walks and ordered groups are cut into the
+     *  runs of consecutive selected steps; a path cut into more than one piece
+     *  has its pieces named <name>_1, <name>_2, ..., skipping names that are
+     *  already taken, and a walk that loses any step has its sequence
+     *  coordinates replaced by "*". Unordered groups keep their selected
+     *  members. Headers and records of other types are copied unchanged.
+     *
+     *  The file is read twice: once for the names of its paths, groups and
+     *  walks, and once to copy it. Memory use is bounded by sel, those names
+     *  and the longest line. Returns false if the file can't be read, or can't
+     *  be read twice (stdin, pipes).
+     */
+    inline bool stream_subset(const std::string& filename, const node_selection& sel, std::ostream& os){
+        std::unordered_set<std::string> taken;
+        if (!is_mappable_file(filename) || !collect_path_names(filename, taken)){
+            return false;
+        }
+        const std::size_t flush_size = 1 << 22;
+        std::string out;
+        out.reserve(flush_size * 2);
+        std::vector<field_view> steps;
+        std::vector<field_view> overlaps;
+        std::vector<std::pair<std::size_t, std::size_t>> runs;
+        auto oriented = [&](const field_view& s){
+            return sel.contains_oriented(s.data, s.length);
+        };
+        auto walk_step = [&](const field_view& s){
+            return s.length > 1 && sel.contains(s.data + 1, s.length - 1);
+        };
+        int n = for_each_line_in_file(filename, 1, [&](const char* line, std::size_t len, int){
+                field_view f[8];
+                std::size_t nf = len > 1 && line[1] == '\t' ? split_fields(line, len, f, 8) : 0;
+                // Everything after the last field a record type reads (its tags).
+                auto tail = [&](std::size_t i){
+                    return field_view(f[i].data + f[i].length, line + len - f[i].data - f[i].length);
+                };
+                bool keep = true;
+                if (nf > 1){
+                    switch (line[0]){
+                        case 'S':
+                        case 'F':
+                            keep = sel.contains(f[1].data, f[1].length);
+                            break;
+                        case 'L':
+                        case 'C':
+                            keep = nf > 3 && sel.contains(f[1].data, f[1].length) && sel.contains(f[3].data, f[3].length);
+                            break;
+                        case 'E':
+                        case 'G':
+                            keep = nf > 3 && oriented(f[2]) && oriented(f[3]);
+                            break;
+                        case 'P':
+                            // A GFA0.1 path line holds one step: P <segment> <path> <orientation> <overlap>.
+                            if (nf > 4 && f[3].length == 1 && (f[3].front() == '+' || f[3].front() == '-')){
+                                keep = sel.contains(f[1].data, f[1].length);
+                            }
+                            else if (nf > 2){
+                                split_list(f[2].data, f[2].length, ',', steps);
+                                keep = selected_runs(steps, oriented, runs);
+                                if (keep){
+                                    break;
+                                }
+                                if (nf > 3 && f[3] != "*"){
+                                    split_list(f[3].data, f[3].length, ',', overlaps);
+                                }
+                                else{
+                                    overlaps.clear();
+                                }
+                                // Overlaps are given between steps, for every step, or once as "*".
+                                bool between = overlaps.size() + 1 == steps.size();
+                                bool each = overlaps.size() == steps.size();
+                                std::uint64_t next = 1;
+                                for (std::size_t r = 0; r < runs.size(); ++r){
+                                    std::size_t b = runs[r].first, e = runs[r].second;
+                                    out.append("P\t");
+                                    append_piece_name(out, field_view(line, 0), f[1], runs.size(), next, taken);
+                                    out.push_back('\t');
+                                    append_items(out, steps, b, e, ',');
+                                    if (nf > 3){
+                                        out.push_back('\t');
+                                        if ((between && e - b > 1) || each){
+                                            append_items(out, overlaps, b, between ? e - 1 : e, ',');
+                                        }
+                                        else{
+                                            out.push_back('*');
+                                        }
+                                    }
+                                    field_view t = tail(nf > 3 ? 3 : 2);
+                                    out.append(t.data, t.length);
+                                    out.push_back('\n');
+                                }
+                            }
+                            break;
+                        case 'O':
+                            if (nf > 2){
+                                split_list(f[2].data, f[2].length, ' ', steps);
+                                keep = selected_runs(steps, oriented, runs);
+                                if (keep){
+                                    break;
+                                }
+                                field_view t = tail(2);
+                                std::uint64_t next = 1;
+                                for (std::size_t r = 0; r < runs.size(); ++r){
+                                    out.append("O\t");
+                                    append_piece_name(out, field_view(line, 0), f[1], runs.size(), next, taken);
+                                    out.push_back('\t');
+                                    append_items(out, steps, runs[r].first, runs[r].second, ' ');
+                                    out.append(t.data, t.length);
+                                    out.push_back('\n');
+                                }
+                            }
+                            break;
+                        case 'U':
+                            if (nf > 2){
+                                split_list(f[2].data, f[2].length, ' ', steps);
+                                keep = selected_runs(steps, oriented, runs);
+                                if (keep || runs.empty()){
+                                    break;
+                                }
+                                out.append(line, f[2].data - line);
+                                bool first = true;
+                                for (auto& s : steps){
+                                    if (oriented(s)){
+                                        if (!first){
+                                            out.push_back(' ');
+                                        }
+                                        out.append(s.data, s.length);
+                                        first = false;
+                                    }
+                                }
+                                field_view t = tail(2);
+                                out.append(t.data, t.length);
+                                out.push_back('\n');
+                            }
+                            break;
+                        case 'W':
+                            if (nf > 6){
+                                steps.clear();
+                                const char* w = f[6].data;
+                                const char* w_end = w + f[6].length;
+                                while (w < w_end){
+                                    const char* step = w++;
+                                    while (w < w_end && *w != '>' && *w != '<'){
+                                        ++w;
+                                    }
+                                    steps.push_back(field_view(step, w - step));
+                                }
+                                keep = selected_runs(steps, walk_step, runs);
+                                if (keep){
+                                    break;
+                                }
+                                field_view t = tail(6);
+                                std::uint64_t next = 1;
+                                for (std::size_t r = 0; r < runs.size(); ++r){
+                                    out.append(line, f[3].data - line);
+                                    append_piece_name(out, field_view(f[1].data, f[3].data - f[1].data), f[3], runs.size(), next, taken);
+                                    out.append("\t*\t*\t");
+                                    for (std::size_t i = runs[r].first; i < runs[r].second; ++i){
+                                        out.append(steps[i].data, steps[i].length);
+                                    }
+                                    out.append(t.data, t.length);
+                                    out.push_back('\n');
+                                }
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                if (keep){
+                    out.append(line, len);
+                    out.push_back('\n');
+                }
+                if (out.length() >= flush_size){
+                    os.write(out.data(), out.length());
+                    out.clear();
+                }
+                });
+        os.write(out.data(), out.length());
+        return n != 0;
+    }
+
+}
+
+#endif
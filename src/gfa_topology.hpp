@@ -0,0 +1,305 @@
+#ifndef GFA_TOPOLOGY_HPP
+#define GFA_TOPOLOGY_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "gfakluge.hpp"
+
+namespace gfak{
+
+    /** Step count and spelled length of a single path. **/
+    struct path_metrics{
+        std::string name;
+        std::uint64_t steps = 0;
+        std::uint64_t reverse_steps = 0;
+        std::uint64_t length = 0;
+    };
+
+    /**
+     *  Degree and topology metrics of a bidirected graph.
+     *
+     *  Each segment has a left side (its start) and a right side (its end).
+     *  A dovetail edge leaves its source from the right side (or the left side
+     *  if the source is reversed) and enters its sink on the left side (or the
+     *  right side if the sink is reversed). The in-degree of a segment is the
+     *  degree of its left side and the out-degree that of its right side, both
+     *  as seen walking the segment forward. Containments do not touch sides.
+     */
+    struct topology_stats{
+        std::uint64_t segments = 0;
+        std::uint64_t dovetails = 0;
+        std::uint64_t containments = 0;
+        // Edges whose source and sink are the same segment.
+        std::uint64_t self_loops = 0;
+        // Edges joining a pair of sides that an earlier edge already joins.
+        std::uint64_t multi_edges = 0;
+        // Sides with no dovetail edges.
+        std::uint64_t dead_ends = 0;
+        // Segments with exactly one side free, and with both sides free.
+        std::uint64_t tips = 0;
+        std::uint64_t isolated = 0;
+        // Edges that name a segment missing from the graph.
+        std::uint64_t dangling_edges = 0;
+        // in_degree[d] / out_degree[d] count segments with left / right side degree d.
+        std::vector<std::uint64_t> in_degree;
+        std::vector<std::uint64_t> out_degree;
+        std::vector<path_metrics> paths;
+
+        inline double mean_degree() const{
+            return segments > 0 ? 2.0 * dovetails / segments : 0.0;
+        }
+    };
+
+    /**
+     *  Compute topology_stats for gg. Edges are gathered once into a
+     *  compressed adjacency list over segment sides, which is then scanned
+     *  on up to <threads> threads, as are the paths.
+     */
+    inline topology_stats compute_topology(const GFAKluge& gg, int threads = 1){
+        topology_stats t;
+        std::unordered_map<std::string, std::uint64_t> rank;
+        std::vector<std::uint64_t> seg_lengths;
+        gg.for_each_sequence([&](const sequence_elem& s){
+                rank[s.name] = seg_lengths.size();
+                seg_lengths.push_back(s.length != UINT64_MAX ? s.length :
+                        (s.sequence != "*" ? s.sequence.length() : 0));
+                });
+        t.segments = seg_lengths.size();
+
+        // Side of a segment: rank << 1 for its left side, rank << 1 | 1 for its right side.
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> edges;
+        bool gfa2 = gg.get_version() >= 2.0;
+        gg.for_each_edge([&](const edge_elem& e){
+                auto s = rank.find(e.source_name);
+                auto k = rank.find(e.sink_name);
+                if (s == rank.end() || k == rank.end()){
+                    ++t.dangling_edges;
+                    return;
+                }
+                if (s->second == k->second){
+                    ++t.self_loops;
+                }
+                int type = classify_edge(e, gfa2);
+                if (type == 2){
+                    ++t.containments;
+                    return;
+                }
+                else if (type != 1){
+                    return;
+                }
+                ++t.dovetails;
+                std::uint64_t from = (s->second << 1) | (e.source_orientation_forward ? 1 : 0);
+                std::uint64_t to = (k->second << 1) | (e.sink_orientation_forward ? 0 : 1);
+                edges.push_back(std::make_pair(from, to));
+                });
+
+        // CSR adjacency; an edge joining two sides is listed under both, a
+        // loop from a side back to itself only once.
+        std::vector<std::uint64_t> offsets(2 * t.segments + 1, 0);
+        for (auto& e : edges){
+            ++offsets[e.first + 1];
+            if (e.second != e.first){
+                ++offsets[e.second + 1];
+            }
+        }
+        for (std::size_t i = 1; i < offsets.size(); ++i){
+            offsets[i] += offsets[i - 1];
+        }
+        std::vector<std::uint64_t> neighbors(offsets.back());
+        std::vector<std::uint64_t> fill(offsets.begin(), offsets.end() - 1);
+        for (auto& e : edges){
+            neighbors[fill[e.first]++] = e.second;
+            if (e.second != e.first){
+                neighbors[fill[e.second]++] = e.first;
+            }
+        }
+        std::vector<std::pair<std::uint64_t, std::uint64_t>>().swap(edges);
+        std::vector<std::uint64_t>().swap(fill);
+
+        int nthreads = threads > 1 ? threads : 1;
+        std::vector<topology_stats> partial(nthreads);
+        #pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+        for (std::int64_t seg = 0; seg < (std::int64_t) t.segments; ++seg){
+#ifdef _OPENMP
+            topology_stats& p = partial[omp_get_thread_num()];
+#else
+            topology_stats& p = partial[0];
+#endif
+            std::uint64_t degree[2];
+            for (int side = 0; side < 2; ++side){
+                std::uint64_t id = ((std::uint64_t) seg << 1) | side;
+                std::uint64_t* b = &neighbors[0] + offsets[id];
+                std::uint64_t* e = &neighbors[0] + offsets[id + 1];
+                degree[side] = e - b;
+                // Each pair of sides is counted from its lower side only.
+                std::sort(b, e);
+                for (std::uint64_t* n = b + 1; n < e; ++n){
+                    if (*n == *(n - 1) && *n >= id){
+                        ++p.multi_edges;
+                    }
+                }
+            }
+            std::vector<std::uint64_t>& in = p.in_degree;
+            std::vector<std::uint64_t>& out = p.out_degree;
+            if (in.size() <= degree[0]){
+                in.resize(degree[0] + 1, 0);
+            }
+            if (out.size() <= degree[1]){
+                out.resize(degree[1] + 1, 0);
+            }
+            ++in[degree[0]];
+            ++out[degree[1]];
+            int free_sides = (degree[0] == 0) + (degree[1] == 0);
+            p.dead_ends += free_sides;
+            p.tips += free_sides == 1;
+            p.isolated += free_sides == 2;
+        }
+        for (auto& p : partial){
+            t.multi_edges += p.multi_edges;
+            t.dead_ends += p.dead_ends;
+            t.tips += p.tips;
+            t.isolated += p.isolated;
+            if (t.in_degree.size() < p.in_degree.size()){
+                t.in_degree.resize(p.in_degree.size(), 0);
+            }
+            if (t.out_degree.size() < p.out_degree.size()){
+                t.out_degree.resize(p.out_degree.size(), 0);
+            }
+            for (std::size_t d = 0; d < p.in_degree.size(); ++d){
+                t.in_degree[d] += p.in_degree[d];
+            }
+            for (std::size_t d = 0; d < p.out_degree.size(); ++d){
+                t.out_degree[d] += p.out_degree[d];
+            }
+        }
+
+        std::vector<path_elem> paths;
+        gg.for_each_ordered_path([&](const path_elem& p){
+                paths.push_back(p);
+                });
+        t.paths.resize(paths.size());
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (std::size_t i = 0; i < paths.size(); ++i){
+            path_metrics& m = t.paths[i];
+            m.name = paths[i].name;
+            m.steps = paths[i].segment_names.size();
+            for (std::size_t j = 0; j < paths[i].segment_names.size(); ++j){
+                auto r = rank.find(paths[i].segment_names[j]);
+                m.length += r == rank.end() ? 0 : seg_lengths[r->second];
+                m.reverse_steps += !paths[i].orientations[j];
+            }
+        }
+        return t;
+    }
+
+    inline std::string json_escape(const std::string& s){
+        std::string ret;
+        ret.reserve(s.length());
+        for (char c : s){
+            if (c == '"' || c == '\\'){
+                ret.push_back('\\');
+                ret.push_back(c);
+            }
+            else if ((unsigned char) c < 0x20){
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                ret.append(buf);
+            }
+            else{
+                ret.push_back(c);
+            }
+        }
+        return ret;
+    }
+
+    /**
+     *  Write topology_stats as three-column TSV (section, key, value), one
+     *  metric per line, e.g. "graph\ttips\t4", "in_degree\t2\t17"
+     *  and "path_length\tchr1\t248956422".
+     */
+    inline void write_topology_tsv(std::ostream& os, const topology_stats& t, bool show_graph = true, bool show_paths = true){
+        if (show_graph){
+            os << "graph\tsegments\t" << t.segments << '\n'
+                << "graph\tdovetails\t" << t.dovetails << '\n'
+                << "graph\tcontainments\t" << t.containments << '\n'
+                << "graph\tself_loops\t" << t.self_loops << '\n'
+                << "graph\tmulti_edges\t" << t.multi_edges << '\n'
+                << "graph\tdead_ends\t" << t.dead_ends << '\n'
+                << "graph\ttips\t" << t.tips << '\n'
+                << "graph\tisolated\t" << t.isolated << '\n'
+                << "graph\tdangling_edges\t" << t.dangling_edges << '\n'
+                << "graph\tmean_degree\t" << t.mean_degree() << '\n';
+            for (std::size_t d = 0; d < t.in_degree.size(); ++d){
+                if (t.in_degree[d] > 0){
+                    os << "in_degree\t" << d << '\t' << t.in_degree[d] << '\n';
+                }
+            }
+            for (std::size_t d = 0; d < t.out_degree.size(); ++d){
+                if (t.out_degree[d] > 0){
+                    os << "out_degree\t" << d << '\t' << t.out_degree[d] << '\n';
+                }
+            }
+        }
+        if (show_paths){
+            for (auto& p : t.paths){
+                os << "path_steps\t" << p.name << '\t' << p.steps << '\n'
+                    << "path_reverse_steps\t" << p.name << '\t' << p.reverse_steps << '\n'
+                    << "path_length\t" << p.name << '\t' << p.length << '\n';
+            }
+        }
+    }
+
+    /** Write topology_stats as a single JSON object. **/
+    inline void write_topology_json(std::ostream& os, const topology_stats& t, bool show_graph = true, bool show_paths = true){
+        os << "{";
+        bool first = true;
+        if (show_graph){
+            os << "\"segments\":" << t.segments
+                << ",\"dovetails\":" << t.dovetails
+                << ",\"containments\":" << t.containments
+                << ",\"self_loops\":" << t.self_loops
+                << ",\"multi_edges\":" << t.multi_edges
+                << ",\"dead_ends\":" << t.dead_ends
+                << ",\"tips\":" << t.tips
+                << ",\"isolated\":" << t.isolated
+                << ",\"dangling_edges\":" << t.dangling_edges
+                << ",\"mean_degree\":" << t.mean_degree();
+            const std::vector<std::uint64_t>* hists[2] = {&t.in_degree, &t.out_degree};
+            const char* names[2] = {"in_degree", "out_degree"};
+            for (int h = 0; h < 2; ++h){
+                os << ",\"" << names[h] << "\":{";
+                bool first_bin = true;
+                for (std::size_t d = 0; d < hists[h]->size(); ++d){
+                    if ((*hists[h])[d] > 0){
+                        os << (first_bin ? "" : ",") << "\"" << d << "\":" << (*hists[h])[d];
+                        first_bin = false;
+                    }
+                }
+                os << "}";
+            }
+            first = false;
+        }
+        if (show_paths){
+            os << (first ? "" : ",") << "\"paths\":[";
+            for (std::size_t i = 0; i < t.paths.size(); ++i){
+                const path_metrics& p = t.paths[i];
+                os << (i > 0 ? "," : "") << "{\"name\":\"" << json_escape(p.name) << "\""
+                    << ",\"steps\":" << p.steps
+                    << ",\"reverse_steps\":" << p.reverse_steps
+                    << ",\"length\":" << p.length << "}";
+            }
+            os << "]";
+        }
+        os << "}" << std::endl;
+    }
+
+}
+
+#endif
@@ -0,0 +1,435 @@
+#ifndef GFA_VALIDATE_HPP
+#define GFA_VALIDATE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include "gfa_stream.hpp"
+
+namespace gfak{
+
+    /**
+     *  A problem found in a GFA file. code is one of
+     *  malformed_record, duplicate_segment, length_mismatch, dangling_edge,
+     *  dangling_path_step, dangling_reference, coordinate_out_of_range,
+     *  end_marker_mismatch, overlap_exceeds_length and cigar_length_mismatch.
+     */
+    struct validation_error{
+        // 1-based line number in the file.
+        std::uint64_t line = 0;
+        char record = 0;
+        std::string code;
+        std::string detail;
+
+        inline bool operator<(const validation_error& o) const{
+            return line < o.line;
+        }
+        /** "line\trecord\tcode\tdetail" **/
+        inline std::string to_string() const{
+            return std::to_string(line) + "\t" + std::string(1, record) + "\t" + code + "\t" + detail;
+        }
+    };
+
+    /**
+     *  Sum the lengths a CIGAR string consumes on the reference (M, D, N, =, X)
+     *  and the query (M, I, S, =, X). Returns false for "*", traces and anything
+     *  else that isn't a CIGAR.
+     */
+    inline bool cigar_lengths(const field_view& cigar, std::uint64_t& ref, std::uint64_t& query){
+        ref = 0;
+        query = 0;
+        if (cigar.empty() || cigar == "*"){
+            return false;
+        }
+        std::uint64_t n = 0;
+        bool digits = false;
+        for (std::size_t i = 0; i < cigar.length; ++i){
+            char c = cigar.data[i];
+            if (c >= '0' && c <= '9'){
+                n = n * 10 + (c - '0');
+                digits = true;
+                continue;
+            }
+            if (!digits){
+                return false;
+            }
+            switch (c){
+                case 'M': case '=': case 'X':
+                    ref += n;
+                    query += n;
+                    break;
+                case 'D': case 'N':
+                    ref += n;
+                    break;
+                case 'I': case 'S':
+                    query += n;
+                    break;
+                case 'H': case 'P':
+                    break;
+                default:
+                    return false;
+            }
+            n = 0;
+            digits = false;
+        }
+        return !digits;
+    }
+
+    namespace detail{
+        struct segment_info{
+            // UINT64_MAX if the segment has neither a sequence nor a length.
+            std::uint64_t length = UINT64_MAX;
+            std::uint64_t line = 0;
+        };
+
+        /** Line numbers and per-chunk results of a pass over a file. **/
+        struct validation_chunk{
+            std::uint64_t lines = 0;
+            std::vector<std::pair<std::string, segment_info>> segments;
+            std::vector<std::string> ids;
+            std::vector<validation_error> errors;
+
+            inline void error(char record, const char* code, const std::string& detail){
+                validation_error e;
+                e.line = lines;
+                e.record = record;
+                e.code = code;
+                e.detail = detail;
+                errors.push_back(e);
+            }
+        };
+
+        inline std::uint64_t ln_tag(const char* tags, const char* end){
+            for (const char* p = tags; p + 6 <= end; ++p){
+                if (p[0] == '\t' && std::memcmp(p + 1, "LN:i:", 5) == 0){
+                    return field_view(p + 6, end - p - 6).to_uint();
+                }
+            }
+            return UINT64_MAX;
+        }
+    }
+
+    /**
+     *  Check a GFA file for dangling edges, path steps and references,
+     *  segment lengths that disagree with their LN tag or sequence, duplicate
+     *  segment names, edge and containment coordinates beyond the end of a
+     *  segment, and overlaps (CIGARs) longer than the segments they join.
+     *
+     *  The file is read twice, each time in up to <threads> parallel chunks:
+     *  once to collect segment names and lengths (and other IDs that groups may
+     *  refer to) and once to check every record against them. Memory use is
+     *  proportional to the number of segments, not their sequence. Errors are
+     *  appended to errors in line order. Returns false if the file cannot be read,
+     *  or cannot be read twice (stdin, pipes).
+     */
+    inline bool validate_gfa_file(const std::string& filename, std::vector<validation_error>& errors, int threads = 1){
+        if (!is_mappable_file(filename)){
+            return false;
+        }
+        int nthreads = threads > 1 ? threads : 1;
+        std::vector<detail::validation_chunk> chunks(nthreads);
+
+        // Pass 1: segments and IDs.
+        int n = for_each_line_in_file(filename, nthreads, [&](const char* line, std::size_t len, int c){
+                detail::validation_chunk& ch = chunks[c];
+                ++ch.lines;
+                if (len == 0){
+                    return;
+                }
+                field_view f[5];
+                std::size_t nf;
+                switch (line[0]){
+                    case 'S':{
+                        nf = split_fields(line, len, f, 5);
+                        if (nf < 3){
+                            ch.error('S', "malformed_record", "S line has fewer than 3 fields");
+                            return;
+                        }
+                        detail::segment_info si;
+                        si.line = ch.lines;
+                        if (nf >= 4 && f[2].is_number()){
+                            // GFA2: S <sid> <slen> <sequence>
+                            si.length = f[2].to_uint();
+                            if (f[3] != "*" && f[3].length != si.length){
+                                ch.error('S', "length_mismatch", "segment " + f[1].str() + " has length " + f[2].str() +
+                                        " but a sequence of length " + std::to_string(f[3].length));
+                            }
+                        }
+                        else{
+                            std::uint64_t ln = detail::ln_tag(f[2].data + f[2].length, line + len);
+                            if (f[2] != "*"){
+                                si.length = f[2].length;
+                                if (ln != UINT64_MAX && ln != si.length){
+                                    ch.error('S', "length_mismatch", "segment " + f[1].str() + " has LN:i:" + std::to_string(ln) +
+                                            " but a sequence of length " + std::to_string(si.length));
+                                }
+                            }
+                            else{
+                                si.length = ln;
+                            }
+                        }
+                        ch.segments.push_back(std::make_pair(f[1].str(), si));
+                        break;
+                    }
+                    case 'E':
+                    case 'O':
+                    case 'U':
+                    case 'G':
+                        nf = split_fields(line, len, f, 3);
+                        if (nf >= 2 && f[1] != "*"){
+                            ch.ids.push_back(f[1].str());
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                });
+        if (n == 0){
+            return false;
+        }
+
+        // Line numbers of each chunk start after those of the chunks before it.
+        std::vector<std::uint64_t> offsets(n, 0);
+        for (int c = 1; c < n; ++c){
+            offsets[c] = offsets[c - 1] + chunks[c - 1].lines;
+        }
+        std::unordered_map<std::string, detail::segment_info> segments;
+        std::unordered_set<std::string> ids;
+        std::vector<validation_error> found;
+        for (int c = 0; c < n; ++c){
+            detail::validation_chunk& ch = chunks[c];
+            for (auto& e : ch.errors){
+                e.line += offsets[c];
+                found.push_back(e);
+            }
+            for (auto& s : ch.segments){
+                s.second.line += offsets[c];
+                auto ins = segments.insert(s);
+                if (!ins.second){
+                    validation_error e;
+                    e.line = s.second.line;
+                    e.record = 'S';
+                    e.code = "duplicate_segment";
+                    e.detail = "segment " + s.first + " was already defined on line " + std::to_string(ins.first->second.line);
+                    found.push_back(e);
+                }
+            }
+            for (auto& i : ch.ids){
+                ids.insert(i);
+            }
+            ch = detail::validation_chunk();
+        }
+
+        // Pass 2: check every edge, path and reference against the segments.
+        n = for_each_line_in_file(filename, nthreads, [&](const char* line, std::size_t len, int c){
+                detail::validation_chunk& ch = chunks[c];
+                ++ch.lines;
+                if (len == 0){
+                    return;
+                }
+                char r = line[0];
+                field_view f[10];
+                std::size_t nf;
+                auto segment = [&](const field_view& name) -> const detail::segment_info*{
+                    auto s = segments.find(name.str());
+                    return s == segments.end() ? nullptr : &s->second;
+                };
+                auto known_length = [](const detail::segment_info* s){
+                    return s != nullptr && s->length != UINT64_MAX;
+                };
+                switch (r){
+                    case 'L':
+                    case 'C':{
+                        nf = split_fields(line, len, f, r == 'L' ? 7 : 8);
+                        if (nf < (r == 'L' ? 6u : 7u)){
+                            ch.error(r, "malformed_record", std::string(1, r) + " line has too few fields");
+                            return;
+                        }
+                        const detail::segment_info* from = segment(f[1]);
+                        const detail::segment_info* to = segment(f[3]);
+                        if (from == nullptr){
+                            ch.error(r, "dangling_edge", "segment " + f[1].str() + " does not exist");
+                        }
+                        if (to == nullptr){
+                            ch.error(r, "dangling_edge", "segment " + f[3].str() + " does not exist");
+                        }
+                        std::uint64_t ref, query;
+                        bool have_cigar = cigar_lengths(f[r == 'L' ? 5 : 6], ref, query);
+                        if (r == 'C'){
+                            std::uint64_t pos = f[5].to_uint();
+                            if (known_length(from) && pos > from->length){
+                                ch.error(r, "coordinate_out_of_range", "position " + f[5].str() + " is past the end of segment " +
+                                        f[1].str() + " (length " + std::to_string(from->length) + ")");
+                            }
+                            else if (have_cigar && known_length(from) && pos + ref > from->length){
+                                ch.error(r, "overlap_exceeds_length", "overlap " + f[6].str() + " at " + f[5].str() +
+                                        " runs past the end of segment " + f[1].str() + " (length " + std::to_string(from->length) + ")");
+                            }
+                        }
+                        else if (have_cigar && known_length(from) && ref > from->length){
+                            ch.error(r, "overlap_exceeds_length", "overlap " + f[5].str() + " is longer than segment " +
+                                    f[1].str() + " (length " + std::to_string(from->length) + ")");
+                        }
+                        if (have_cigar && known_length(to) && query > to->length){
+                            ch.error(r, "overlap_exceeds_length", "overlap " + f[r == 'L' ? 5 : 6].str() + " is longer than segment " +
+                                    f[3].str() + " (length " + std::to_string(to->length) + ")");
+                        }
+                        break;
+                    }
+                    case 'E':{
+                        nf = split_fields(line, len, f, 10);
+                        if (nf < 9){
+                            ch.error(r, "malformed_record", "E line has fewer than 9 fields");
+                            return;
+                        }
+                        const field_view* ends[2] = {&f[2], &f[3]};
+                        std::uint64_t spans[2] = {0, 0};
+                        bool dangling = false;
+                        for (int i = 0; i < 2; ++i){
+                            field_view name(ends[i]->data, ends[i]->length > 0 ? ends[i]->length - 1 : 0);
+                            const detail::segment_info* s = segment(name);
+                            if (s == nullptr){
+                                ch.error(r, "dangling_edge", "segment " + name.str() + " does not exist");
+                                dangling = true;
+                                continue;
+                            }
+                            const field_view& b = f[4 + 2 * i];
+                            const field_view& e = f[5 + 2 * i];
+                            std::uint64_t bv = b.to_uint();
+                            std::uint64_t ev = e.to_uint();
+                            spans[i] = ev > bv ? ev - bv : 0;
+                            if (bv > ev){
+                                ch.error(r, "coordinate_out_of_range", "interval " + b.str() + "-" + e.str() + " on segment " +
+                                        name.str() + " ends before it begins");
+                            }
+                            if (!known_length(s)){
+                                continue;
+                            }
+                            const field_view* pos[2] = {&b, &e};
+                            for (int p = 0; p < 2; ++p){
+                                std::uint64_t v = pos[p]->to_uint();
+                                bool marked = !pos[p]->empty() && pos[p]->back() == '$';
+                                if (v > s->length){
+                                    ch.error(r, "coordinate_out_of_range", "position " + pos[p]->str() + " is past the end of segment " +
+                                            name.str() + " (length " + std::to_string(s->length) + ")");
+                                }
+                                else if (marked != (v == s->length)){
+                                    ch.error(r, "end_marker_mismatch", "position " + pos[p]->str() + (marked ? " is marked" : " is not marked") +
+                                            " as the end of segment " + name.str() + " (length " + std::to_string(s->length) + ")");
+                                }
+                            }
+                        }
+                        std::uint64_t ref, query;
+                        if (!dangling && cigar_lengths(f[8], ref, query) && (ref != spans[0] || query != spans[1])){
+                            ch.error(r, "cigar_length_mismatch", "alignment " + f[8].str() + " covers " + std::to_string(ref) + " and " +
+                                    std::to_string(query) + " bp but the intervals are " + std::to_string(spans[0]) + " and " +
+                                    std::to_string(spans[1]) + " bp");
+                        }
+                        break;
+                    }
+                    case 'P':
+                    case 'O':
+                    case 'U':
+                    case 'W':{
+                        nf = split_fields(line, len, f, r == 'W' ? 8 : 4);
+                        if (r == 'W' ? nf < 7 : nf < 3){
+                            // GFA 0.1 per-step P / W lines: P <segment> <path> ...
+                            if (nf >= 3 && segment(f[1]) == nullptr){
+                                ch.error(r, "dangling_path_step", "segment " + f[1].str() + " does not exist");
+                            }
+                            else if (nf < 3){
+                                ch.error(r, "malformed_record", std::string(1, r) + " line has too few fields");
+                            }
+                            return;
+                        }
+                        const field_view& steps = f[r == 'W' ? 6 : 2];
+                        if (r == 'P' && !steps.empty() && steps.back() != '+' && steps.back() != '-'){
+                            if (segment(f[1]) == nullptr){
+                                ch.error(r, "dangling_path_step", "segment " + f[1].str() + " does not exist");
+                            }
+                            return;
+                        }
+                        const char* p = steps.data;
+                        const char* end = steps.data + steps.length;
+                        while (p < end){
+                            const char* q = p;
+                            field_view name;
+                            if (r == 'W'){
+                                ++q;
+                                while (q < end && *q != '>' && *q != '<'){
+                                    ++q;
+                                }
+                                name = field_view(p + 1, q - p - 1);
+                            }
+                            else{
+                                // P steps end at a ',' after an orientation; O and U items are space-separated.
+                                while (q < end && !(r == 'P' ? (*q == ',' && q > p && (q[-1] == '+' || q[-1] == '-')) : *q == ' ')){
+                                    ++q;
+                                }
+                                bool oriented = r != 'U' && q > p && (q[-1] == '+' || q[-1] == '-');
+                                name = field_view(p, oriented ? q - p - 1 : q - p);
+                                ++q;
+                            }
+                            p = q;
+                            if (name.empty() || segment(name) != nullptr){
+                                continue;
+                            }
+                            if (r == 'O' || r == 'U'){
+                                if (ids.count(name.str()) == 0){
+                                    ch.error(r, "dangling_reference", "group " + f[1].str() + " refers to " + name.str() +
+                                            ", which is not a segment, edge or group");
+                                }
+                            }
+                            else{
+                                ch.error(r, "dangling_path_step", "path " + f[1].str() + " steps on segment " + name.str() +
+                                        ", which does not exist");
+                            }
+                        }
+                        break;
+                    }
+                    case 'F':{
+                        nf = split_fields(line, len, f, 3);
+                        if (nf < 3){
+                            ch.error(r, "malformed_record", "F line has too few fields");
+                        }
+                        else if (segment(f[1]) == nullptr){
+                            ch.error(r, "dangling_reference", "fragment of segment " + f[1].str() + ", which does not exist");
+                        }
+                        break;
+                    }
+                    case 'G':{
+                        nf = split_fields(line, len, f, 5);
+                        if (nf < 5){
+                            ch.error(r, "malformed_record", "G line has too few fields");
+                            return;
+                        }
+                        for (int i = 2; i < 4; ++i){
+                            field_view name(f[i].data, f[i].length > 0 ? f[i].length - 1 : 0);
+                            if (segment(name) == nullptr){
+                                ch.error(r, "dangling_reference", "gap from or to segment " + name.str() + ", which does not exist");
+                            }
+                        }
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                });
+        for (int c = 0; c < n; ++c){
+            for (auto& e : chunks[c].errors){
+                e.line += offsets[c];
+                found.push_back(e);
+            }
+        }
+        std::stable_sort(found.begin(), found.end());
+        errors.insert(errors.end(), found.begin(), found.end());
+        return true;
+    }
+
+}
+
+#endif
@@ -0,0 +1,970 @@
+#ifndef GFA_VCF_HPP
+#define GFA_VCF_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <memory>
+#include <cstdio>
+#include <climits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "gfa_stream.hpp"
+
+namespace gfak{
+
+    enum sv_type {SV_NONE, SV_DEL, SV_INS, SV_DUP, SV_INV, SV_TRA, SV_BND, SV_OTHER};
+
+    inline sv_type parse_sv_type(const field_view& f){
+        return f == "DEL" ? SV_DEL :
+            f == "INS" ? SV_INS :
+            f == "DUP" ? SV_DUP :
+            f == "INV" ? SV_INV :
+            f == "TRA" ? SV_TRA :
+            f == "BND" ? SV_BND : SV_OTHER;
+    }
+
+    /**
+     *  A VCF record, reduced to what graph construction needs. The REF, ALT
+     *  and INFO SEQ strings are stored back to back in the arena of the
+     *  contig_variants holding the record, starting at <offset>.
+     */
+    struct vcf_variant{
+        // 1-based position.
+        int pos = 0;
+        sv_type svtype = SV_NONE;
+        // Absolute value of SVLEN, or END - POS if there is no SVLEN (0 if neither is given).
+        int svlen = 0;
+        bool has_svlen = false;
+        bool has_end = false;
+        std::uint64_t offset = 0;
+        std::uint32_t ref_length = 0;
+        std::uint32_t alt_length = 0;
+        std::uint32_t seq_length = 0;
+    };
+
+    /** A non-reference allele carried by one haplotype at one variant. **/
+    struct haplotype_allele{
+        // Index of the variant in its contig_variants.
+        std::uint32_t variant = 0;
+        // Haplotype index within the spool file's group.
+        std::uint16_t haplotype = 0;
+        // 1-based ALT allele.
+        std::uint16_t allele = 0;
+    };
+
+    /**
+     *  The phased genotypes of one contig. Only non-reference alleles are
+     *  kept, and they are spooled to (at most max_files) temporary files,
+     *  each holding a group of haplotypes, so the genotypes of thousands of
+     *  samples are never all in memory; for_each_haplotype reads back one
+     *  group at a time. Haplotype h is copy h % ploidy of sample h / ploidy.
+     */
+    class haplotype_spool{
+        private:
+            static const std::size_t max_files = 32;
+            std::vector<std::FILE*> files;
+            std::size_t group_size = 1;
+            std::vector<bool> seen;
+            std::size_t unphased = 0;
+            std::vector<haplotype_allele> buf;
+
+        public:
+            std::shared_ptr<const std::vector<std::string>> samples;
+            int ploidy = 2;
+
+            haplotype_spool(std::shared_ptr<const std::vector<std::string>> sample_names, int p = 2) :
+                samples(sample_names), ploidy(p){
+                std::size_t n = haplotype_count();
+                group_size = std::max<std::size_t>(64, (n + max_files - 1) / max_files);
+                files.resize((n + group_size - 1) / group_size, nullptr);
+                seen.resize(n, false);
+                for (auto& f : files){
+                    std::string name = make_temp_file();
+                    f = std::fopen(name.c_str(), "w+b");
+                    std::remove(name.c_str());
+                    if (f == nullptr){
+                        std::cerr << "ERROR: could not open a temporary file for genotypes." << std::endl;
+                        exit(1);
+                    }
+                }
+            }
+            ~haplotype_spool(){
+                for (auto f : files){
+                    if (f != nullptr){
+                        std::fclose(f);
+                    }
+                }
+            }
+            haplotype_spool(const haplotype_spool&) = delete;
+            haplotype_spool& operator=(const haplotype_spool&) = delete;
+
+            inline std::size_t haplotype_count() const{
+                return samples->size() * ploidy;
+            }
+            /** PanSN-style name of haplotype h on a contig: sample#copy#contig. **/
+            inline std::string haplotype_name(std::size_t h, const std::string& contig) const{
+                return (*samples)[h / ploidy] + "#" + std::to_string(h % ploidy + 1) + "#" + contig;
+            }
+            /** Number of unphased, heterozygous genotypes, which are read as reference. **/
+            inline std::size_t unphased_count() const{
+                return unphased;
+            }
+
+            /**
+             *  Spool the GT alleles of one record. sample_fields is the
+             *  FORMAT column and the sample columns after it.
+             */
+            inline void add_genotypes(std::uint32_t variant, const field_view& sample_fields){
+                const char* p = sample_fields.data;
+                const char* end = sample_fields.data + sample_fields.length;
+                const char* tab = (const char*) std::memchr(p, '\t', end - p);
+                if (tab == nullptr){
+                    return;
+                }
+                // Find GT among the FORMAT keys.
+                int gt_index = -1;
+                int k = 0;
+                for (const char* f = p; f < tab; ++k){
+                    const char* colon = (const char*) std::memchr(f, ':', tab - f);
+                    const char* f_end = colon == nullptr ? tab : colon;
+                    if (f_end - f == 2 && f[0] == 'G' && f[1] == 'T'){
+                        gt_index = k;
+                        break;
+                    }
+                    f = f_end + 1;
+                }
+                if (gt_index < 0){
+                    return;
+                }
+                p = tab + 1;
+                for (std::size_t sample = 0; sample < samples->size() && p < end; ++sample){
+                    const char* col_end = (const char*) std::memchr(p, '\t', end - p);
+                    col_end = col_end == nullptr ? end : col_end;
+                    const char* gt = p;
+                    for (int i = 0; i < gt_index && gt < col_end; ++i){
+                        const char* colon = (const char*) std::memchr(gt, ':', col_end - gt);
+                        gt = colon == nullptr ? col_end : colon + 1;
+                    }
+                    // Parse up to ploidy alleles; -1 is missing.
+                    int alleles[8];
+                    int n = 0;
+                    bool phased = true;
+                    const char* a = gt;
+                    while (a < col_end && *a != ':' && n < 8){
+                        if (*a == '.'){
+                            alleles[n++] = -1;
+                            ++a;
+                        }
+                        else{
+                            int v = 0;
+                            bool digits = false;
+                            while (a < col_end && *a >= '0' && *a <= '9'){
+                                v = v * 10 + (*a++ - '0');
+                                digits = true;
+                            }
+                            if (!digits){
+                                break;
+                            }
+                            alleles[n++] = v;
+                        }
+                        if (a < col_end && (*a == '|' || *a == '/')){
+                            phased &= *a == '|';
+                            ++a;
+                        }
+                        else{
+                            break;
+                        }
+                    }
+                    bool all_same = true;
+                    for (int i = 1; i < n; ++i){
+                        all_same &= alleles[i] == alleles[0];
+                    }
+                    if (!phased && !all_same){
+                        ++unphased;
+                        n = 0;
+                    }
+                    for (int i = 0; i < n && i < ploidy; ++i){
+                        std::size_t h = sample * ploidy + i;
+                        if (alleles[i] >= 0){
+                            seen[h] = true;
+                        }
+                        if (alleles[i] > 0 && alleles[i] <= 0xffff){
+                            haplotype_allele ha;
+                            ha.variant = variant;
+                            ha.haplotype = h % group_size;
+                            ha.allele = alleles[i];
+                            std::fwrite(&ha, sizeof(ha), 1, files[h / group_size]);
+                        }
+                    }
+                    p = col_end + 1;
+                }
+            }
+
+            /**
+             *  Call func(h, alleles) for each haplotype with a called genotype on
+             *  the contig, in order, with its non-reference alleles in variant order.
+             *  One group of haplotypes is read back into memory at a time.
+             */
+            template<typename Func>
+            inline void for_each_haplotype(const Func& func){
+                std::vector<haplotype_allele> none;
+                for (std::size_t g = 0; g < files.size(); ++g){
+                    std::size_t first = g * group_size;
+                    std::size_t count = std::min(group_size, haplotype_count() - first);
+                    std::vector<std::vector<haplotype_allele>> by_haplotype(count);
+                    std::fflush(files[g]);
+                    std::rewind(files[g]);
+                    buf.resize(1 << 16);
+                    std::size_t n;
+                    while ((n = std::fread(buf.data(), sizeof(haplotype_allele), buf.size(), files[g])) > 0){
+                        for (std::size_t i = 0; i < n; ++i){
+                            by_haplotype[buf[i].haplotype].push_back(buf[i]);
+                        }
+                    }
+                    for (std::size_t i = 0; i < count; ++i){
+                        if (seen[first + i]){
+                            func(first + i, (const std::vector<haplotype_allele>&) by_haplotype[i]);
+                        }
+                        std::vector<haplotype_allele>().swap(by_haplotype[i]);
+                    }
+                }
+                std::vector<haplotype_allele>().swap(buf);
+            }
+    };
+
+    /** The variants of one contig, in file order, with their strings in one arena. **/
+    struct contig_variants{
+        std::string name;
+        std::vector<vcf_variant> variants;
+        std::string arena;
+        // Phased genotypes, if they were asked for.
+        std::shared_ptr<haplotype_spool> haplotypes;
+
+        inline field_view ref(const vcf_variant& v) const{
+            return field_view(arena.data() + v.offset, v.ref_length);
+        }
+        /** The whole (comma-separated) ALT field. **/
+        inline field_view alt_field(const vcf_variant& v) const{
+            return field_view(arena.data() + v.offset + v.ref_length, v.alt_length);
+        }
+        inline std::size_t alt_count(const vcf_variant& v) const{
+            field_view a = alt_field(v);
+            return a.empty() ? 0 : 1 + std::count(a.data, a.data + a.length, ',');
+        }
+        /** The i-th alternate allele. **/
+        inline field_view alt(const vcf_variant& v, std::size_t i) const{
+            field_view a = alt_field(v);
+            const char* p = a.data;
+            const char* end = a.data + a.length;
+            for (; i > 0 && p < end; --i){
+                const char* comma = (const char*) std::memchr(p, ',', end - p);
+                p = comma == nullptr ? end : comma + 1;
+            }
+            const char* comma = (const char*) std::memchr(p, ',', end - p);
+            return field_view(p, (comma == nullptr ? end : comma) - p);
+        }
+        /** The INFO SEQ value (empty if there is none). **/
+        inline field_view seq(const vcf_variant& v) const{
+            return field_view(arena.data() + v.offset + v.ref_length + v.alt_length, v.seq_length);
+        }
+    };
+
+    /**
+     *  Parse one VCF data line into a vcf_variant, appending its strings to
+     *  cv's arena. Only the SVTYPE, SVLEN, END and SEQ keys of INFO are read.
+     *  Returns false for header and malformed lines.
+     */
+    inline bool parse_vcf_record(const char* line, std::size_t len, contig_variants& cv, vcf_variant& v){
+        field_view fields[9];
+        if (len == 0 || line[0] == '#' || split_fields(line, len, fields, 9) < 8){
+            return false;
+        }
+        v = vcf_variant();
+        v.pos = (int) fields[1].to_uint();
+        field_view seq;
+        int end = 0;
+        const char* p = fields[7].data;
+        const char* info_end = fields[7].data + fields[7].length;
+        while (p < info_end){
+            const char* semi = (const char*) std::memchr(p, ';', info_end - p);
+            const char* e = semi == nullptr ? info_end : semi;
+            const char* eq = (const char*) std::memchr(p, '=', e - p);
+            if (eq != nullptr){
+                field_view key(p, eq - p);
+                field_view value(eq + 1, e - eq - 1);
+                if (key == "SVTYPE"){
+                    v.svtype = parse_sv_type(value);
+                }
+                else if (key == "SVLEN"){
+                    v.svlen = (int) (value.starts_with("-") ? field_view(value.data + 1, value.length - 1) : value).to_uint();
+                    v.has_svlen = true;
+                }
+                else if (key == "END"){
+                    end = (int) value.to_uint();
+                    v.has_end = true;
+                }
+                else if (key == "SEQ"){
+                    seq = value;
+                }
+            }
+            p = e + 1;
+        }
+        if (!v.has_svlen && v.has_end){
+            v.svlen = end - v.pos;
+        }
+        v.offset = cv.arena.length();
+        v.ref_length = fields[3].length;
+        v.alt_length = fields[4].length;
+        v.seq_length = seq.length;
+        cv.arena.append(fields[3].data, fields[3].length);
+        cv.arena.append(fields[4].data, fields[4].length);
+        cv.arena.append(seq.data, seq.length);
+        return true;
+    }
+
+    /**
+     *  Call func(line, length) on each line read from gz, without the trailing
+     *  newline (or carriage return), until func returns false. gz is closed
+     *  before returning. Returns false if the stream is corrupt.
+     */
+    template<typename Func>
+    inline bool for_each_line_in_gz(gzFile gz, const Func& func){
+        gzbuffer(gz, 1 << 20);
+        const std::size_t block = 1 << 20;
+        std::vector<char> buf(block * 2);
+        std::size_t have = 0;
+        bool ok = true;
+        bool more = true;
+        while (more){
+            if (buf.size() - have < block){
+                buf.resize(buf.size() * 2);
+            }
+            int n = gzread(gz, buf.data() + have, block);
+            if (n < 0){
+                ok = false;
+                break;
+            }
+            std::size_t end = have + n;
+            std::size_t start = 0;
+            for (const char* nl; more && (nl = (const char*) std::memchr(buf.data() + start, '\n', end - start)) != nullptr; ){
+                std::size_t len = nl - (buf.data() + start);
+                if (len > 0 && buf[start + len - 1] == '\r'){
+                    --len;
+                }
+                more = func(buf.data() + start, len);
+                start = nl - buf.data() + 1;
+            }
+            if (n == 0){
+                if (more && start < end){
+                    func(buf.data() + start, end - start);
+                }
+                break;
+            }
+            std::memmove(buf.data(), buf.data() + start, end - start);
+            have = end - start;
+        }
+        gzclose(gz);
+        return ok;
+    }
+
+    /**
+     *  Call func(line, length) on each line of a file that may be plain
+     *  text or gzip / BGZF compressed ("-" reads stdin). Returns false if
+     *  the file can't be opened or is corrupt.
+     */
+    template<typename Func>
+    inline bool for_each_line_in_gzfile(const std::string& filename, const Func& func){
+        gzFile gz = filename == "-" ? gzdopen(0, "rb") : gzopen(filename.c_str(), "rb");
+        if (gz == NULL){
+            return false;
+        }
+        return for_each_line_in_gz(gz, [&](const char* line, std::size_t len){
+                func(line, len);
+                return true;
+                });
+    }
+
+    /**
+     *  Read the variants of a (possibly gzipped) VCF file, grouped by contig
+     *  in order of first appearance. Returns false if the file can't be read.
+     */
+    inline bool read_vcf(const std::string& filename, std::vector<contig_variants>& contigs){
+        std::unordered_map<std::string, std::size_t> contig_index;
+        contig_variants* cur = nullptr;
+        return for_each_line_in_gzfile(filename, [&](const char* line, std::size_t len){
+                if (len == 0 || line[0] == '#'){
+                    return;
+                }
+                const char* tab = (const char*) std::memchr(line, '\t', len);
+                if (tab == nullptr){
+                    return;
+                }
+                std::size_t name_length = tab - line;
+                // Records are usually grouped by contig, so check the last one first.
+                if (cur == nullptr || cur->name.length() != name_length ||
+                        std::memcmp(cur->name.data(), line, name_length) != 0){
+                    std::string name(line, name_length);
+                    auto c = contig_index.find(name);
+                    if (c == contig_index.end()){
+                        c = contig_index.emplace(name, contigs.size()).first;
+                        contigs.push_back(contig_variants());
+                        contigs.back().name = name;
+                    }
+                    cur = &contigs[c->second];
+                }
+                vcf_variant v;
+                if (parse_vcf_record(line, len, *cur, v)){
+                    cur->variants.push_back(v);
+                }
+                });
+    }
+
+    /**
+     *  Call func(cv) with the variants of each contig of a (possibly gzipped)
+     *  VCF file in turn, so only one contig's variants are held at a time.
+     *  func may keep cv by swapping it out. Records must be grouped by contig,
+     *  as they are in any sorted VCF. If genotypes is true, the GT alleles of
+     *  the samples are spooled into cv.haplotypes. Returns false if the file
+     *  can't be read or a contig's records are split up.
+     */
+    inline bool for_each_vcf_contig(const std::string& filename, const std::function<void(contig_variants&)>& func,
+            bool genotypes = false){
+        std::unordered_set<std::string> seen;
+        std::shared_ptr<std::vector<std::string>> samples = std::make_shared<std::vector<std::string>>();
+        contig_variants cur;
+        bool grouped = true;
+        bool ok = false;
+        gzFile gz = filename == "-" ? gzdopen(0, "rb") : gzopen(filename.c_str(), "rb");
+        if (gz != NULL){
+            ok = for_each_line_in_gz(gz, [&](const char* line, std::size_t len){
+                    const char* tab = (const char*) std::memchr(line, '\t', len);
+                    if (genotypes && len > 6 && std::memcmp(line, "#CHROM", 6) == 0){
+                        // The sample names follow the FORMAT column.
+                        field_view fields[10];
+                        if (split_fields(line, len, fields, 10) == 10){
+                            const char* p = fields[9].data;
+                            const char* end = fields[9].data + fields[9].length;
+                            while (p <= end){
+                                const char* t = (const char*) std::memchr(p, '\t', end - p);
+                                t = t == nullptr ? end : t;
+                                samples->push_back(std::string(p, t));
+                                p = t + 1;
+                            }
+                        }
+                    }
+                    if (len == 0 || line[0] == '#' || tab == nullptr){
+                        return true;
+                    }
+                    std::size_t name_length = tab - line;
+                    if (seen.empty() || cur.name.length() != name_length ||
+                            std::memcmp(cur.name.data(), line, name_length) != 0){
+                        std::string name(line, name_length);
+                        if (!seen.insert(name).second){
+                            std::cerr << "ERROR: the records of contig " << name << " are not together in " <<
+                                filename << "; sort the VCF first." << std::endl;
+                            grouped = false;
+                            return false;
+                        }
+                        if (seen.size() > 1){
+                            func(cur);
+                        }
+                        cur = contig_variants();
+                        cur.name = name;
+                        if (genotypes && !samples->empty()){
+                            cur.haplotypes = std::make_shared<haplotype_spool>(samples);
+                        }
+                    }
+                    vcf_variant v;
+                    if (parse_vcf_record(line, len, cur, v)){
+                        if (cur.haplotypes){
+                            field_view fields[10];
+                            if (split_fields(line, len, fields, 10) == 10){
+                                cur.haplotypes->add_genotypes(cur.variants.size(),
+                                        field_view(fields[8].data, line + len - fields[8].data));
+                            }
+                        }
+                        cur.variants.push_back(v);
+                    }
+                    return true;
+                    });
+        }
+        if (ok && grouped && !seen.empty()){
+            func(cur);
+        }
+        return ok && grouped;
+    }
+
+    /** A 1-based, inclusive interval of a contig. An end of 0 runs to the end of the contig. **/
+    struct vcf_region{
+        std::string contig;
+        int start = 1;
+        int end = 0;
+    };
+
+    /**
+     *  Parse a region string of the form "chr", "chr:start" or "chr:start-end"
+     *  (commas in the coordinates are ignored). Returns false if the
+     *  coordinates are malformed.
+     */
+    inline bool parse_region(const std::string& s, vcf_region& region){
+        region = vcf_region();
+        std::size_t colon = s.rfind(':');
+        if (colon == std::string::npos){
+            region.contig = s;
+            return !s.empty();
+        }
+        region.contig = s.substr(0, colon);
+        std::string coords;
+        for (std::size_t i = colon + 1; i < s.length(); ++i){
+            if (s[i] != ','){
+                coords.push_back(s[i]);
+            }
+        }
+        std::size_t dash = coords.find('-');
+        field_view start(coords.data(), dash == std::string::npos ? coords.length() : dash);
+        if (region.contig.empty() || !start.is_number() || start.length > 9){
+            return false;
+        }
+        region.start = (int) start.to_uint();
+        if (dash != std::string::npos){
+            field_view end(coords.data() + dash + 1, coords.length() - dash - 1);
+            if (!end.is_number() || end.length > 9){
+                return false;
+            }
+            region.end = (int) end.to_uint();
+        }
+        return region.start > 0 && (region.end == 0 || region.end >= region.start);
+    }
+
+    namespace vcf_index{
+
+        enum record_state {OTHER_CONTIG, BEFORE_REGION, IN_REGION, AFTER_REGION};
+
+        /**
+         *  Add the record on line to cv if it lies in region (by POS).
+         *  Header lines count as OTHER_CONTIG.
+         */
+        inline record_state add_region_record(const char* line, std::size_t len, const vcf_region& region, contig_variants& cv){
+            const char* tab = (const char*) std::memchr(line, '\t', len);
+            if (len == 0 || line[0] == '#' || tab == nullptr ||
+                    (std::size_t) (tab - line) != region.contig.length() ||
+                    std::memcmp(line, region.contig.data(), region.contig.length()) != 0){
+                return OTHER_CONTIG;
+            }
+            int pos = (int) field_view(tab + 1, line + len - tab - 1).to_uint();
+            if (pos < region.start){
+                return BEFORE_REGION;
+            }
+            if (region.end > 0 && pos > region.end){
+                return AFTER_REGION;
+            }
+            vcf_variant v;
+            if (parse_vcf_record(line, len, cv, v)){
+                cv.variants.push_back(v);
+            }
+            return IN_REGION;
+        }
+
+        inline bool is_gzipped(const std::string& filename){
+            std::ifstream fi(filename.c_str(), std::ios::binary);
+            char magic[2] = {0, 0};
+            fi.read(magic, 2);
+            return fi.good() && (unsigned char) magic[0] == 0x1f && (unsigned char) magic[1] == 0x8b;
+        }
+
+        inline bool file_exists(const std::string& filename){
+            std::ifstream fi(filename.c_str());
+            return fi.good();
+        }
+
+        /** Read a whole (possibly gzipped) file into out. **/
+        inline bool read_gz_file(const std::string& filename, std::string& out){
+            gzFile gz = gzopen(filename.c_str(), "rb");
+            if (gz == NULL){
+                return false;
+            }
+            char buf[1 << 16];
+            int n;
+            while ((n = gzread(gz, buf, sizeof(buf))) > 0){
+                out.append(buf, n);
+            }
+            gzclose(gz);
+            return n == 0;
+        }
+
+        /** Little-endian reads from an index buffer, with bounds checks. **/
+        struct index_reader{
+            const std::string& buf;
+            std::size_t pos = 0;
+            bool ok = true;
+
+            index_reader(const std::string& b) : buf(b){
+
+            }
+            inline std::uint64_t read(std::size_t bytes){
+                std::uint64_t v = 0;
+                if (!ok || pos + bytes > buf.length()){
+                    ok = false;
+                    return 0;
+                }
+                for (std::size_t i = 0; i < bytes; ++i){
+                    v |= (std::uint64_t) (unsigned char) buf[pos + i] << (8 * i);
+                }
+                pos += bytes;
+                return v;
+            }
+            inline std::int32_t read_int32(){
+                return (std::int32_t) (std::uint32_t) read(4);
+            }
+            inline void skip(std::size_t bytes){
+                if (pos + bytes > buf.length()){
+                    ok = false;
+                }
+                pos += bytes;
+            }
+        };
+
+        /**
+         *  Find the BGZF virtual offset to start reading contig from for records
+         *  starting in [beg, end) (0-based) using a tabix (.tbi) or CSI (.csi) index.
+         *  Returns 1 and sets voffset if there may be records there, 0 if there
+         *  are none, and -1 if the index can't be read.
+         */
+        inline int find_start_offset(const std::string& index_file, bool csi,
+                const std::string& contig, std::int64_t beg, std::int64_t end, std::uint64_t& voffset){
+            std::string buf;
+            if (!read_gz_file(index_file, buf)){
+                return -1;
+            }
+            index_reader ir(buf);
+            if (buf.compare(0, 4, csi ? std::string("CSI\1") : std::string("TBI\1")) != 0){
+                return -1;
+            }
+            ir.skip(4);
+            int min_shift = 14;
+            int depth = 5;
+            std::string names;
+            if (csi){
+                min_shift = ir.read_int32();
+                depth = ir.read_int32();
+                std::int32_t l_aux = ir.read_int32();
+                // The aux block holds the tabix header; the names are at its end.
+                index_reader aux(buf);
+                aux.pos = ir.pos;
+                aux.skip(24);
+                std::int32_t l_nm = aux.read_int32();
+                if (!aux.ok || l_aux < 28 || l_nm < 0 || l_nm > l_aux - 28){
+                    return -1;
+                }
+                names = buf.substr(aux.pos, l_nm);
+                ir.skip(l_aux);
+            }
+            std::int32_t n_ref = ir.read_int32();
+            if (!csi){
+                ir.skip(24);
+                std::int32_t l_nm = ir.read_int32();
+                if (!ir.ok || l_nm < 0 || ir.pos + l_nm > buf.length()){
+                    return -1;
+                }
+                names = buf.substr(ir.pos, l_nm);
+                ir.skip(l_nm);
+            }
+            // Find the index of contig among the NUL-separated names.
+            std::int32_t tid = -1;
+            std::size_t p = 0;
+            for (std::int32_t i = 0; p < names.length(); ++i){
+                std::size_t nul = names.find('\0', p);
+                nul = nul == std::string::npos ? names.length() : nul;
+                if (names.compare(p, nul - p, contig) == 0){
+                    tid = i;
+                    break;
+                }
+                p = nul + 1;
+            }
+            if (tid < 0){
+                return 0;
+            }
+            std::uint32_t pseudo_bin = ((1u << (3 * (depth + 1))) - 1) / 7 + 1;
+            for (std::int32_t r = 0; r < n_ref && ir.ok; ++r){
+                std::int32_t n_bin = ir.read_int32();
+                std::map<std::uint32_t, std::vector<std::pair<std::uint64_t, std::uint64_t>>> bins;
+                std::map<std::uint32_t, std::uint64_t> loffsets;
+                for (std::int32_t b = 0; b < n_bin && ir.ok; ++b){
+                    std::uint32_t bin = (std::uint32_t) ir.read(4);
+                    std::uint64_t loffset = csi ? ir.read(8) : 0;
+                    std::int32_t n_chunk = ir.read_int32();
+                    if (r != tid){
+                        ir.skip(16 * (std::size_t) (n_chunk > 0 ? n_chunk : 0));
+                        continue;
+                    }
+                    loffsets[bin] = loffset;
+                    for (std::int32_t c = 0; c < n_chunk && ir.ok; ++c){
+                        std::uint64_t cnk_beg = ir.read(8);
+                        std::uint64_t cnk_end = ir.read(8);
+                        bins[bin].push_back(std::make_pair(cnk_beg, cnk_end));
+                    }
+                }
+                std::uint64_t min_off = 0;
+                if (!csi){
+                    std::int32_t n_intv = ir.read_int32();
+                    if (r != tid){
+                        ir.skip(8 * (std::size_t) (n_intv > 0 ? n_intv : 0));
+                        continue;
+                    }
+                    std::vector<std::uint64_t> linear;
+                    for (std::int32_t i = 0; i < n_intv && ir.ok; ++i){
+                        linear.push_back(ir.read(8));
+                    }
+                    if (!linear.empty()){
+                        std::size_t w = (std::size_t) (beg >> min_shift);
+                        min_off = linear[std::min(w, linear.size() - 1)];
+                    }
+                }
+                else if (r != tid){
+                    continue;
+                }
+                else{
+                    // The loffset of the deepest existing bin containing beg.
+                    std::uint32_t t = ((1u << (3 * depth)) - 1) / 7;
+                    std::uint32_t bin = t + (std::uint32_t) (beg >> min_shift);
+                    while (true){
+                        auto l = loffsets.find(bin);
+                        if (l != loffsets.end()){
+                            min_off = l->second;
+                            break;
+                        }
+                        if (bin == 0){
+                            break;
+                        }
+                        bin = (bin - 1) >> 3;
+                    }
+                }
+                if (!ir.ok){
+                    return -1;
+                }
+                // Take the earliest chunk of any bin overlapping [beg, end).
+                bool found = false;
+                for (auto& b : bins){
+                    if (b.first >= pseudo_bin){
+                        continue;
+                    }
+                    int level = 0;
+                    std::uint32_t t = 0;
+                    while (level < depth && b.first >= t + (1u << (3 * level))){
+                        t += 1u << (3 * level);
+                        ++level;
+                    }
+                    int shift = min_shift + 3 * (depth - level);
+                    std::int64_t bin_beg = (std::int64_t) (b.first - t) << shift;
+                    std::int64_t bin_end = bin_beg + ((std::int64_t) 1 << shift);
+                    if (bin_end <= beg || bin_beg >= end){
+                        continue;
+                    }
+                    for (auto& c : b.second){
+                        if (c.second > min_off && (!found || c.first < voffset)){
+                            voffset = c.first;
+                            found = true;
+                        }
+                    }
+                }
+                return found ? 1 : 0;
+            }
+            return -1;
+        }
+
+        /**
+         *  A gfakluge index (<vcf>.gvi) for uncompressed VCFs: for each contig,
+         *  the file offset of the first record starting in each 16kb window.
+         *  The first line is "#gvi<TAB>size<TAB>mtime" for the VCF it was built
+         *  from; the others are "contig<TAB>window<TAB>offset".
+         */
+        typedef std::map<std::string, std::map<std::int64_t, std::uint64_t>> text_index;
+
+        /** The "size<TAB>mtime" of a file, which a .gvi index must match to be used. **/
+        inline std::string file_stamp(const std::string& filename){
+            struct stat stats;
+            if (stat(filename.c_str(), &stats) == -1){
+                return "";
+            }
+            return std::to_string((std::uint64_t) stats.st_size) + "\t" + std::to_string((std::int64_t) stats.st_mtime);
+        }
+
+        /**
+         *  Read index_file into index. Returns false if it can't be read or
+         *  was built from a file other than one with the given stamp (a VCF
+         *  that has changed since), in which case it must be rebuilt.
+         */
+        inline bool read_text_index(const std::string& index_file, const std::string& stamp, text_index& index){
+            std::ifstream fi(index_file.c_str());
+            if (!fi.good()){
+                return false;
+            }
+            std::string line;
+            if (!std::getline(fi, line) || line != "#gvi\t" + stamp){
+                return false;
+            }
+            while (std::getline(fi, line)){
+                field_view fields[3];
+                if (split_fields(line.c_str(), line.length(), fields, 3) == 3){
+                    index[fields[0].str()][fields[1].to_uint()] = fields[2].to_uint();
+                }
+            }
+            return true;
+        }
+
+        /** Index a mapped, uncompressed VCF in one scan. Returns false if it isn't sorted. **/
+        inline bool build_text_index(const mapped_file& mf, text_index& index){
+            const char* buf = mf.data();
+            std::size_t fsize = mf.size();
+            std::string last_contig;
+            std::int64_t last_pos = 0;
+            for (std::size_t pos = 0; pos < fsize; ){
+                const char* nl = (const char*) std::memchr(buf + pos, '\n', fsize - pos);
+                std::size_t end = nl == nullptr ? fsize : nl - buf;
+                const char* tab = (const char*) std::memchr(buf + pos, '\t', end - pos);
+                if (buf[pos] != '#' && tab != nullptr){
+                    std::int64_t vpos = field_view(tab + 1, buf + end - tab - 1).to_uint();
+                    if (last_contig.length() != (std::size_t) (tab - buf - pos) ||
+                            std::memcmp(last_contig.data(), buf + pos, last_contig.length()) != 0){
+                        last_contig.assign(buf + pos, tab);
+                        if (index.count(last_contig)){
+                            return false;
+                        }
+                        last_pos = 0;
+                    }
+                    if (vpos < last_pos){
+                        return false;
+                    }
+                    std::int64_t window = (vpos > 0 ? vpos - 1 : 0) >> 14;
+                    std::map<std::int64_t, std::uint64_t>& windows = index[last_contig];
+                    if (windows.count(window) == 0){
+                        windows[window] = pos;
+                    }
+                    last_pos = vpos;
+                }
+                pos = end + 1;
+            }
+            return true;
+        }
+
+        inline void write_text_index(const std::string& index_file, const std::string& stamp, const text_index& index){
+            std::ofstream fo(index_file.c_str());
+            fo << "#gvi\t" << stamp << '\n';
+            for (auto& c : index){
+                for (auto& w : c.second){
+                    fo << c.first << '\t' << w.first << '\t' << w.second << '\n';
+                }
+            }
+        }
+    }
+
+    /**
+     *  Read the records of a VCF that start (by POS) in region into cv.
+     *  BGZF files are read through their tabix (.tbi) or CSI (.csi) index,
+     *  seeking straight to the region. Uncompressed files are memory-mapped
+     *  and read through a gfakluge index (<vcf>.gvi), which is created and
+     *  written on first use (and again whenever the VCF's size or modification
+     *  time no longer match the ones it records). Both need the file to be
+     *  sorted. Gzipped files without an index, and stdin, are scanned in full.
+     *  Returns false if the file (or its index) can't be read.
+     */
+    inline bool read_vcf_region(const std::string& filename, const vcf_region& region, contig_variants& cv){
+        cv = contig_variants();
+        cv.name = region.contig;
+        std::int64_t beg = region.start - 1;
+        std::int64_t end = region.end > 0 ? region.end : INT_MAX;
+        auto indexed = [&](const char* line, std::size_t len){
+            vcf_index::record_state st = vcf_index::add_region_record(line, len, region, cv);
+            return st != vcf_index::AFTER_REGION && (st != vcf_index::OTHER_CONTIG || line[0] == '#');
+        };
+        if (filename != "-" && vcf_index::is_gzipped(filename)){
+            bool csi = !vcf_index::file_exists(filename + ".tbi") && vcf_index::file_exists(filename + ".csi");
+            std::string index_file = filename + (csi ? ".csi" : ".tbi");
+            if (csi || vcf_index::file_exists(index_file)){
+                std::uint64_t voffset = 0;
+                int found = vcf_index::find_start_offset(index_file, csi, region.contig, beg, end, voffset);
+                if (found < 0){
+                    std::cerr << "ERROR: could not read index " << index_file << "." << std::endl;
+                    return false;
+                }
+                if (found == 0){
+                    return true;
+                }
+                int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd == -1 || lseek(fd, (off_t) (voffset >> 16), SEEK_SET) == (off_t) -1){
+                    if (fd != -1){
+                        ::close(fd);
+                    }
+                    return false;
+                }
+                gzFile gz = gzdopen(fd, "rb");
+                if (gz == NULL){
+                    ::close(fd);
+                    return false;
+                }
+                std::vector<char> skip((voffset & 0xffff) + 1);
+                if (gzread(gz, skip.data(), voffset & 0xffff) != (int) (voffset & 0xffff)){
+                    gzclose(gz);
+                    return false;
+                }
+                return for_each_line_in_gz(gz, indexed);
+            }
+            std::cerr << "Warning: no .tbi or .csi index for " << filename << "; reading the whole file." << std::endl;
+        }
+        else if (filename != "-"){
+            mapped_file mf;
+            if (!mf.open(filename)){
+                return false;
+            }
+            vcf_index::text_index index;
+            std::string index_file = filename + ".gvi";
+            std::string stamp = vcf_index::file_stamp(filename);
+            if (!vcf_index::read_text_index(index_file, stamp, index)){
+                index.clear();
+                std::cerr << "Creating index for " << filename << "." << std::endl;
+                if (!vcf_index::build_text_index(mf, index)){
+                    std::cerr << "ERROR: " << filename << " is not sorted by contig and position; it cannot be indexed." << std::endl;
+                    return false;
+                }
+                vcf_index::write_text_index(index_file, stamp, index);
+                std::cerr << "Wrote index to file." << std::endl;
+            }
+            auto c = index.find(region.contig);
+            if (c == index.end()){
+                return true;
+            }
+            auto w = c->second.lower_bound(beg >> 14);
+            if (w == c->second.end()){
+                return true;
+            }
+            const char* buf = mf.data();
+            for (std::size_t pos = w->second; pos < mf.size(); ){
+                const char* nl = (const char*) std::memchr(buf + pos, '\n', mf.size() - pos);
+                std::size_t line_end = nl == nullptr ? mf.size() : nl - buf;
+                std::size_t len = line_end - pos - (line_end > pos && buf[line_end - 1] == '\r');
+                if (!indexed(buf + pos, len)){
+                    break;
+                }
+                pos = line_end + 1;
+            }
+            return true;
+        }
+        return for_each_line_in_gzfile(filename, [&](const char* line, std::size_t len){
+                vcf_index::add_region_record(line, len, region, cv);
+                });
+    }
+
+}
+
+#endif
@@ -13,6 +13,8 @@
 #include <iostream>
 #include <bitset>
 #include <unordered_set>
+#include <unordered_map>
+#include <iterator>
 #include <sys/stat.h>
 #include <cstdio>
 #include <sys/types.h>
@@ -20,10 +22,18 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 #include "tinyFA.hpp"
 #include "pliib.hpp"
+#include "gfa_kernels.hpp"
+#include "gfa_stats.hpp"
+#include "gfa_hash.hpp"
+#include "gfa_fasta.hpp"
+#include "gfa_compact_path.hpp"
 
 namespace gfak{
 
@@ -67,7 +77,6 @@ namespace gfak{
         }
     }
 
-
     // Provides the proper sorting behavior,
     // where number-based keys get sorted in numerical order
     // and std::strings are in lexicographic order.
@@ -202,7 +211,7 @@ namespace gfak{
         /**
          *  Writes a path as GFA0.1-style walks to an outstream
          */
-        void write_as_walks(std::ostream& os){
+        void write_as_walks(std::ostream& os) const{
             std::ostringstream st;
             int32_t rank = 0;
             for (size_t i = 0; i < this->segment_names.size(); ++i){
@@ -222,6 +231,16 @@ namespace gfak{
 
     };
 
+    /**
+     *  A path as a GFAKluge stores it: the steps and overlaps of a path_elem
+     *  as a compact_path of handles into the graph's segment_dictionary,
+     *  and its tags.
+     */
+    struct stored_path{
+        compact_path steps;
+        std::map<std::string, opt_elem> opt_fields;
+    };
+
 
     /**
      *  Represents the non-spec alignment line element.
@@ -339,7 +358,7 @@ namespace gfak{
             sink_name = l.sink_name;
             type = 1;
             source_orientation_forward = l.source_orientation_forward;
-            sink_orientation_forward = l.source_orientation_forward;
+            sink_orientation_forward = l.sink_orientation_forward;
             alignment = l.cigar;
             tags = l.opt_fields;
             ends.set(0,1);
@@ -353,7 +372,7 @@ namespace gfak{
             sink_name = c.sink_name;
             type = 2;
             source_orientation_forward = c.source_orientation_forward;
-            sink_orientation_forward = c.source_orientation_forward;
+            sink_orientation_forward = c.sink_orientation_forward;
             alignment = c.cigar;
             tags = c.opt_fields;
             ends.set(0,0);
@@ -364,7 +383,7 @@ namespace gfak{
         }
         std::string id = "*";
         // 0: unset, 1: link, 2: containment, 3: generic edge or both C/L set (which should be impossible)
-        int type;
+        int type = 0;
         std::string source_name;
         std::string sink_name;
         bool source_orientation_forward;
@@ -443,6 +462,58 @@ namespace gfak{
         }
     };
 
+    /**
+     *  Classify an edge. Returns 1 for a dovetail, 2 for a containment and 3
+     *  for any other alignment. Links (which mark both ends of the source and
+     *  carry no sink coordinates) are always dovetails. Otherwise the type is
+     *  used, unless use_coordinates is set: determine_type() only looks at the
+     *  '$' markers, so GFA2 edges are better classified from their coordinates.
+     *  An alignment spanning a whole segment is then a containment, and one
+     *  reaching an end of both segments a dovetail.
+     */
+    inline int classify_edge(const edge_elem& e, bool use_coordinates){
+        if (e.ends.test(0) && e.ends.test(1) && e.sink_begin == 0 && e.sink_end == 0){
+            return 1;
+        }
+        if (!use_coordinates && (e.type == 1 || e.type == 2)){
+            return e.type;
+        }
+        bool b1 = e.source_begin == 0;
+        bool e1 = e.ends.test(1);
+        bool b2 = e.sink_begin == 0;
+        bool e2 = e.ends.test(3);
+        if ((b1 && e1) || (b2 && e2)){
+            return 2;
+        }
+        return ((b1 || e1) && (b2 || e2)) ? 1 : 3;
+    }
+
+    /** The element_hash of an edge (classified as by classify_edge); see hash_record(). **/
+    inline element_hash hash_edge(const edge_elem& e, bool use_coordinates){
+        element_hash h;
+        field_view source(e.source_name.c_str(), e.source_name.length());
+        field_view sink(e.sink_name.c_str(), e.sink_name.length());
+        field_view aln(e.alignment.c_str(), e.alignment.length());
+        int type = classify_edge(e, use_coordinates);
+        if (type == 1 && use_coordinates && e.source_begin == 0 && !e.ends.test(1)){
+            detail::hash_dovetail(sink, e.sink_orientation_forward, source, e.source_orientation_forward, aln, h, nullptr);
+        }
+        else if (type == 1){
+            detail::hash_dovetail(source, e.source_orientation_forward, sink, e.sink_orientation_forward, aln, h, nullptr);
+        }
+        else if (type == 2 && (!use_coordinates || (e.sink_begin == 0 && e.ends.test(3)))){
+            detail::hash_containment(source, e.source_orientation_forward, sink, e.sink_orientation_forward, e.source_begin, aln, h, nullptr);
+        }
+        else if (type == 2){
+            detail::hash_containment(sink, e.sink_orientation_forward, source, e.source_orientation_forward, e.sink_begin, aln, h, nullptr);
+        }
+        else{
+            std::string line = e.to_string_2();
+            hash_record(line.c_str(), line.length(), h);
+        }
+        return h;
+    }
+
         /** Represents a GAP type line ('G'), which is specific to GFA2 */
         struct gap_elem{
             std::string id;
@@ -622,7 +693,12 @@ namespace gfak{
             std::map<std::string, std::vector<contained_elem> > seq_to_contained;
             std::map<std::string, std::vector<link_elem> > seq_to_link;
             std::map<std::string, std::vector<alignment_elem> > seq_to_alignment;
-            std::map<std::string, path_elem> name_to_path;
+            // Paths are stored compactly and decoded to path_elems when
+            // they are read (see encode_path and decode_path).
+            segment_dictionary path_segments;
+            std::map<std::string, stored_path> name_to_path;
+            // GFA0.1 walks, gathered into paths until the file has been read.
+            std::map<std::string, path_elem> walks;
             //Since we can't compare sequence elements for hashing,
             // we cheat and use their names (which are only sort of guaranteed to be
             // unique.
@@ -667,6 +743,32 @@ namespace gfak{
                 return ret;
             }
 
+            /** Store p in s, adding the segments it steps on to path_segments. **/
+            inline void encode_path(const path_elem& p, stored_path& s){
+                std::vector<std::uint64_t> handles(p.segment_names.size());
+                for (std::size_t i = 0; i < handles.size(); ++i){
+                    handles[i] = make_handle(path_segments.rank(p.segment_names[i]), p.orientations[i]);
+                }
+                s.steps.name = p.name;
+                s.steps.encode(handles);
+                s.steps.set_overlaps(p.overlaps);
+                s.opt_fields = p.opt_fields;
+            }
+            /** Decode s into p, replacing its contents. **/
+            inline void decode_path(const stored_path& s, path_elem& p) const{
+                p.name = s.steps.name;
+                p.segment_names.clear();
+                p.orientations.clear();
+                p.segment_names.reserve(s.steps.step_count);
+                p.orientations.reserve(s.steps.step_count);
+                for (auto h : s.steps){
+                    p.segment_names.push_back(path_segments.name(handle_rank(h)));
+                    p.orientations.push_back(handle_is_forward(h));
+                }
+                s.steps.get_overlaps(p.overlaps);
+                p.opt_fields = s.opt_fields;
+            }
+
 
 
             /** GFA 2.0 containers **/
@@ -679,8 +781,6 @@ namespace gfak{
             double l50 = -1;
             double n90 = -1;
             double l90 = -1;
-            double simple_connectivity = -1;
-            double weighted_connectivity = -1;
 
             public:
             GFAKluge(){
@@ -1114,7 +1214,7 @@ namespace gfak{
                         std::vector<std::string> tokens = pliib::split(line, '\t');
                         group_elem g;
                         g.ordered = false;
-                        g.id = tokens[0];
+                        g.id = tokens[1];
                         if (g.id == "*"){
                             g.id = std::to_string(++base_group_id);
                         }
@@ -1151,10 +1251,9 @@ namespace gfak{
             }
 
 
-            // GFAKluge does not, but maybe should, enforce graph structure,
-            // i.e.:
-            // 1. Throw errors on dangling edges
-            // 2. Guarantee contained elements fall in valid sequences
+            // GFAKluge does not enforce graph structure (e.g. dangling edges,
+            // or contained elements that fall outside their sequences);
+            // validate_gfa_file() in gfa_validate.hpp checks a file for these.
 
 
             /**
@@ -1247,17 +1346,31 @@ namespace gfak{
              * Functions for adding paths or walks (which are single elements in an ordered path)
              */
             inline void add_path(std::string pathname, path_elem path){
-                name_to_path[pathname] = path;
+                encode_path(path, name_to_path[pathname]);
             }
+            /**
+             * Walks are gathered into a path_elem, which is stored (as any other path)
+             * by store_walks, once the file has been read.
+             */
             inline void add_walk(std::string pathname, const int& rank, const std::string& segname, const bool& ori, const std::string& overlap, std::vector<opt_elem> opts){
-                if (name_to_path.find(pathname) == name_to_path.end()){
+                if (walks.find(pathname) == walks.end()){
                     path_elem p;
                     p.name = pathname;
-                    add_path(p.name, p);
+                    auto stored = name_to_path.find(pathname);
+                    if (stored != name_to_path.end()){
+                        decode_path(stored->second, p);
+                    }
+                    walks[pathname] = p;
                 }
-                name_to_path.at(pathname).add_ranked_segment( rank, segname, ori, overlap, opts);
+                walks.at(pathname).add_ranked_segment( rank, segname, ori, overlap, opts);
 
             }
+            inline void store_walks(){
+                for (auto& w : walks){
+                    add_path(w.first, w.second);
+                }
+                walks.clear();
+            }
 
             /**
              *  Add a link_elem to represent a link between two sequence_elems.
@@ -1276,7 +1389,7 @@ namespace gfak{
 
 
             /** Versioning functions **/
-            inline double get_version(){
+            inline double get_version() const{
                 return this->version;
             }
             inline void set_version(double version){
@@ -1417,7 +1530,11 @@ namespace gfak{
                 return seq_to_alignment;
             }
             inline std::map<std::string, path_elem> get_name_to_path(){
-                return name_to_path;
+                std::map<std::string, path_elem> paths;
+                for (auto& p : name_to_path){
+                    decode_path(p.second, paths[p.first]);
+                }
+                return paths;
             }
 
             // GFA2 getters
@@ -1434,6 +1551,197 @@ namespace gfak{
                 return groups;
             }
 
+            /** Visitor methods for elements.
+             *  Unlike the getters above, these hand out const references
+             *  into the backing structures rather than copying them, which
+             *  matters for whole-genome graphs.
+             */
+            inline void for_each_sequence(const std::function<void(const sequence_elem&)>& func) const{
+                for (auto& s : name_to_seq){
+                    func(s.second);
+                }
+            }
+            inline void for_each_edge(const std::function<void(const edge_elem&)>& func) const{
+                for (auto& s : seq_to_edges){
+                    for (auto& e : s.second){
+                        func(e);
+                    }
+                }
+            }
+            inline void for_each_fragment(const std::function<void(const fragment_elem&)>& func) const{
+                for (auto& s : seq_to_fragments){
+                    for (auto& f : s.second){
+                        func(f);
+                    }
+                }
+            }
+            inline void for_each_gap(const std::function<void(const gap_elem&)>& func) const{
+                for (auto& s : seq_to_gaps){
+                    for (auto& g : s.second){
+                        func(g);
+                    }
+                }
+            }
+            inline void for_each_group(const std::function<void(const group_elem&)>& func) const{
+                for (auto& g : groups){
+                    func(g.second);
+                }
+            }
+            /** Paths are decoded one at a time, so func must copy any it keeps. **/
+            inline void for_each_path(const std::function<void(const path_elem&)>& func) const{
+                path_elem p;
+                for (auto& s : name_to_path){
+                    decode_path(s.second, p);
+                    func(p);
+                }
+            }
+            /** Visit every path, then every ordered group (GFA2 O line) that
+             *  has no path of the same name, presented as a path_elem.
+             */
+            inline void for_each_ordered_path(const std::function<void(const path_elem&)>& func) const{
+                for_each_path(func);
+                for (auto& g : groups){
+                    if (g.second.ordered && name_to_path.find(g.first) == name_to_path.end()){
+                        path_elem p;
+                        p.name = g.second.id;
+                        p.segment_names = g.second.items;
+                        p.orientations = g.second.orientations;
+                        p.opt_fields = g.second.tags;
+                        func(p);
+                    }
+                }
+            }
+            // Visit only the elements stored relative to a single sequence_elem.
+            inline void for_each_edge(const std::string& seq_name, const std::function<void(const edge_elem&)>& func) const{
+                auto s = seq_to_edges.find(seq_name);
+                if (s != seq_to_edges.end()){
+                    for (auto& e : s->second){
+                        func(e);
+                    }
+                }
+            }
+            inline void for_each_fragment(const std::string& seq_name, const std::function<void(const fragment_elem&)>& func) const{
+                auto s = seq_to_fragments.find(seq_name);
+                if (s != seq_to_fragments.end()){
+                    for (auto& f : s->second){
+                        func(f);
+                    }
+                }
+            }
+            inline void for_each_gap(const std::string& seq_name, const std::function<void(const gap_elem&)>& func) const{
+                auto s = seq_to_gaps.find(seq_name);
+                if (s != seq_to_gaps.end()){
+                    for (auto& g : s->second){
+                        func(g);
+                    }
+                }
+            }
+
+            /** Look up a single element by name without copying it or
+             *  inserting it into the backing map. Returns nullptr if the
+             *  element is not present.
+             */
+            inline const sequence_elem* find_sequence(const std::string& name) const{
+                auto s = name_to_seq.find(name);
+                return s == name_to_seq.end() ? nullptr : &(s->second);
+            }
+            inline bool has_path(const std::string& name) const{
+                return name_to_path.find(name) != name_to_path.end();
+            }
+            /** Decode the path called name into p. Returns false if there is none. Safe to call concurrently. **/
+            inline bool get_path(const std::string& name, path_elem& p) const{
+                auto s = name_to_path.find(name);
+                if (s == name_to_path.end()){
+                    return false;
+                }
+                decode_path(s->second, p);
+                return true;
+            }
+            /** The names of the paths, in order. **/
+            inline std::vector<std::string> path_names() const{
+                std::vector<std::string> names;
+                names.reserve(name_to_path.size());
+                for (auto& p : name_to_path){
+                    names.push_back(p.first);
+                }
+                return names;
+            }
+            /** Approximate heap footprint of the stored paths and of the segment names they share. **/
+            inline std::size_t path_memory_bytes() const{
+                std::size_t b = 0;
+                for (auto& p : name_to_path){
+                    b += p.second.steps.memory_bytes();
+                }
+                return b;
+            }
+            inline std::size_t path_dictionary_bytes() const{
+                return path_segments.memory_bytes();
+            }
+
+            /**
+             *  Append the sequence spelled by path p to seq.
+             *  Reverse steps contribute the reverse complement of their segment.
+             *  Overlaps are not removed. Returns false, leaving seq unmodified,
+             *  if a step's segment is missing or has no sequence.
+             */
+            inline bool append_path_sequence(const path_elem& p, std::string& seq) const{
+                std::vector<const sequence_elem*> steps(p.segment_names.size());
+                std::size_t total = 0;
+                for (std::size_t i = 0; i < p.segment_names.size(); ++i){
+                    steps[i] = find_sequence(p.segment_names[i]);
+                    if (steps[i] == nullptr || steps[i]->sequence == "*"){
+                        std::cerr << "Warning: path " << p.name << " visits segment " << p.segment_names[i] <<
+                            ", which " << (steps[i] == nullptr ? "is missing" : "has no sequence") << "." << std::endl;
+                        return false;
+                    }
+                    total += steps[i]->sequence.length();
+                }
+                std::size_t pos = seq.length();
+                seq.resize(pos + total);
+                for (std::size_t i = 0; i < steps.size(); ++i){
+                    const std::string& s = steps[i]->sequence;
+                    if (p.orientations[i]){
+                        s.copy(&seq[pos], s.length());
+                    }
+                    else{
+                        reverse_complement(s.c_str(), s.length(), &seq[pos]);
+                    }
+                    pos += s.length();
+                }
+                return true;
+            }
+
+            /**
+             *  Write each path in <paths> to os as a FASTA record, in the order given.
+             *  Up to <threads> path sequences are built concurrently and then
+             *  written in order. Paths that cannot be spelled are skipped with a warning.
+             *  Returns the number of records written.
+             */
+            inline std::size_t write_path_fasta(std::ostream& os, const std::vector<const path_elem*>& paths, int threads = 1) const{
+                std::size_t written = 0;
+                std::size_t batch_size = threads > 1 ? threads : 1;
+                std::vector<std::string> records(batch_size);
+                std::vector<char> ok(batch_size);
+                for (std::size_t b = 0; b < paths.size(); b += batch_size){
+                    std::size_t n = std::min(batch_size, paths.size() - b);
+                    #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+                    for (std::size_t i = 0; i < n; ++i){
+                        std::string& r = records[i];
+                        r.clear();
+                        r.append(">").append(paths[b + i]->name).append("\n");
+                        ok[i] = append_path_sequence(*paths[b + i], r);
+                        r.append("\n");
+                    }
+                    for (std::size_t i = 0; i < n; ++i){
+                        if (ok[i]){
+                            os.write(records[i].c_str(), records[i].length());
+                            ++written;
+                        }
+                    }
+                }
+                return written;
+            }
+
             /** 
              * Convert between GFA1 and GFA2 representations internally.
              * paths/groups are conveted to walks and walks to paths,
@@ -1494,14 +1802,16 @@ namespace gfak{
                     }
                     // Paths -> ordered groups
                     //walks_as_paths();
-                    for (auto p : name_to_path){
+                    for (auto& s : name_to_path){
+                        path_elem p;
+                        decode_path(s.second, p);
                         group_elem g;
-                        g.id = p.first;
+                        g.id = s.first;
                         g.ordered = true;
-                        g.items = p.second.segment_names;
-                        g.orientations = p.second.orientations;
+                        g.items = p.segment_names;
+                        g.orientations = p.orientations;
 
-                        g.tags = p.second.opt_fields;
+                        g.tags = p.opt_fields;
                         add_group(g);
                     }
                     this->two_compat = true;
@@ -1521,7 +1831,7 @@ namespace gfak{
                      * warn about missing gaps (we could remove them)
                      * 
                      */
-                    std::string k = name_to_seq.rbegin()->first;
+                    std::string k = name_to_seq.empty() ? "0" : name_to_seq.rbegin()->first;
                     if (string_is_number(k)){
                         base_edge_id = std::stoul(k) + 1;
                     }
@@ -1591,24 +1901,23 @@ namespace gfak{
                 }
 
                 if (name_to_path.size() > 0 && this->version >= 1.0){
-                    std::map<std::string, path_elem>::iterator pt;
-                    for (pt = name_to_path.begin(); pt != name_to_path.end(); ++pt){
+                    for_each_path([&](const path_elem& p){
                         std::stringstream pat;
                         pat << "P" << "\t";
-                        pat << pt->second.name << "\t";
+                        pat << p.name << "\t";
                         std::vector<std::string> ovec;
-                        for (size_t seg_ind = 0; seg_ind < pt->second.segment_names.size(); seg_ind++){
+                        for (size_t seg_ind = 0; seg_ind < p.segment_names.size(); seg_ind++){
                             std::stringstream o_str;
-                            o_str << pt->second.segment_names[seg_ind] << (pt->second.orientations[seg_ind] ? "+" : "-");
+                            o_str << p.segment_names[seg_ind] << (p.orientations[seg_ind] ? "+" : "-");
                             ovec.push_back(o_str.str());
                         }
                         pat << pliib::join(ovec, ",");
-                        if (pt->second.overlaps.size() > 0){
-                            pat << "\t" << pliib::join(pt->second.overlaps, ",");
+                        if (p.overlaps.size() > 0){
+                            pat << "\t" << pliib::join(p.overlaps, ",");
                         }
                         pat << "\n";
                         ret << pat.str();
-                    }
+                    });
                 }
                 for (auto s : name_to_seq){
                     ret << s.second.to_string_1() << std::endl;
@@ -1699,29 +2008,28 @@ namespace gfak{
                 }
 
                 if (name_to_path.size() > 0 && this->version == 1.0){
-                    std::map<std::string, path_elem>::iterator pt;
-                    for (pt = name_to_path.begin(); pt != name_to_path.end(); ++pt){
+                    for_each_path([&](const path_elem& p){
                         std::stringstream pat;
-                        pat << "P\t" << pt->second.name << "\t";
+                        pat << "P\t" << p.name << "\t";
                         std::vector<std::string> ovec;
-                        for (size_t oi = 0; oi < pt->second.segment_names.size(); oi++){
+                        for (size_t oi = 0; oi < p.segment_names.size(); oi++){
                             std::stringstream o_str;
-                            o_str << pt->second.segment_names[oi] << (pt->second.orientations[oi] ? "+" : "-");
+                            o_str << p.segment_names[oi] << (p.orientations[oi] ? "+" : "-");
                             ovec.push_back(o_str.str());
                         }
                         pat << pliib::join(ovec, ",");
-                        if (pt->second.overlaps.size() > 0){
-                            pat << "\t" << pliib::join(pt->second.overlaps, ",");
+                        if (p.overlaps.size() > 0){
+                            pat << "\t" << pliib::join(p.overlaps, ",");
                         }
                         pat << "\n";
                         ret << pat.str();
-                    }
+                    });
                 }
                 else if (this->version < 1.0){
-                    for (auto p : name_to_path){
+                    for_each_path([&](const path_elem& p){
                         std::stringstream st;
-                        p.second.write_as_walks(st);
-                    }
+                        p.write_as_walks(st);
+                    });
                 } 
                 return ret.str();
 
@@ -1855,29 +2163,27 @@ namespace gfak{
                     }
 
                     if (name_to_path.size() > 0 && this->version >= 1.0){
-                        std::map<std::string, path_elem>::iterator pt;
-                        for (pt = name_to_path.begin(); pt != name_to_path.end(); ++pt){
+                        for_each_path([&](const path_elem& p){
                             std::stringstream pat;
-                            pat << "P\t" << pt->second.name << "\t";
+                            pat << "P\t" << p.name << "\t";
                             std::vector<std::string> ovec;
-                            for (size_t oi = 0; oi < pt->second.segment_names.size(); oi++){
+                            for (size_t oi = 0; oi < p.segment_names.size(); oi++){
                                 std::stringstream o_str;
-                                o_str << pt->second.segment_names[oi] << (pt->second.orientations[oi] ? "+" : "-");
+                                o_str << p.segment_names[oi] << (p.orientations[oi] ? "+" : "-");
                                 ovec.push_back(o_str.str());
                             }
                             pat << pliib::join(ovec, ",");
-                            if (pt->second.overlaps.size() > 0){
-                                pat << "\t" << pliib::join(pt->second.overlaps, ",");
+                            if (p.overlaps.size() > 0){
+                                pat << "\t" << pliib::join(p.overlaps, ",");
                             }
                             pat << "\n";
                             os << pat.str();
-                        }
+                        });
                     }
                     else if (this->version < 1.0 && name_to_path.size() > 0){
-                        std::map<std::string, path_elem>::iterator pt;
-                        for (pt = name_to_path.begin(); pt != name_to_path.end(); pt++){
-                            pt->second.write_as_walks(os);
-                        }
+                        for_each_path([&](const path_elem& p){
+                            p.write_as_walks(os);
+                        });
                     }
 
 
@@ -1889,30 +2195,28 @@ namespace gfak{
                     }
 
                     if (name_to_path.size() > 0 && this->version >= 1.0){
-                        std::map<std::string, path_elem>::iterator pt;
-                        for (pt = name_to_path.begin(); pt != name_to_path.end(); ++pt){
+                        for_each_path([&](const path_elem& p){
                             std::stringstream pat;
                             pat << "P" << "\t";
-                            pat << pt->second.name << "\t";
+                            pat << p.name << "\t";
                             std::vector<std::string> ovec;
-                            for (size_t seg_ind = 0; seg_ind < pt->second.segment_names.size(); seg_ind++){
+                            for (size_t seg_ind = 0; seg_ind < p.segment_names.size(); seg_ind++){
                                 std::stringstream o_str;
-                                o_str << pt->second.segment_names[seg_ind] << (pt->second.orientations[seg_ind] ? "+" : "-");
+                                o_str << p.segment_names[seg_ind] << (p.orientations[seg_ind] ? "+" : "-");
                                 ovec.push_back(o_str.str());
                             }
                             pat << pliib::join(ovec, ",");
-                            if (pt->second.overlaps.size() > 0){
-                                pat << "\t" << pliib::join(pt->second.overlaps, ",");
+                            if (p.overlaps.size() > 0){
+                                pat << "\t" << pliib::join(p.overlaps, ",");
                             }
                             pat << "\n";
                             os << pat.str();
-                        }
+                        });
                     }
                     else if (this->version < 1.0 && name_to_path.size() > 0){
-                        std::map<std::string, path_elem>::iterator pt;
-                        for (pt = name_to_path.begin(); pt != name_to_path.end(); pt++){
-                            pt->second.write_as_walks(os);
-                        }
+                        for_each_path([&](const path_elem& p){
+                            p.write_as_walks(os);
+                        });
                     }
 
                     for (auto s : name_to_seq){
@@ -1964,326 +2268,767 @@ namespace gfak{
             }
             /** Bump the IDs of sequence-, edge-, fragment-, gap-, and group_elems to 
              *  be greater than new_mx. Useful for concatenating graphs.
+             *  Segments with numeric names are numbered consecutively from the
+             *  new segment ID, in order; segments with other names keep them,
+             *  unless compact_names is set, in which case they are numbered too.
+             *  The old -> new names are put in a table once, and edges, gaps,
+             *  fragments, groups and paths are then rewritten through it on
+             *  <threads> threads. Elements are moved rather than copied, so the
+             *  graph is never held twice.
              */
-            inline void re_id(std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t>& new_mx){
+            inline void re_id(std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t>& new_mx,
+                    int threads = 1, bool compact_names = false){
 
                 base_seq_id = std::get<0>(new_mx);
                 base_edge_id = std::get<1>(new_mx);
                 base_frag_id = std::get<2>(new_mx);
                 base_gap_id = std::get<3>(new_mx);
                 base_group_id = std::get<4>(new_mx);
-                std::uint64_t seg_diff = base_seq_id;
-                // Segments
-                //int num_segs = name_to_seq.size();
+                int nthreads = threads > 1 ? threads : 1;
 
-                // locally cache name_to_seq,
-                // seq_to_edges, seq_to_fragments, groups,
-                // and seq_to_gaps before clearing them.
+                // Segments, and the remap table. Each segment's edges, fragments
+                // and gaps move with it to its new name.
+                std::unordered_map<std::string, std::string> remap;
+                remap.reserve(name_to_seq.size());
                 std::map<std::string, sequence_elem, custom_key> n_s;
                 std::map<std::string, std::vector<edge_elem>> s_e;
                 std::map<std::string, std::vector<fragment_elem>> s_f;
                 std::map<std::string, std::vector<gap_elem>> s_g;
-                std::map<std::string, group_elem> g_g;
-
-                for (auto ns : name_to_seq){
-                    std::string old_name = ns.second.name;
-                    ns.second.id = ++base_seq_id;
-                    ns.second.name = std::to_string(ns.second.id);    
-
-
-                    // Paths
-
-
-
-                    //uint64_t edge_count = 0;
-                    // Edges
-                    for (auto e : seq_to_edges[old_name]){
-                        e.source_name = ns.second.name;
-                        e.sink_name = std::to_string(seg_diff + stoul(e.sink_name));
-                        e.id = std::to_string(++base_edge_id);
-                        //add_edge(e.source_name, e);
-                        s_e[e.source_name].push_back(e);
-                    }
-                    // Fragments
-                    for (auto f : seq_to_fragments[old_name]){
-                        f.id = ns.second.name;
-                        //add_fragment(f.id, f);
-                        s_f[f.id].push_back(f);
-                    }
-                    // Gaps
-                    for (auto g : seq_to_gaps[old_name]){
-                        g.id = std::to_string(++base_gap_id);
-                        g.source_name = ns.second.name;
-                        g.sink_name = std::to_string(seg_diff + stoul(g.sink_name));
-                        s_g[g.source_name].push_back(g);
-                        //add_gap(g);
-                    }
-
-                    // Groups
-                    for (auto g : groups){
-                        //We may not want to increment group IDs, as they might represent unique paths!
-                        //g.second.id = to_string(++base_group_id);
-                        for (size_t i = 0; i < g.second.items.size(); ++i){
-                            g.second.items[i] = std::to_string(seg_diff + stoul(g.second.items[i]));
-                        }
-                        g_g[g.first] = g.second;
-                        //add_group(g.second);
-                    }
-
-                    //add_sequence(ns.second);
-
-                    n_s[ns.second.name] = ns.second;
-                }
-
-                // Clear our internal std::maps
-                name_to_seq = n_s;
-                seq_to_edges = s_e;
-                seq_to_fragments = s_f;
-                seq_to_gaps = s_g;
-                groups = g_g;
+                std::vector<std::vector<edge_elem>*> edge_lists;
+                std::vector<std::vector<gap_elem>*> gap_lists;
+                std::vector<std::uint64_t> edge_starts;
+                std::vector<std::uint64_t> gap_starts;
+                std::uint64_t next_edge = base_edge_id;
+                std::uint64_t next_gap = base_gap_id;
+                for (auto& ns : name_to_seq){
+                    sequence_elem& seq = ns.second;
+                    const std::string& old_name = ns.first;
+                    if (compact_names || string_is_number(old_name)){
+                        seq.id = ++base_seq_id;
+                        seq.name = std::to_string(seq.id);
+                        remap[old_name] = seq.name;
+                    }
+                    auto e = seq_to_edges.find(old_name);
+                    if (e != seq_to_edges.end()){
+                        std::vector<edge_elem>& edges = s_e[seq.name];
+                        edges = std::move(e->second);
+                        seq_to_edges.erase(e);
+                        edge_lists.push_back(&edges);
+                        edge_starts.push_back(next_edge);
+                        next_edge += edges.size();
+                    }
+                    auto f = seq_to_fragments.find(old_name);
+                    if (f != seq_to_fragments.end()){
+                        std::vector<fragment_elem>& frags = s_f[seq.name];
+                        frags = std::move(f->second);
+                        seq_to_fragments.erase(f);
+                        for (auto& x : frags){
+                            x.id = seq.name;
+                        }
+                    }
+                    auto g = seq_to_gaps.find(old_name);
+                    if (g != seq_to_gaps.end()){
+                        std::vector<gap_elem>& gaps = s_g[seq.name];
+                        gaps = std::move(g->second);
+                        seq_to_gaps.erase(g);
+                        gap_lists.push_back(&gaps);
+                        gap_starts.push_back(next_gap);
+                        next_gap += gaps.size();
+                    }
+                    n_s.insert(std::make_pair(seq.name, std::move(seq)));
+                }
+                name_to_seq.swap(n_s);
+                n_s.clear();
+                base_edge_id = next_edge;
+                base_gap_id = next_gap;
+                // Elements whose source isn't a segment keep their key.
+                for (auto& e : seq_to_edges){
+                    std::vector<edge_elem>& edges = s_e[e.first];
+                    edges.insert(edges.end(), std::make_move_iterator(e.second.begin()), std::make_move_iterator(e.second.end()));
+                }
+                for (auto& f : seq_to_fragments){
+                    std::vector<fragment_elem>& frags = s_f[f.first];
+                    frags.insert(frags.end(), std::make_move_iterator(f.second.begin()), std::make_move_iterator(f.second.end()));
+                }
+                for (auto& g : seq_to_gaps){
+                    std::vector<gap_elem>& gaps = s_g[g.first];
+                    gaps.insert(gaps.end(), std::make_move_iterator(g.second.begin()), std::make_move_iterator(g.second.end()));
+                }
+                seq_to_edges.swap(s_e);
+                seq_to_fragments.swap(s_f);
+                seq_to_gaps.swap(s_g);
+
+                auto rename = [&](std::string& name){
+                    auto r = remap.find(name);
+                    if (r != remap.end()){
+                        name = r->second;
+                    }
+                };
+
+                // Edges and gaps get consecutive IDs in segment order.
+                #pragma omp parallel for schedule(dynamic, 256) num_threads(nthreads)
+                for (std::size_t i = 0; i < edge_lists.size(); ++i){
+                    std::uint64_t id = edge_starts[i];
+                    for (auto& e : *edge_lists[i]){
+                        rename(e.source_name);
+                        rename(e.sink_name);
+                        e.id = std::to_string(++id);
+                    }
+                }
+                #pragma omp parallel for schedule(dynamic, 256) num_threads(nthreads)
+                for (std::size_t i = 0; i < gap_lists.size(); ++i){
+                    std::uint64_t id = gap_starts[i];
+                    for (auto& g : *gap_lists[i]){
+                        rename(g.source_name);
+                        rename(g.sink_name);
+                        g.id = std::to_string(++id);
+                    }
+                }
+
+                // Groups and paths keep their names.
+                std::vector<group_elem*> group_list;
+                group_list.reserve(groups.size());
+                for (auto& g : groups){
+                    group_list.push_back(&g.second);
+                }
+                #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+                for (std::size_t i = 0; i < group_list.size(); ++i){
+                    for (auto& item : group_list[i]->items){
+                        rename(item);
+                    }
+                }
+                // Paths share one copy of each segment name.
+                path_segments.rename(rename);
 
             }
             /** Bump the IDs of each type of GFA2 element so that the lowest ID
              *  for each type is defined by new_mx, which is a colon-delimited std::string.
              */
-            inline void re_id(std::string new_mx_str){
+            inline void re_id(std::string new_mx_str, int threads = 1, bool compact_names = false){
                 std::vector<uint64_t> starts(5);
                 std::vector<std::string> starts_strs = pliib::split(new_mx_str, ':');
-                for (size_t i = 0; i < starts_strs.size(); ++i){
+                for (size_t i = 0; i < starts_strs.size() && i < starts.size(); ++i){
                     starts[i] = stoul(starts_strs[i]);
                 }
                 std::tuple<std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t> n_ids = std::make_tuple(starts[0], starts[1],
                         starts[2], starts[3], starts[4]);
-                re_id(n_ids);
+                re_id(n_ids, threads, compact_names);
 
             }
 
-            /** Merge two GFA graphs **/
+            /** Merge (concatenate) another graph into this one.
+             *  Segments are hash-joined on name: one whose name is already in
+             *  use is given a fresh name (the next unused number for numeric
+             *  names, name_<n> otherwise) rather than dropped. Edges, gaps,
+             *  fragments, groups and paths are then copied in a single pass
+             *  through the table of renames, and colliding edge, gap, group
+             *  and path IDs are renamed too.
+             */
             // TODO check incompatible version numbers
-            // TODO Check colliding groups, headers
             inline void merge(GFAKluge& gg){
-                std::unordered_set<std::string> seg_ids;
                 // Merge headers
-                for (auto h : gg.get_header()){
+                for (auto& h : gg.header){
                     header[h.first] = h.second;
                 }
-                for (auto s : this->get_name_to_seq()){
-                    seg_ids.insert(s.first);
-                }
 
-                std::map<std::string, sequence_elem, custom_key> ss = gg.get_name_to_seq();
-                std::map<std::string, std::vector<fragment_elem>> sf = gg.get_seq_to_fragments();
-                std::map<std::string, std::vector<gap_elem>> sg = gg.get_seq_to_gaps();
-                std::map<std::string, std::vector<edge_elem>> se = gg.get_seq_to_edges();
-
-                if (this->two_compat){
-                    for (auto s : ss){
-                        if (!seg_ids.count(s.second.name)){
-                            this->add_sequence(s.second);
-                            for (auto e : se){
-                                seq_to_edges.insert(e);
-                                //this->add_edge(e.source_name, e);
-                            }
-                            for (auto g : sg[s.first]){
-                                this->add_gap(g);
+                // Segments
+                std::unordered_map<std::string, std::string> renames;
+                std::uint64_t next_numeric = 0;
+                bool have_next_numeric = false;
+                auto in_use = [&](const std::string& name){
+                    return name_to_seq.count(name) || gg.name_to_seq.count(name);
+                };
+                auto fresh_name = [&](const std::string& name){
+                    if (string_is_number(name)){
+                        if (!have_next_numeric){
+                            for (auto& x : name_to_seq){
+                                if (string_is_number(x.first)){
+                                    next_numeric = std::max(next_numeric, (std::uint64_t) std::stoull(x.first));
+                                }
                             }
-                            for (auto f : sf[s.first]){
-                                this->add_fragment(s.first, f);
+                            for (auto& x : gg.name_to_seq){
+                                if (string_is_number(x.first)){
+                                    next_numeric = std::max(next_numeric, (std::uint64_t) std::stoull(x.first));
+                                }
                             }
+                            have_next_numeric = true;
                         }
-                        else{
-                            std::cerr << "WARNING: DUPLICATE IDS " << s.second.name << std::endl <<
-                                " will be lost." << std::endl;
+                        return std::to_string(++next_numeric);
+                    }
+                    std::uint64_t n = 1;
+                    std::string candidate;
+                    do{
+                        candidate = name + "_" + std::to_string(n++);
+                    } while (in_use(candidate) || renames.count(candidate));
+                    return candidate;
+                };
+                for (auto& ns : gg.name_to_seq){
+                    if (!name_to_seq.count(ns.first)){
+                        name_to_seq[ns.first] = ns.second;
+                    }
+                    else{
+                        sequence_elem s = ns.second;
+                        s.name = fresh_name(ns.first);
+                        if (string_is_number(s.name)){
+                            s.id = std::stoull(s.name);
+                        }
+                        renames[ns.first] = s.name;
+                        name_to_seq[s.name] = s;
+                    }
+                }
+                if (!renames.empty()){
+                    std::cerr << "Renamed " << renames.size() << " segments whose names were already in use." << std::endl;
+                }
+                auto rename = [&](std::string& name){
+                    auto r = renames.find(name);
+                    if (r != renames.end()){
+                        name = r->second;
+                    }
+                };
+
+                // Edges. IDs other than * are only collected if some incoming edge has one.
+                std::unordered_set<std::string> edge_ids;
+                bool have_edge_ids = false;
+                for (auto& se : gg.seq_to_edges){
+                    for (auto e : se.second){
+                        rename(e.source_name);
+                        rename(e.sink_name);
+                        if (e.id != "*"){
+                            if (!have_edge_ids){
+                                for (auto& x : seq_to_edges){
+                                    for (auto& y : x.second){
+                                        if (y.id != "*"){
+                                            edge_ids.insert(y.id);
+                                        }
+                                    }
+                                }
+                                have_edge_ids = true;
+                            }
+                            if (!edge_ids.insert(e.id).second){
+                                e.id = "*";
+                            }
                         }
-                        for (auto g : gg.get_groups()){
-                            this->add_group(g.second);
+                        add_edge(e.source_name, e);
+                    }
+                }
+
+                // Gaps
+                std::unordered_set<std::string> gap_ids;
+                for (auto& sg : seq_to_gaps){
+                    for (auto& g : sg.second){
+                        gap_ids.insert(g.id);
+                    }
+                }
+                for (auto& sg : gg.seq_to_gaps){
+                    for (auto g : sg.second){
+                        rename(g.source_name);
+                        rename(g.sink_name);
+                        if (g.id != "*" && !gap_ids.insert(g.id).second){
+                            g.id = "*";
                         }
+                        add_gap(g);
                     }
                 }
-                else if (one_compat){
 
+                // Fragments, which are keyed by (and named after) their segment.
+                for (auto& sf : gg.seq_to_fragments){
+                    for (auto f : sf.second){
+                        rename(f.id);
+                        add_fragment(f.id, f);
+                    }
+                }
+
+                // Groups and paths
+                for (auto& gp : gg.groups){
+                    group_elem g = gp.second;
+                    for (auto& item : g.items){
+                        rename(item);
+                    }
+                    if (groups.count(g.id)){
+                        std::uint64_t n = 1;
+                        std::string id;
+                        do{
+                            id = g.id + "_" + std::to_string(n++);
+                        } while (groups.count(id) || gg.groups.count(id));
+                        g.id = id;
+                    }
+                    add_group(g);
+                }
+                for (auto& pp : gg.name_to_path){
+                    path_elem p;
+                    gg.decode_path(pp.second, p);
+                    for (auto& seg : p.segment_names){
+                        rename(seg);
+                    }
+                    if (name_to_path.count(p.name)){
+                        std::uint64_t n = 1;
+                        std::string name;
+                        do{
+                            name = pp.first + "_" + std::to_string(n++);
+                        } while (name_to_path.count(name) || gg.name_to_path.count(name));
+                        p.name = name;
+                    }
+                    add_path(p.name, p);
+                    // Paths of a GFA1 graph only become groups when the graph
+                    // is converted, which has already happened to a GFA2 graph.
+                    if (two_compat && !groups.count(p.name)){
+                        group_elem g;
+                        g.id = p.name;
+                        g.ordered = true;
+                        g.items = p.segment_names;
+                        g.orientations = p.orientations;
+                        g.tags = p.opt_fields;
+                        add_group(g);
+                    }
                 }
 
+                // GFA1-only containers
+                for (auto& sa : gg.seq_to_alignment){
+                    std::string name = sa.first;
+                    rename(name);
+                    for (auto a : sa.second){
+                        rename(a.source_name);
+                        seq_to_alignment[name].push_back(a);
+                    }
+                }
             }
 
             /** Assembly stats **/
             // we calculate the N50 based on the 'S' lines,
             // Though in theory an O line might also be a contig
-            inline double get_N50(){
-                std::vector<double> s_lens;
-                uint64_t total_len = 0;
-                double n = 0.0;
-                for (auto s = name_to_seq.begin(); s != name_to_seq.end(); s++){
-                    s_lens.push_back(s->second.length);
-                    total_len += s->second.length;
-                }
-                double avg = total_len * 0.50 ;
-                std::sort(s_lens.begin(), s_lens.end());
-                //int middle = floor((double) s_lens.size() / 2.0);
-                double cumul_size = 0.0;
-                for (size_t i = 0; i < s_lens.size(); i++){
-                    cumul_size += s_lens[i];
-                    if (cumul_size >= avg){
-                        n = s_lens[i];
-                        break;
+            /** The lengths of all segments with a known length. **/
+            inline std::vector<std::uint64_t> get_segment_lengths() const{
+                std::vector<std::uint64_t> lengths;
+                lengths.reserve(name_to_seq.size());
+                for (auto& s : name_to_seq){
+                    if (s.second.length != UINT64_MAX){
+                        lengths.push_back(s.second.length);
+                    }
+                    else if (s.second.sequence != "*"){
+                        lengths.push_back(s.second.sequence.length());
                     }
                 }
-                return n;
+                return lengths;
+            }
+            /** Nx / Lx / NGx / LGx for each x in xs, plus auN, auNG and a length histogram,
+             *  computed with a single sort of the segment lengths.
+             */
+            inline contiguity_stats get_contiguity(const std::vector<double>& xs, const std::uint64_t& genome_size = 0) const{
+                std::vector<std::uint64_t> lengths = get_segment_lengths();
+                return contiguity(lengths, xs, genome_size);
+            }
+            inline double get_N50(){
+                return get_contiguity({50.0}).nx[0];
             }
             inline double get_N90(){
-                std::vector<double> s_lens;
-                uint64_t total_len = 0;
-                double n = 0.0;
-                for (auto s = name_to_seq.begin(); s != name_to_seq.end(); s++){
-                    s_lens.push_back(s->second.length);
-                    total_len += s->second.length;
-                }
-                double avg = total_len * 0.90;
-                std::sort(s_lens.rbegin(), s_lens.rend());
-                //int middle = floor((double) s_lens.size() / 2.0);
-                double cumul_size = 0.0;
-                for (size_t i = 0; i < s_lens.size(); i++){
-                    cumul_size += s_lens[i];
-                    if (cumul_size >= avg){
-                        n = s_lens[i];
-                        break;
-                    }
-                }
-                return n;
+                return get_contiguity({90.0}).nx[0];
             }
-
             inline int get_L50(){
-                std::vector<double> s_lens;
-                uint64_t total_len = 0;
-                for (auto s = name_to_seq.begin(); s != name_to_seq.end(); s++){
-                    s_lens.push_back(s->second.length);
-                    total_len += s->second.length;
-                }
-                double avg = total_len * 0.50;
-                std::sort(s_lens.rbegin(), s_lens.rend());
-                //int middle = floor((double) s_lens.size() / 2.0);
-                double cumul_size = 0.0;
-                for (size_t i = 0; i < s_lens.size(); i++){
-                    cumul_size += s_lens[i];
-                    if (cumul_size >= avg){
-                        return i + 1;
+                return get_contiguity({50.0}).lx[0];
+            }
+            inline int get_L90(){
+                return get_contiguity({90.0}).lx[0];
+            }
+
+            /** Base composition (GC, AT, N, other and soft-masked counts) of
+             *  all segment sequences. Segments without a sequence are skipped.
+             */
+            inline base_composition get_composition() const{
+                base_composition comp;
+                for (auto& s : name_to_seq){
+                    if (s.second.sequence != "*"){
+                        add_composition(s.second.sequence, comp);
                     }
                 }
-                return -1;
+                return comp;
             }
 
-            inline int get_L90(){
-                std::vector<double> s_lens;
-                uint64_t total_len = 0;
-                for (auto s = name_to_seq.begin(); s != name_to_seq.end(); s++){
-                    s_lens.push_back(s->second.length);
-                    total_len += s->second.length;
-                }
-                double avg = total_len * 0.90;
-                std::sort(s_lens.rbegin(), s_lens.rend());
-                //int middle = floor((double) s_lens.size() / 2.0);
-                double cumul_size = 0.0;
-                for (size_t i = 0; i < s_lens.size(); i++){
-                    cumul_size += s_lens[i];
-                    if (cumul_size >= avg){
-                        return i + 1;
+            /**
+             *  An order-independent hash of the graph's segments (name, length and
+             *  sequence), edges (canonicalized, so a link hashes the same from either
+             *  strand), paths and ordered groups (their steps), unordered groups,
+             *  fragments and gaps. Tags and IDs of edges are ignored, so the same graph
+             *  gives the same fingerprint whatever its line order or GFA version, and
+             *  the same as `hash_record` over the lines of a file holding it.
+             */
+            inline graph_fingerprint fingerprint(int threads = 1) const{
+                std::vector<const sequence_elem*> seqs;
+                std::vector<const edge_elem*> edges;
+                std::vector<path_elem> paths;
+                std::vector<const group_elem*> sets;
+                std::vector<std::string> lines;
+                for_each_sequence([&](const sequence_elem& s){
+                        seqs.push_back(&s);
+                        });
+                for_each_edge([&](const edge_elem& e){
+                        edges.push_back(&e);
+                        });
+                for_each_ordered_path([&](const path_elem& p){
+                        paths.push_back(p);
+                        });
+                for (auto& g : groups){
+                    if (!g.second.ordered){
+                        sets.push_back(&g.second);
+                    }
+                }
+                for_each_fragment([&](const fragment_elem& f){
+                        lines.push_back(f.to_string_2());
+                        });
+                for_each_gap([&](const gap_elem& g){
+                        lines.push_back(g.to_string_2());
+                        });
+
+                // Edges of a GFA2 graph come from E lines, whose coordinates
+                // classify them better than their type.
+                bool gfa2 = version >= 2.0;
+                int nthreads = threads > 1 ? threads : 1;
+                std::vector<graph_fingerprint> partial(nthreads);
+                std::size_t n = seqs.size() + edges.size() + paths.size() + sets.size() + lines.size();
+                #pragma omp parallel for schedule(dynamic, 1024) num_threads(nthreads)
+                for (std::size_t i = 0; i < n; ++i){
+#ifdef _OPENMP
+                    graph_fingerprint& fp = partial[omp_get_thread_num()];
+#else
+                    graph_fingerprint& fp = partial[0];
+#endif
+                    element_hash h;
+                    std::size_t j = i;
+                    if (j < seqs.size()){
+                        const sequence_elem& s = *seqs[j];
+                        std::uint64_t length = s.length != UINT64_MAX ? s.length : 0;
+                        if (s.length == UINT64_MAX && s.sequence != "*"){
+                            length = s.sequence.length();
+                        }
+                        for (auto& o : s.opt_fields){
+                            if (s.length == UINT64_MAX && s.sequence == "*" && o.key == "LN"){
+                                length = std::stoull(o.val);
+                            }
+                        }
+                        detail::hash_segment(field_view(s.name.c_str(), s.name.length()), length,
+                                field_view(s.sequence.c_str(), s.sequence.length()), h, nullptr);
+                        fp.add(h);
+                        continue;
+                    }
+                    j -= seqs.size();
+                    if (j < edges.size()){
+                        fp.add(hash_edge(*edges[j], gfa2));
+                        continue;
+                    }
+                    j -= edges.size();
+                    if (j < paths.size()){
+                        const path_elem& p = paths[j];
+                        detail::hash_path(field_view(p.name.c_str(), p.name.length()), h, nullptr);
+                        for (std::size_t k = 0; k < p.segment_names.size(); ++k){
+                            h.content = detail::hash_step(h.content, p.segment_names[k].c_str(),
+                                    p.segment_names[k].length(), p.orientations[k]);
+                        }
+                        fp.add(h);
+                        continue;
+                    }
+                    j -= paths.size();
+                    if (j < sets.size()){
+                        std::string line = sets[j]->to_string_2();
+                        hash_record(line.c_str(), line.length(), h);
+                        fp.add(h);
+                        continue;
                     }
+                    j -= sets.size();
+                    hash_record(lines[j].c_str(), lines[j].length(), h);
+                    fp.add(h);
                 }
-                return -1;
+                graph_fingerprint ret;
+                for (auto& fp : partial){
+                    ret += fp;
+                }
+                return ret;
             }
-            // uint64_t num_contigs();
-            // double simple_connectivity() // reports avg edges / sequence
-            // double weighted_connectivity() // weight areas of high connectivity higher
-            //      behaves kind of like [(N_edges)^2 / (N_seqs)^2 if N_edges > 2]
 
             /** Given the name of a FASTA file,
              *  fill in the sequence field of each sequence_elem with an entry from
-             *  that file with a correspondinmg name. If no entry is present, maintain
+             *  that file with a corresponding name. If no entry is present, maintain
              *  the "*" placeholder that should be present in that element's sequence field.
+             *
+             *  The FASTA file is memory-mapped and its index (created if missing) is used
+             *  to sort the wanted records by file offset, so the file is read front to back;
+             *  sequences are then copied straight into their segments on up to <threads> threads.
+             *  Returns the number of segments filled.
              */
-            inline void fill_sequences(const char* fasta_file){
-
-                TFA::tiny_faidx_t tf;
-                if (TFA::checkFAIndexFileExists(fasta_file)){
-                    TFA::parseFAIndex(fasta_file, tf);
+            inline std::uint64_t fill_sequences(const char* fasta_file, int threads = 1){
+                const mapped_fasta* fap = open_fasta(fasta_file);
+                if (fap == nullptr){
+                    std::cerr << "Error: could not open FASTA file " << fasta_file << "." << std::endl;
+                    return 0;
+                }
+                const mapped_fasta& fa = *fap;
+                std::vector<std::pair<const fasta_record*, sequence_elem*>> targets;
+                for (auto& s : name_to_seq){
+                    const fasta_record* r = fa.find(s.second.name);
+                    if (r != nullptr){
+                        targets.push_back(std::make_pair(r, &s.second));
+                    }
+                }
+                std::sort(targets.begin(), targets.end(), [](const std::pair<const fasta_record*, sequence_elem*>& a,
+                            const std::pair<const fasta_record*, sequence_elem*>& b){
+                        return a.first->offset < b.first->offset;
+                        });
+
+                int nthreads = threads > 1 ? threads : 1;
+                std::vector<char> filled(targets.size(), 0);
+                #pragma omp parallel for schedule(dynamic, 64) num_threads(nthreads)
+                for (std::size_t i = 0; i < targets.size(); ++i){
+                    sequence_elem& s = *targets[i].second;
+                    std::string old_sequence;
+                    old_sequence.swap(s.sequence);
+                    if (fa.get_sequence(*targets[i].first, s.sequence)){
+                        if (s.length == UINT64_MAX){
+                            s.length = s.sequence.length();
+                        }
+                        filled[i] = 1;
+                    }
+                    else{
+                        s.sequence.swap(old_sequence);
+                    }
                 }
-                else{
-                    std::cerr << "Creating index for " << fasta_file << "." << std::endl;
-                    TFA::createFAIndex(fasta_file, tf);
-                    std::cerr << "Created index." << std::endl;
-                    TFA::writeFAIndex(fasta_file, tf);
-                    std::cerr << "Wrote index to file." << std::endl;
+                std::uint64_t n = 0;
+                for (std::size_t i = 0; i < targets.size(); ++i){
+                    if (filled[i]){
+                        ++n;
+                    }
+                    else{
+                        std::cerr << "Warning: FASTA record " << targets[i].first->name
+                            << " does not match the index of " << fasta_file << "; not filled." << std::endl;
+                    }
                 }
+                return n;
+            }
 
-                for (std::map<std::string, sequence_elem, custom_key>::iterator it = name_to_seq.begin(); it != name_to_seq.end(); it++){
-                    if (tf.hasSeqID(it->second.name.c_str())){
-                        char* s;
-                        TFA::getSequence(tf, it->second.name.c_str(), s);
-                        it->second.sequence.assign(s);
-                        // The length field should already be filled, but it
-                        // might be good to check.
-                        delete [] s;
-                    }
+            /** Convert soft-masked (lowercase) bases in all segment sequences to uppercase. **/
+            inline void sequences_to_upper(){
+                for (auto& s : name_to_seq){
+                    to_upper(s.second.sequence);
                 }
             }
 
             /**
-             * Remove any sequence_elems (and any edges connected to them) that have
-             * a sequence shorter than a certain length.
+             * Remove any sequence_elems shorter than minlen, without a length or
+             * (if no_ambiguous is set) with non-ACGT bases in their sequence, along with
+             * every edge, fragment and gap that touches them.
+             *
+             * Paths and ordered groups that step on a removed sequence are dropped, or, if
+             * split_paths is set, split into the runs of steps between removed sequences,
+             * named <name>_1, <name>_2, ... (a path with a single run keeps its name),
+             * skipping names that another path or group already has.
+             * Removed sequences are dropped from unordered groups.
+             *
+             * Segments are first marked in parallel on up to <threads> threads,
+             * then every container is compacted in a single pass.
              * Returns true if the graph is modified.
              */
-            inline bool trim_seqs(const int& minlen = 0, const bool& no_ambiguous = false){
-                bool graph_modified = false;
-
-                std::unordered_set<std::string> dropped_seqs;
-                std::map<std::string, sequence_elem, custom_key>::iterator n_to_s;
-                for (n_to_s = name_to_seq.begin(); n_to_s != name_to_seq.end(); n_to_s++){
-                    auto& s = n_to_s->second;
-                    if (s.length == UINT64_MAX){
-                        std::cerr << "Length unset for sequence " << s.name << "; removing from graph." << std::endl;
-                        dropped_seqs.insert(s.name);
-                        name_to_seq.erase(n_to_s);
-                        graph_modified = true;
-                    }
-                    else if (minlen > 0 && s.length < (size_t)minlen){
-                        dropped_seqs.insert(s.name);
-                        name_to_seq.erase(n_to_s);
-                        graph_modified = true;
-                    }
-
-                    if (no_ambiguous && !pliib::canonical(s.sequence)){
-                        dropped_seqs.insert(s.name);
-                        name_to_seq.erase(n_to_s);
-                        graph_modified = true;
-                    }
-                }
-
-                std::map<std::string, std::vector<edge_elem>>::iterator s_to_e;
-                for (s_to_e = seq_to_edges.begin(); s_to_e != seq_to_edges.end(); s_to_e++){
-                    // Remove all edges that have dropped sequences as their source.
-                    if (dropped_seqs.find(s_to_e->first) != dropped_seqs.end()){
-                        seq_to_edges.erase(s_to_e);
-                        graph_modified = true;
+            inline bool trim_seqs(const int& minlen = 0, const bool& no_ambiguous = false,
+                    const bool& split_paths = false, int threads = 1){
+                // Mark
+                std::vector<const sequence_elem*> seqs;
+                seqs.reserve(name_to_seq.size());
+                for (auto& s : name_to_seq){
+                    seqs.push_back(&s.second);
+                }
+                std::vector<char> drop(seqs.size(), 0);
+                int nthreads = threads > 1 ? threads : 1;
+                #pragma omp parallel for schedule(dynamic, 1024) num_threads(nthreads)
+                for (std::size_t i = 0; i < seqs.size(); ++i){
+                    const sequence_elem& s = *seqs[i];
+                    std::uint64_t len = s.length != UINT64_MAX ? s.length :
+                        (s.sequence != "*" ? s.sequence.length() : UINT64_MAX);
+                    if (len == UINT64_MAX){
+                        drop[i] = 2;
+                    }
+                    else if ((minlen > 0 && len < (std::uint64_t) minlen) ||
+                            (no_ambiguous && s.sequence != "*" && !is_acgt(s.sequence))){
+                        drop[i] = 1;
+                    }
+                }
+                std::unordered_set<std::string> dropped;
+                for (std::size_t i = 0; i < seqs.size(); ++i){
+                    if (drop[i] == 2){
+                        std::cerr << "Length unset for sequence " << seqs[i]->name << "; removing from graph." << std::endl;
+                    }
+                    if (drop[i]){
+                        dropped.insert(seqs[i]->name);
+                    }
+                }
+                if (dropped.empty()){
+                    return false;
+                }
+                auto is_dropped = [&](const std::string& name){
+                    return dropped.find(name) != dropped.end();
+                };
+
+                // Compact
+                std::map<std::string, sequence_elem, custom_key> kept_seqs;
+                for (auto& s : name_to_seq){
+                    if (!is_dropped(s.first)){
+                        kept_seqs.emplace_hint(kept_seqs.end(), s.first, std::move(s.second));
+                    }
+                }
+                name_to_seq.swap(kept_seqs);
+
+                compact_by_key(seq_to_edges, is_dropped, [&](const edge_elem& e){
+                        return is_dropped(e.source_name) || is_dropped(e.sink_name);
+                        }, nthreads);
+                compact_by_key(seq_to_link, is_dropped, [&](const link_elem& l){
+                        return is_dropped(l.source_name) || is_dropped(l.sink_name);
+                        }, nthreads);
+                compact_by_key(seq_to_contained, is_dropped, [&](const contained_elem& c){
+                        return is_dropped(c.source_name) || is_dropped(c.sink_name);
+                        }, nthreads);
+                compact_by_key(seq_to_fragments, is_dropped, [](const fragment_elem&){
+                        return false;
+                        }, nthreads);
+                // Gap ends are references (with an orientation).
+                auto strip = [](const std::string& ref){
+                    return !ref.empty() && (ref.back() == '+' || ref.back() == '-') ? ref.substr(0, ref.length() - 1) : ref;
+                };
+                compact_by_key(seq_to_gaps, [&](const std::string& name){
+                        return is_dropped(strip(name));
+                        }, [&](const gap_elem& g){
+                        return is_dropped(strip(g.source_name)) || is_dropped(strip(g.sink_name));
+                        }, nthreads);
+
+                // Paths and ordered groups: keep or split the runs of kept steps.
+                std::map<std::string, stored_path> kept_paths;
+                std::unordered_set<std::string> removed_paths;
+                path_elem path;
+                for (auto& p : name_to_path){
+                    decode_path(p.second, path);
+                    std::vector<std::pair<std::size_t, std::size_t>> runs = kept_runs(path.segment_names, is_dropped);
+                    if (runs.size() == 1 && runs[0].first == 0 && runs[0].second == path.segment_names.size()){
+                        kept_paths.emplace_hint(kept_paths.end(), p.first, std::move(p.second));
+                        continue;
+                    }
+                    if (!split_paths){
+                        std::cerr << "Path " << p.first << " steps on a removed sequence; removing from graph." << std::endl;
+                        removed_paths.insert(p.first);
                         continue;
                     }
-                    // Remove any individual edges that have a dropped sequence as their sink.
-                    std::vector<edge_elem> pass_elems;
-                    for (auto ee : s_to_e->second){
-                        if (dropped_seqs.find(ee.source_name) == dropped_seqs.end()){
-                            graph_modified = true;
-                            pass_elems.push_back(ee);
+                    const std::vector<std::string>& ov = path.overlaps;
+                    std::uint64_t n = 1;
+                    for (std::size_t r = 0; r < runs.size(); ++r){
+                        path_elem piece;
+                        piece.name = p.first;
+                        // Pieces are numbered in order, skipping names other paths or groups already have.
+                        while (runs.size() > 1 && (piece.name == p.first || name_to_path.count(piece.name) || groups.count(piece.name) ||
+                                    kept_paths.count(piece.name))){
+                            piece.name = p.first + "_" + std::to_string(n++);
+                        }
+                        piece.opt_fields = path.opt_fields;
+                        std::size_t b = runs[r].first, e = runs[r].second;
+                        piece.segment_names.assign(path.segment_names.begin() + b, path.segment_names.begin() + e);
+                        piece.orientations.assign(path.orientations.begin() + b, path.orientations.begin() + e);
+                        // Overlaps are given between steps (or once, as "*").
+                        if (ov.size() == 1 && ov[0] == "*"){
+                            piece.overlaps = ov;
+                        }
+                        else if (ov.size() + 1 == path.segment_names.size()){
+                            piece.overlaps.assign(ov.begin() + b, ov.begin() + e - 1);
+                        }
+                        else if (ov.size() == path.segment_names.size()){
+                            piece.overlaps.assign(ov.begin() + b, ov.begin() + e);
                         }
+                        if (piece.overlaps.empty()){
+                            piece.overlaps.push_back("*");
+                        }
+                        encode_path(piece, kept_paths[piece.name]);
                     }
-                    seq_to_edges[s_to_e->first] = pass_elems;
                 }
 
+                std::map<std::string, group_elem> kept_groups;
+                for (auto& g : groups){
+                    if (!g.second.ordered){
+                        group_elem& u = g.second;
+                        u.items.erase(std::remove_if(u.items.begin(), u.items.end(), is_dropped), u.items.end());
+                        if (!u.items.empty()){
+                            kept_groups.emplace_hint(kept_groups.end(), g.first, std::move(u));
+                        }
+                        continue;
+                    }
+                    std::vector<std::pair<std::size_t, std::size_t>> runs = kept_runs(g.second.items, is_dropped);
+                    if (runs.size() == 1 && runs[0].first == 0 && runs[0].second == g.second.items.size()){
+                        kept_groups.emplace_hint(kept_groups.end(), g.first, std::move(g.second));
+                        continue;
+                    }
+                    if (!split_paths){
+                        // A path and its ordered group (as in GFA2 graphs) are reported once.
+                        if (!removed_paths.count(g.first)){
+                            std::cerr << "Group " << g.first << " steps on a removed sequence; removing from graph." << std::endl;
+                        }
+                        continue;
+                    }
+                    std::uint64_t n = 1;
+                    for (std::size_t r = 0; r < runs.size(); ++r){
+                        group_elem piece;
+                        piece.id = g.first;
+                        // As for paths, so a GFA2 path and its ordered group get the same pieces.
+                        while (runs.size() > 1 && (piece.id == g.first || name_to_path.count(piece.id) || groups.count(piece.id) ||
+                                    kept_groups.count(piece.id))){
+                            piece.id = g.first + "_" + std::to_string(n++);
+                        }
+                        piece.ordered = true;
+                        piece.tags = g.second.tags;
+                        piece.items.assign(g.second.items.begin() + runs[r].first, g.second.items.begin() + runs[r].second);
+                        piece.orientations.assign(g.second.orientations.begin() + runs[r].first, g.second.orientations.begin() + runs[r].second);
+                        kept_groups[piece.id] = piece;
+                    }
+                }
+                name_to_path.swap(kept_paths);
+                groups.swap(kept_groups);
 
-                return graph_modified;
+                return true;
             }
 
+            private:
+            /** The [begin, end) ranges of steps between dropped elements. **/
+            template<typename Pred>
+            inline std::vector<std::pair<std::size_t, std::size_t>> kept_runs(const std::vector<std::string>& steps, const Pred& is_dropped){
+                std::vector<std::pair<std::size_t, std::size_t>> runs;
+                std::size_t start = 0;
+                for (std::size_t i = 0; i <= steps.size(); ++i){
+                    if (i == steps.size() || is_dropped(steps[i])){
+                        if (i > start){
+                            runs.push_back(std::make_pair(start, i));
+                        }
+                        start = i + 1;
+                    }
+                }
+                return runs;
+            }
 
+            /**
+             *  Drop the entries of a map of vectors whose key matches drop_key,
+             *  and the elements of the others that match drop_elem (in parallel).
+             */
+            template<typename Map, typename KeyPred, typename ElemPred>
+            inline void compact_by_key(Map& m, const KeyPred& drop_key, const ElemPred& drop_elem, int threads){
+                typedef typename Map::mapped_type List;
+                Map kept;
+                for (auto& x : m){
+                    if (!drop_key(x.first)){
+                        kept.emplace_hint(kept.end(), x.first, std::move(x.second));
+                    }
+                }
+                m.swap(kept);
+                std::vector<List*> lists;
+                lists.reserve(m.size());
+                for (auto& x : m){
+                    lists.push_back(&x.second);
+                }
+                #pragma omp parallel for schedule(dynamic, 1024) num_threads(threads)
+                for (std::size_t i = 0; i < lists.size(); ++i){
+                    List& v = *lists[i];
+                    v.erase(std::remove_if(v.begin(), v.end(), drop_elem), v.end());
+                }
+            }
 
-
+            public:
 
             /** Parse a GFA file to a GFAKluge object. */
             inline bool parse_gfa_file(const std::string &filename) {
@@ -2478,7 +3223,7 @@ namespace gfak{
                     else if (tokens[0] == "U"){
                         group_elem g;
                         g.ordered = false;
-                        g.id = tokens[0];
+                        g.id = tokens[1];
                         if (g.id == "*"){
                             g.id = std::to_string(++base_group_id);
                         }
@@ -2629,7 +3374,7 @@ namespace gfak{
                                 }
                             }
 
-                            name_to_path[p.name] = p;
+                            add_path(p.name, p);
                         }
                         else if (this->version < 1.0){
                             std::string pname(tokens[2]);
@@ -2682,6 +3427,7 @@ namespace gfak{
                     }
 
                 }
+                store_walks();
                 gfa_1_ize();
                 gfa_2_ize();
 
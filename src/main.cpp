@@ -2,6 +2,13 @@
 #include <cstring>
 #include "gfakluge.hpp"
 #include "gfa_builder.hpp"
+#include "gfa_path_index.hpp"
+#include "gfa_stats.hpp"
+#include "gfa_topology.hpp"
+#include "gfa_diff.hpp"
+#include "gfa_validate.hpp"
+#include "gfa_ids.hpp"
+#include "gfa_subset.hpp"
 
 using namespace std;
 using namespace gfak;
@@ -24,12 +31,14 @@ int gfakluge_package_help(char** argv){
         "   diff:    Determine whether two GFA files have identical graphs" << endl <<
         "   extract: Convert the S lines of a GFA file to FASTA format." << endl <<
         "   fillseq: Add sequences from a FASTA file to S lines." << endl <<
+        "   hash:    Print a fingerprint of a graph that ignores line order and GFA version." << endl <<
         "   ids:     Coordinate the ID spaces of multiple GFA graphs."  << endl <<
         "   concat:  Merge GFA graphs (without ID collisions)." << endl <<
         "   sort:    Print a GFA file in HSLP / HSEFGUO order." << endl <<
         "   stats:   Get assembly statistics (e.g. N50) for a GFA file." << endl <<
         "   subset:  Extract the subgraph between two IDs in a graph." << endl <<
         "   trim:    Remove elements from a GFA graph." << endl <<
+        "   validate: Check a GFA file for dangling references and inconsistent lengths." << endl <<
         endl;
     return 1;
 
@@ -40,6 +49,8 @@ void trim_help(char** argv){
         << "Usage: " << argv[0] << " trim [OPTIONS] <GFA_FILE> " << endl
             << " -l / --length  <INT>  Remove segments (and their edges) if their sequence length is less than <INT>." << endl
             << " -n / --no-ambiguous   Remove segments which have ambiguous bases (i.e. non-ATGC) in their sequence." << endl
+            << " -p / --trim-paths     Split paths at removed segments rather than removing them (pieces are named <path>_1, <path>_2, ...)." << endl
+            << " -t / --threads <INT>  Number of threads to use for finding segments to remove (default: 1)." << endl
             << " -v / --version        print GFAK version and exit." << endl
         << endl;
 }
@@ -49,6 +60,9 @@ void extract_help(char** argv){
     cerr << argv[0] <<  " extract: extract a FASTA file from GFA" << endl
         << "Usage: " << argv[0] << " extract [ -p ] <GFA_FILE> > file.fa " << endl
             << " -p / --include-paths  include paths in output" << endl
+            << " -P / --path <NAME>    output only the sequence of path <NAME>. May be passed multiple times." << endl
+            << " -t / --threads <INT>  number of threads to use for building path sequences (default: 1)." << endl
+            << " -U / --uppercase      convert soft-masked (lowercase) bases to uppercase." << endl
             << " -v / --version        print GFAK version and exit." << endl
         << endl;
 }
@@ -59,13 +73,46 @@ void fillseq_help(char** argv){
         << "Options:" << endl
         << " -f / --fasta <f.fa>   {REQUIRED} a FASTA file containing sequences, with the GFA IDs as FASTA IDs." << endl
         << "                      Multiple FASTA files may be passed." << endl
+        << " -t / --threads <INT> Number of threads to use for copying sequences (default: 1)." << endl
+        << " -s / --stream        Stream the GFA file line by line rather than loading it, writing every line" << endl
+        << "                      other than the filled S lines unchanged (cannot be used with -S or -b)." << endl
         << " -S / --spec <SPEC>   Output in GFA version <SPEC>" << endl
         << endl;
 }
 
 void diff_help(char** argv){
-    cerr << argv[0] << " diff: determine whether two GFA files are the same." << endl
+    cerr << argv[0] << " diff: determine whether two GFA files contain the same graph." << endl
       << "Usage: " << argv[0] << " diff [options] <GFA_File_1> <GFA_File_2>" << endl
+      << "Prints each element removed from (<), added to (>) or changed (!) in the second graph," << endl
+      << "then a summary on stderr. Exits with 1 if the graphs differ." << endl
+      << "Segments, edges (on either strand), paths and groups are compared regardless of line order or GFA version." << endl
+            << " -q / --quiet          print only the summary." << endl
+            << " -t / --threads <INT>  number of threads to use (default: 1)." << endl
+            << " -v / --version        print GFAK version and exit." << endl
+            << endl;
+}
+
+void hash_help(char** argv){
+    cerr << argv[0] << " hash: print a fingerprint of the graph in each GFA file." << endl
+      << "Usage: " << argv[0] << " hash [options] <GFA_File> [<GFA_File> ...] (or - to read from stdin)" << endl
+      << "The fingerprint covers segments, edges, paths and groups but not their order, tags or the GFA version," << endl
+      << "so two files holding the same graph have the same fingerprint." << endl
+            << " -c / --counts         also print the number of elements of each kind." << endl
+            << " -m / --in-memory      load each graph before hashing it rather than streaming it." << endl
+            << " -t / --threads <INT>  number of threads to use (default: 1)." << endl
+            << " -v / --version        print GFAK version and exit." << endl
+            << endl;
+}
+
+void validate_help(char** argv){
+    cerr << argv[0] << " validate: check a GFA file for structural errors." << endl
+      << "Usage: " << argv[0] << " validate [options] <GFA_File>" << endl
+      << "Reports dangling edges, path steps and group references, segment lengths that disagree with" << endl
+      << "their sequence or LN tag, duplicate segment names, edge coordinates past the end of a segment" << endl
+      << "and overlaps longer than their segments, one per line as <line> <record> <error> <detail>" << endl
+      << "(tab-separated). Exits with 1 if any are found." << endl
+            << " -q / --quiet          print only the number of errors." << endl
+            << " -t / --threads <INT>  number of threads to use (default: 1)." << endl
             << " -v / --version        print GFAK version and exit." << endl
             << endl;
 }
@@ -75,6 +122,11 @@ void ids_help(char** argv){
     << "Usage: " << argv[0] << " ids <GFA_FILE_1> .... <GFA_FILE_N>" << endl
     << "options: " << endl
     << "   -s / --start-ids   Start the relabeling process from <n_id:e_id:p_id>" << endl
+    << "   -c / --compact-names  Give segments with non-numeric names integer IDs too (by default they keep their names)." << endl
+    << "   -t / --threads <N>    Rewrite edges, gaps, groups and paths on N threads (or, with -z, N files at a time)." << endl
+    << "   -z / --stream         Offset the IDs of each file by the largest IDs of the files before it, streaming the files" << endl
+    << "                         rather than loading them. The files are scanned for their largest IDs and then rewritten in parallel." << endl
+    << "   -o / --out-dir <DIR>  Write each graph to DIR/<file name> rather than concatenating them to stdout." << endl
     << "   -S / --spec <SPEC>    Output GFA specification version <X>." << endl
     << "   -b / --block-order Output block-order (HSLCP) GFA." << endl
     << "   -v / --version        print GFAK version and exit." << endl
@@ -102,17 +154,27 @@ void merge_help(char** argv){
         << "  -S / --spec <SPEC> [one of 0.1, 1.0, 2.0]   Convert the input GFA file to specification [0.1, 1.0, or 2.0]." << endl
         << "                                NB: not all GFA specs are backward/forward compatible, so a subset of the GFA may be used." << endl
         << "  -b / --block-order   Output GFA in block order [HSLP / HSLW | HSEFGUO]." << endl
+        << "  -s / --stream        Stream the files into the output one record at a time rather than loading them," << endl
+        << "                       offsetting the IDs of each file by the largest IDs of the files before it." << endl
+        << "  -t / --threads <N>   Scan each file for its largest IDs on N threads (with -s)." << endl
         << "  -v / --version        print GFAK version and exit." << endl
         << endl; 
 }
 
 void build_help(char** argv){
     cerr << argv[0] << " build: generate a GFA variation graph from a FASTA reference and a VCF." << endl
-    << "Usage: " << argv[0] << " build [options] -r <FASTA> -v <VCF>" << endl
+    << "Usage: " << argv[0] << " build [options] -f <FASTA> -v <VCF>" << endl
     << "Options: " << endl
     << "  -m / --max-node-length <Int>  Maximum size for a node in basepairs (default: 1000)." << endl
     << "  -f / --fasta  <FASTA>     A fasta file to use for constructing the graph backbone." << endl
-    << "  -v / --vcf <VCF>              A VCF file containing variants to put in the graph." << endl 
+    << "  -v / --vcf <VCF>              A VCF file (plain, gzip or bgzip) containing variants to put in the graph." << endl 
+    << "  -t / --threads <INT>          Number of contigs to construct in parallel (default: 1)." << endl
+    << "  -w / --window <INT>           Read the FASTA this many bases at a time (default: 1048576)." << endl
+    << "  -p / --paths                  Add a path (sample#haplotype#contig) for each haplotype of each sample with phased genotypes." << endl
+    << "  -i / --insertions <FASTA>     A FASTA file holding the sequences of symbolic insertions (the record ID for an <ID> allele)." << endl
+    << "  -r / --region <chr:start-end> Only build the graph of this region (1-based, inclusive)." << endl
+    << "                                A bgzipped VCF is read through its .tbi or .csi index; an uncompressed" << endl
+    << "                                one through a <VCF>.gvi index, which is created if it doesn't exist." << endl
     << endl;
 }
 
@@ -127,14 +189,21 @@ void sort_help(char** argv){
 
 void stats_help(char** argv){
     cerr << argv[0] << " stats: print assembly / graph stats for a GFA file." << endl
-        << "Usage: " << argv[0] << " stats [options] <GFA_File>" << endl
+        << "Usage: " << argv[0] << " stats [options] <GFA_File> (or - to read from stdin)" << endl
         << "Options:" << endl
-        << "   -a / --assembly  print assembly statistics (N50, N90, L50, L90)." << endl
+        << "   -a / --assembly  print assembly statistics (N50, N90, L50, L90 and auN)." << endl
+        << "   -N / --nx <X,Y,...> print the Nx and Lx for each comma-separated percentage instead of N50 / N90." << endl
+        << "   -g / --genome-size <INT> also print NGx, LGx and auNG relative to a genome of <INT> bp." << endl
         << "   -A / --all       print all graph statistics." << endl
         << "   -l / --length    print the total sequence length (in S lines)." << endl
         << "   -n / --num-nodes print the number of nodes." << endl
         << "   -e / --num-edges print the number of edges." << endl
-        << "   -p / --paths     print some path statistics." << endl
+        << "   -p / --paths     print the step count and length of each path." << endl
+        << "   -T / --topology  print degree distributions, tips, dead ends, self-loops and multi-edges." << endl
+        << "   -j / --json      print the -p / -T report as JSON rather than TSV." << endl
+        << "   -c / --composition print the base composition (GC, N, ambiguous and soft-masked bases)." << endl
+        << "   -H / --histogram print a histogram of node lengths in power-of-two bins." << endl
+        << "   -t / --threads <INT> read the file in <INT> chunks in parallel (default: 1)." << endl
         << "   -v / --version        print GFAK version and exit." << endl
         << endl;
 }
@@ -142,9 +211,15 @@ void stats_help(char** argv){
 void subset_help(char** argv){
     cerr << argv[0] << " subset: extract a subset of a GFA graph between two node ids." << endl
     << "Usage: " << argv[0] << " subset [options] <gfa_file>" << endl
+    << "Segments in the ID range (or node list) are kept with the links between them, and" << endl
+    << "paths are cut into the runs of kept steps, without loading the graph." << endl
     << "Options:" << endl
     << "  -s / --start-id  <n_id> Start ID of subgraph." << endl
     << "  -e / --end-id    <n_id> End ID of subgraph." << endl
+    << "  -n / --node-list <FILE> Keep the segments named in FILE (one per line) instead of an ID range." << endl
+    << "  -r / --region <path:start-end> Extract the subgraph spanning a (1-based, inclusive) interval of a path." << endl
+    << "  -f / --fasta          With -r, print the sequence of the interval as FASTA rather than the subgraph." << endl
+    << "  -t / --threads <INT>  Number of threads to use for indexing paths (default: 1)." << endl
     << "  -b / --block-order Output GFA in block order." << endl
     << "  -S / --spec <SPEC>   GFA specification version for output." << endl
     << "  -v / --version        print GFAK version and exit." << endl
@@ -160,6 +235,7 @@ int trim_main(int argc, char** argv){
     int minlen = 0;
     bool no_amb = false;
     bool trim_paths = false;
+    int threads = 1;
 
     if (argc < 3){
         cerr << "No GFA file given as input." << endl << endl;
@@ -174,13 +250,14 @@ int trim_main(int argc, char** argv){
             {"help", no_argument, 0, 'h'},
             {"trim-paths", no_argument, 0, 'p'},
             {"length", required_argument, 0, 'l'},
-            {"no-ambiguous", no_argument, 0, 'N'},
+            {"no-ambiguous", no_argument, 0, 'n'},
+            {"threads", required_argument, 0, 't'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hvnpl:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hvnpl:t:", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -201,8 +278,10 @@ int trim_main(int argc, char** argv){
                 break;
             case 'p':
                 trim_paths = true;
-                cerr << "Path trimming is not yet implemented" << endl;
-                exit(1);
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
             default:
                 abort();
         }
@@ -216,7 +295,7 @@ int trim_main(int argc, char** argv){
     
     GFAKluge gg;
     gg.parse_gfa_file(gfa_file);
-    gg.trim_seqs(minlen, no_amb);
+    gg.trim_seqs(minlen, no_amb, trim_paths, threads);
     cout << gg;
 
     return 0;
@@ -228,6 +307,9 @@ int trim_main(int argc, char** argv){
 int extract_main(int argc, char** argv){
     string gfa_file = "";
     bool include_paths = false;
+    vector<string> path_names;
+    int threads = 1;
+    bool uppercase = false;
 
     if (argc < 3){
         cerr << "No GFA file given as input." << endl << endl; 
@@ -242,12 +324,15 @@ int extract_main(int argc, char** argv){
         {
             {"help", no_argument, 0, 'h'},
             {"include-paths", no_argument, 0, 'p'},
+            {"path", required_argument, 0, 'P'},
+            {"threads", required_argument, 0, 't'},
+            {"uppercase", no_argument, 0, 'U'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hpv", long_options, &option_index);
+        c = getopt_long(argc, argv, "hpP:t:Uv", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -263,38 +348,93 @@ int extract_main(int argc, char** argv){
             case 'p':
                 include_paths= true;
                 break;
+            case 'P':
+                path_names.push_back(string(optarg));
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'U':
+                uppercase = true;
+                break;
             default:
                 abort();
         }
     }
+    if (optind >= argc){
+        cerr << "No GFA file given as input." << endl << endl;
+        extract_help(argv);
+        exit(1);
+    }
     gfa_file = argv[optind];
 
     GFAKluge gg;
     gg.parse_gfa_file(gfa_file);
+    if (uppercase){
+        gg.sequences_to_upper();
+    }
 
-    map<string, sequence_elem, custom_key> seqs = gg.get_name_to_seq();
-
-    for (auto name_seq : seqs){
-        cout << ">" << name_seq.second.name << endl
-            << name_seq.second.sequence << endl;
+    if (path_names.empty()){
+        gg.for_each_sequence([&](const sequence_elem& s){
+                cout << ">" << s.name << endl
+                    << s.sequence << endl;
+                });
     }
     // Do the same for groups/walks/paths, as the concated
     // sequences of the oriented seq_elems create a path (e.g. a chromosome or contig)
-    if (include_paths){
-        for (auto p : gg.get_groups()){
-            stringstream pstr;
-            if (p.second.ordered){
-                
-                pstr << ">" << p.second.id << endl;
-                for (int i = 0; i < p.second.items.size(); i++){
-                    string seqname = p.second.items[i];
-                    bool ori = p.second.orientations[i];
-                    pstr << ( ori ? seqs[seqname].sequence : string((seqs[seqname]).sequence.rbegin(), (seqs[seqname]).sequence.rend()));
+    if (include_paths || !path_names.empty()){
+        // GFA2 ordered groups are spelled like paths.
+        vector<path_elem> group_paths;
+        gg.for_each_group([&](const group_elem& g){
+                if (g.ordered && !gg.has_path(g.id)){
+                    path_elem p;
+                    p.name = g.id;
+                    p.segment_names = g.items;
+                    p.orientations = g.orientations;
+                    group_paths.push_back(p);
+                }
+                });
+        // Paths are decoded as they are read, so only the ones asked for are.
+        vector<path_elem> stored_paths;
+        if (path_names.empty()){
+            gg.for_each_path([&](const path_elem& p){
+                    stored_paths.push_back(p);
+                    });
+        }
+        else{
+            for (auto& n : path_names){
+                path_elem p;
+                if (gg.get_path(n, p)){
+                    stored_paths.push_back(p);
+                }
+            }
+        }
+        map<string, const path_elem*> by_name;
+        for (auto& p : stored_paths){
+            by_name[p.name] = &p;
+        }
+        for (auto& p : group_paths){
+            by_name[p.name] = &p;
+        }
+
+        vector<const path_elem*> paths;
+        if (path_names.empty()){
+            for (auto& p : by_name){
+                paths.push_back(p.second);
+            }
+        }
+        else{
+            for (auto& n : path_names){
+                auto p = by_name.find(n);
+                if (p == by_name.end()){
+                    cerr << "Error: no path named " << n << " in " << gfa_file << "." << endl;
+                    exit(1);
                 }
-                pstr << endl;
-                cout << pstr.str() << endl;
-                pstr.str("");
-            } 
+                paths.push_back(p->second);
+            }
+        }
+        if (gg.write_path_fasta(cout, paths, threads) != paths.size()){
+            exit(1);
         }
     }
     
@@ -312,6 +452,10 @@ int build_main(int argc, char** argv){
     std::string vcf_file;
     char* insertion_fasta = NULL;
     int max_node_size = 128;
+    int threads = 1;
+    std::string region;
+    std::uint64_t window_size = 1 << 20;
+    bool haplotype_paths = false;
 
     double spec_version = 2.0;
     int c;
@@ -324,11 +468,16 @@ int build_main(int argc, char** argv){
             {"spec", required_argument, 0, 'S'},
             {"vcf", required_argument, 0, 'v'},
             {"max-node-size", required_argument, 0, 'm'},
+            {"threads", required_argument, 0, 't'},
+            {"region", required_argument, 0, 'r'},
+            {"window", required_argument, 0, 'w'},
+            {"paths", no_argument, 0, 'p'},
+            {"insertions", required_argument, 0, 'i'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hm:i:f:S:v:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hm:i:f:S:v:t:r:w:p", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -353,6 +502,18 @@ int build_main(int argc, char** argv){
             case 'm':
                 max_node_size = atoi(optarg);
                 break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'r':
+                region = string(optarg);
+                break;
+            case 'w':
+                window_size = std::stoull(optarg);
+                break;
+            case 'p':
+                haplotype_paths = true;
+                break;
             default:
                 abort();
         }
@@ -360,7 +521,14 @@ int build_main(int argc, char** argv){
     gfak::GFAKluge gg;
     gg.set_version(spec_version);
 
-    construct_gfa( (char*) fasta_file.c_str(), (char*) vcf_file.c_str(), (char*) insertion_fasta, gg, max_node_size);
+    if (!region.empty()){
+        if (haplotype_paths){
+            cerr << "Warning: haplotype paths are not built with -r; only the reference path is written." << endl;
+        }
+        construct_region_gfa( (char*) fasta_file.c_str(), (char*) vcf_file.c_str(), (char*) insertion_fasta, gg, region, max_node_size, window_size);
+        return 0;
+    }
+    construct_gfa( (char*) fasta_file.c_str(), (char*) vcf_file.c_str(), (char*) insertion_fasta, gg, max_node_size, threads, window_size, haplotype_paths);
 
     return 0;
 }
@@ -378,6 +546,8 @@ int fillseq_main(int argc, char** argv){
 
     double spec_version = 0.0;
     bool block_order = false;
+    int threads = 1;
+    bool stream = false;
 
     int c;
     optind = 2;
@@ -388,12 +558,14 @@ int fillseq_main(int argc, char** argv){
             {"fasta", required_argument, 0, 'f'},
             {"spec", required_argument, 0, 'S'},
             {"block-order", no_argument, 0, 'b'},
+            {"threads", required_argument, 0, 't'},
+            {"stream", no_argument, 0, 's'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hbf:S:v", long_options, &option_index);
+        c = getopt_long(argc, argv, "hbsf:S:t:v", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -401,7 +573,7 @@ int fillseq_main(int argc, char** argv){
         switch (c){
             case '?':
             case 'h':
-                extract_help(argv);
+                fillseq_help(argv);
                 exit(0);
             case 'b':
                 block_order = true;
@@ -415,6 +587,12 @@ int fillseq_main(int argc, char** argv){
             case 'f':
                 fasta_file = string(optarg);
                 break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 's':
+                stream = true;
+                break;
             default:
                 abort();
         }
@@ -430,9 +608,27 @@ int fillseq_main(int argc, char** argv){
         cerr << "Error: no FASTA file provided." << endl;
         exit(1);
     }
+
+    if (stream){
+        if (spec_version != 0.0 || block_order){
+            cerr << "Error: -S and -b cannot be used with -s." << endl;
+            exit(1);
+        }
+        const mapped_fasta* fa = open_fasta(fasta_file);
+        if (fa == nullptr){
+            cerr << "Error: could not open FASTA file " << fasta_file << "." << endl;
+            exit(1);
+        }
+        if (stream_fill_sequences(gfa_file, *fa, cout) < 0){
+            cerr << "Error: could not read GFA file " << gfa_file << "." << endl;
+            exit(1);
+        }
+        return 0;
+    }
+
     GFAKluge gg;
     gg.parse_gfa_file(gfa_file);
-    gg.fill_sequences(fasta_file.c_str());
+    gg.fill_sequences(fasta_file.c_str(), threads);
 
 
     if (spec_version == 0.1){
@@ -466,8 +662,8 @@ return 0;
 }
 
 /**
- * Return whether two GFA files are identical
- * in "structure" (number of links, segments, etC)
+ * Compare two GFA files element by element, using
+ * hashes of their segments, edges, paths and groups.
  */
 int diff_main(int argc, char** argv){
     if (argc < 4){
@@ -476,18 +672,23 @@ int diff_main(int argc, char** argv){
         exit(1);
     }
 
+    bool quiet = false;
+    int threads = 1;
+
     int c;
     optind = 2;
     while (true){
         static struct option long_options[] =
         {
             {"help", no_argument, 0, 'h'},
+            {"quiet", no_argument, 0, 'q'},
+            {"threads", required_argument, 0, 't'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hv", long_options, &option_index);
+        c = getopt_long(argc, argv, "hqt:v", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -497,6 +698,12 @@ int diff_main(int argc, char** argv){
             case 'h':
                 diff_help(argv);
                 exit(0);
+            case 'q':
+                quiet = true;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
             case 'v':
                 print_version_help();
                 exit(0);
@@ -505,40 +712,237 @@ int diff_main(int argc, char** argv){
         }
     }
 
-    GFAKluge ff;
-    GFAKluge gg;
-    ff.parse_gfa_file(argv[optind]);
-    optind++;
-    gg.parse_gfa_file(argv[optind]);
-    optind++;
-    map<std::string, sequence_elem, custom_key> seq_1 = ff.get_name_to_seq();
-    map<std::string, sequence_elem, custom_key> seq_2 = gg.get_name_to_seq();
-    map<std::string, vector<edge_elem>> e_1 = ff.get_seq_to_edges();
-    map<std::string, vector<edge_elem>> e_2 = ff.get_seq_to_edges();
-    if (seq_1.size() != seq_2.size()){
-        cerr << "Graphs have different numbers of sequences." << endl;
-        return -1;
-    }
-    else if (e_1.size() != e_2.size()){
-        cerr << "Graphs have different numbers of edges" << endl;
-        return -1;
+    if (argc - optind < 2){
+        cerr << "diff requires two GFA files as input." << endl << endl;
+        diff_help(argv);
+        exit(1);
+    }
+    string first = argv[optind];
+    string second = argv[optind + 1];
+    if (!quiet && (!is_mappable_file(first) || !is_mappable_file(second))){
+        cerr << "diff reads its inputs twice; use -q to compare a graph on stdin or a pipe." << endl;
+        exit(1);
     }
-    else{
-        // Check if all node IDs are the same.
 
-        // Check if the edges of every node ID are the same in both graphs.
+    vector<element_hash> e_1;
+    vector<element_hash> e_2;
+    if (!hash_file_elements(first, e_1, threads)){
+        cerr << "Couldn't open GFA file " << first << "." << endl;
+        exit(1);
+    }
+    if (!hash_file_elements(second, e_2, threads)){
+        cerr << "Couldn't open GFA file " << second << "." << endl;
+        exit(1);
+    }
+    graph_diff d = diff_elements(e_1, e_2, threads);
+    vector<element_hash>().swap(e_1);
+    vector<element_hash>().swap(e_2);
 
-        // Check that the graphs both have identical paths.
+    if (!quiet && !d.identical()){
+        // Changed elements are listed once, as they appear in the first graph.
+        write_diff_elements(cout, first, threads, {&d.removed_keys, &d.changed_keys}, {'<', '!'});
+        write_diff_elements(cout, second, threads, {&d.added_keys}, {'>'});
+    }
 
-        // Check fragments and other GFA2 specific items.
+    for (size_t i = 0; i < d.added.size(); ++i){
+        if (d.added[i] + d.removed[i] + d.changed[i] > 0){
+            cerr << element_kind_name(i) << ": " << d.removed[i] << " removed, "
+                << d.added[i] << " added, " << d.changed[i] << " changed." << endl;
+        }
+    }
+    if (!d.identical()){
+        cerr << "The graphs differ." << endl;
+        return 1;
+    }
+    cerr << "The graphs are identical." << endl;
+    return 0;
+}
 
+/**
+ * Print an order- and version-independent fingerprint
+ * of each graph given on the command line.
+ */
+int hash_main(int argc, char** argv){
+    if (argc < 3){
+        hash_help(argv);
+        exit(1);
     }
-    // Everything matches up, return 0
-    cerr << "The graphs appear to be identical." << endl;
+
+    bool counts = false;
+    bool in_memory = false;
+    int threads = 1;
+
+    int c;
+    optind = 2;
+    while (true){
+        static struct option long_options[] =
+        {
+            {"help", no_argument, 0, 'h'},
+            {"counts", no_argument, 0, 'c'},
+            {"in-memory", no_argument, 0, 'm'},
+            {"threads", required_argument, 0, 't'},
+            {"version", no_argument, 0, 'v'},
+            {0,0,0,0}
+        };
     
+        int option_index = 0;
+        c = getopt_long(argc, argv, "hcmt:v", long_options, &option_index);
+        if (c == -1){
+            break;
+        }
+
+        switch (c){
+            case '?':
+            case 'h':
+                hash_help(argv);
+                exit(0);
+            case 'c':
+                counts = true;
+                break;
+            case 'm':
+                in_memory = true;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'v':
+                print_version_help();
+                exit(0);
+            default:
+                abort();
+        }
+    }
+
+    if (optind >= argc){
+        cerr << "No GFA file provided." << endl;
+        hash_help(argv);
+        exit(1);
+    }
+
+    for (int i = optind; i < argc; ++i){
+        string gfa_file = argv[i];
+        graph_fingerprint fp;
+        bool streamed = false;
+        if (!in_memory){
+            int nthreads = threads > 1 ? threads : 1;
+            vector<graph_fingerprint> partial(nthreads);
+            int n = for_each_line_in_file(gfa_file, nthreads, [&](const char* line, size_t len, int chunk){
+                    element_hash e;
+                    if (hash_record(line, len, e)){
+                        partial[chunk].add(e);
+                    }
+                    });
+            if (n == 0){
+                cerr << "Couldn't open GFA file " << gfa_file << "." << endl;
+                exit(1);
+            }
+            for (auto& p : partial){
+                fp += p;
+            }
+            // GFA 0.1 paths are spread over one line per step, so they
+            // can only be hashed as paths once the graph is loaded.
+            streamed = fp.counts[element_kind_index('w')] == 0 || gfa_file == "-";
+        }
+        if (!streamed){
+            GFAKluge gg;
+            if (!gg.parse_gfa_file(gfa_file)){
+                cerr << "Couldn't open GFA file " << gfa_file << "." << endl;
+                exit(1);
+            }
+            fp = gg.fingerprint(threads);
+        }
+        cout << fp.hex() << "  " << gfa_file << endl;
+        if (counts){
+            for (size_t k = 0; k < fp.counts.size(); ++k){
+                if (fp.counts[k] > 0){
+                    cout << "\t" << element_kind_name(k) << ": " << fp.counts[k] << endl;
+                }
+            }
+        }
+    }
     return 0;
 }
 
+/**
+ * Check the structure of a GFA file,
+ * reporting errors as tab-separated lines.
+ */
+int validate_main(int argc, char** argv){
+    if (argc < 3){
+        validate_help(argv);
+        exit(1);
+    }
+
+    bool quiet = false;
+    int threads = 1;
+
+    int c;
+    optind = 2;
+    while (true){
+        static struct option long_options[] =
+        {
+            {"help", no_argument, 0, 'h'},
+            {"quiet", no_argument, 0, 'q'},
+            {"threads", required_argument, 0, 't'},
+            {"version", no_argument, 0, 'v'},
+            {0,0,0,0}
+        };
+    
+        int option_index = 0;
+        c = getopt_long(argc, argv, "hqt:v", long_options, &option_index);
+        if (c == -1){
+            break;
+        }
+
+        switch (c){
+            case '?':
+            case 'h':
+                validate_help(argv);
+                exit(0);
+            case 'q':
+                quiet = true;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'v':
+                print_version_help();
+                exit(0);
+            default:
+                abort();
+        }
+    }
+
+    if (optind >= argc){
+        cerr << "No GFA file provided." << endl;
+        validate_help(argv);
+        exit(1);
+    }
+    string gfa_file = argv[optind];
+    if (!is_mappable_file(gfa_file)){
+        cerr << "validate reads its input twice and can't read from stdin or a pipe." << endl;
+        exit(1);
+    }
+
+    vector<validation_error> errors;
+    if (!validate_gfa_file(gfa_file, errors, threads)){
+        cerr << "Couldn't open GFA file " << gfa_file << "." << endl;
+        exit(1);
+    }
+    if (!quiet){
+        for (auto& e : errors){
+            cout << e.to_string() << "\n";
+        }
+        cout << flush;
+    }
+    if (errors.empty()){
+        cerr << gfa_file << ": no errors found." << endl;
+        return 0;
+    }
+    cerr << gfa_file << ": " << errors.size() << " error" << (errors.size() > 1 ? "s" : "") << " found." << endl;
+    return 1;
+}
+
 /**
  *  Convert a GFA file to another GFA version,
  *  FASTA, or Cytoscape
@@ -651,6 +1055,10 @@ int ids_main(int argc, char** argv){
     vector<string> g_files;
     bool block_order = false;
     string start_string = "0:0:0:0:0";
+    bool compact_names = false;
+    bool stream = false;
+    string out_dir;
+    int threads = 1;
     double spec = 0.0;
 
     if (argc == 1){
@@ -667,12 +1075,16 @@ int ids_main(int argc, char** argv){
             {"start-ids", required_argument, 0, 's'},
             {"spec", required_argument, 0, 'S'},
             {"blocker-order", no_argument, 0, 'b'},
+            {"compact-names", no_argument, 0, 'c'},
+            {"threads", required_argument, 0, 't'},
+            {"stream", no_argument, 0, 'z'},
+            {"out-dir", required_argument, 0, 'o'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
 
         int option_index = 0;
-        c = getopt_long(argc, argv, "hvbS:s:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hvbczS:s:t:o:", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -694,6 +1106,18 @@ int ids_main(int argc, char** argv){
             case 'b':
                 block_order = true;
                 break;
+            case 'c':
+                compact_names = true;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'z':
+                stream = true;
+                break;
+            case 'o':
+                out_dir = optarg;
+                break;
             case 'S':
                 spec = stod(optarg);
                 break;
@@ -708,16 +1132,58 @@ int ids_main(int argc, char** argv){
         optind++;
     }
 
+    // Each graph goes to <out_dir>/<its file name>.
+    vector<string> outputs;
+    if (!out_dir.empty()){
+        set<string> names;
+        for (auto& f : g_files){
+            string name = f.substr(f.find_last_of('/') + 1);
+            if (!names.insert(name).second){
+                cerr << "Error: more than one input is named " << name << "; they can't share an output directory." << endl;
+                exit(1);
+            }
+            outputs.push_back(out_dir + "/" + name);
+        }
+    }
+
+    if (stream){
+        if (spec != 0 || block_order || compact_names){
+            cerr << "Error: -S, -b and -c cannot be used with -z." << endl;
+            exit(1);
+        }
+        vector<string> starts = pliib::split(start_string, ':');
+        id_offsets start;
+        start.segment = starts.size() > 0 ? stoull(starts[0]) : 0;
+        start.edge = starts.size() > 1 ? stoull(starts[1]) : 0;
+        start.gap = starts.size() > 3 ? stoull(starts[3]) : 0;
+        vector<gfa_id_maxima> maxima;
+        if (!scan_id_maxima(g_files, maxima, threads)){
+            exit(1);
+        }
+        for (size_t i = 0; i < g_files.size(); ++i){
+            if (maxima[i].non_numeric_segments > 0){
+                cerr << "Warning: " << maxima[i].non_numeric_segments << " segments of " << g_files[i] <<
+                    " have non-numeric names, which are not offset." << endl;
+            }
+        }
+        if (!write_offset_files(g_files, prefix_id_offsets(maxima, start), outputs, cout, threads)){
+            exit(1);
+        }
+        cerr << "Done." << endl;
+        return 0;
+    }
+
     int processed = 0;
     
-    for (auto gfi : g_files){
+    for (size_t i = 0; i < g_files.size(); ++i){
+        const string& gfi = g_files[i];
         // get previous ID
         // if it is greater than the minimum ID in this gg,
         // increment all IDs in gg by the prev_id.
         // output this updated gg
         GFAKluge gg;
         gg.parse_gfa_file(gfi);
-        gg.re_id(start_string);
+        gg.re_id(start_string, threads, compact_names);
         tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> max_ids = gg.max_ids();
         stringstream xl;
         xl << std::get<0>(max_ids) << ":" << std::get<1>(max_ids) << ":" <<
@@ -727,7 +1193,17 @@ int ids_main(int argc, char** argv){
         if (spec != 0){
             gg.set_version(spec);
         }
-        cout << (block_order ? gg.block_order_string() : gg.to_string());
+        if (outputs.empty()){
+            cout << (block_order ? gg.block_order_string() : gg.to_string());
+        }
+        else{
+            ofstream ofi(outputs[i].c_str());
+            if (!ofi.good()){
+                cerr << "Error: could not write " << outputs[i] << "." << endl;
+                exit(1);
+            }
+            ofi << (block_order ? gg.block_order_string() : gg.to_string());
+        }
         ++processed;
         cerr << "Processed " << processed << " graphs..." << endl;
     }
@@ -739,6 +1215,8 @@ int ids_main(int argc, char** argv){
 
 int merge_main(int argc, char** argv){
     bool block_order = false;
+    bool stream = false;
+    int threads = 1;
     double spec = 0.0;
     vector<string> g_files;
 
@@ -754,12 +1232,15 @@ int merge_main(int argc, char** argv){
         {
             {"help", no_argument, 0, 'h'},
             {"spec", required_argument, 0, 'S'},
+            {"block-order", no_argument, 0, 'b'},
+            {"stream", no_argument, 0, 's'},
+            {"threads", required_argument, 0, 't'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hvS:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hvbsS:t:", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -781,6 +1262,12 @@ int merge_main(int argc, char** argv){
             case 'b':
                 block_order = true;
                 break;
+            case 's':
+                stream = true;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
 
             default:
                 abort();
@@ -794,6 +1281,17 @@ int merge_main(int argc, char** argv){
 
     cerr << "Merging " << g_files.size() << " graphs..." << endl;
 
+    if (stream){
+        if (spec != 0 || block_order){
+            cerr << "Error: -S and -b cannot be used with -s." << endl;
+            exit(1);
+        }
+        if (!stream_merge(g_files, cout, threads)){
+            exit(1);
+        }
+        return 0;
+    }
+
     // This does the same thing as IDs,
     // Just uses more memory...
     GFAKluge base;
@@ -889,6 +1387,17 @@ int sort_main(int argc, char** argv){
     return 0;
 }
 
+/** Print a base composition, as stats -c does. **/
+void print_composition(const base_composition& comp){
+    cout << "Total bases: " << comp.length << endl;
+    cout << "GC bases: " << comp.gc << endl;
+    cout << "AT bases: " << comp.at << endl;
+    cout << "N bases: " << comp.n << endl;
+    cout << "Other ambiguous bases: " << comp.other() << endl;
+    cout << "Soft-masked bases: " << comp.lowercase << endl;
+    cout << "GC content: " << (comp.gc + comp.at > 0 ? (double) comp.gc / (comp.gc + comp.at) : 0.0) << endl;
+}
+
 int stats_main(int argc, char** argv){
     string gfa_file = "";
     bool show_nodes = false;
@@ -896,7 +1405,14 @@ int stats_main(int argc, char** argv){
     bool show_length = false;
     bool assembly_stats = false;
     bool show_paths = false;
+    bool show_composition = false;
+    bool show_histogram = false;
+    bool show_topology = false;
+    bool json = false;
     bool all = true;
+    int threads = 1;
+    vector<double> nx_values;
+    uint64_t genome_size = 0;
 
     if (argc <= 2){
         stats_help(argv);
@@ -915,13 +1431,20 @@ int stats_main(int argc, char** argv){
             {"all", no_argument, 0, 'A'},
             {"paths", no_argument, 0, 'p'},
             {"assembly", no_argument, 0, 'a'},
+            {"composition", no_argument, 0, 'c'},
+            {"histogram", no_argument, 0, 'H'},
+            {"threads", required_argument, 0, 't'},
+            {"nx", required_argument, 0, 'N'},
+            {"genome-size", required_argument, 0, 'g'},
+            {"topology", no_argument, 0, 'T'},
+            {"json", no_argument, 0, 'j'},
             {"version", no_argument, 0, 'v'},
 
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "hpaAnel", long_options, &option_index);
+        c = getopt_long(argc, argv, "hpaAnelcHt:N:g:Tjv", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -959,6 +1482,36 @@ int stats_main(int argc, char** argv){
                 show_paths = true;
                 all = false;
                 break;
+            case 'c':
+                show_composition = true;
+                all = false;
+                break;
+            case 'H':
+                show_histogram = true;
+                all = false;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'N':
+                for (auto x : pliib::split(optarg, ',')){
+                    nx_values.push_back(stod(x));
+                }
+                assembly_stats = true;
+                all = false;
+                break;
+            case 'g':
+                genome_size = stoull(optarg);
+                assembly_stats = true;
+                all = false;
+                break;
+            case 'T':
+                show_topology = true;
+                all = false;
+                break;
+            case 'j':
+                json = true;
+                break;
 
             default:
                 abort();
@@ -972,69 +1525,127 @@ int stats_main(int argc, char** argv){
         show_edges = true;
         assembly_stats = true;
     }
+    if (optind >= argc){
+        cerr << "No GFA file provided." << endl;
+        stats_help(argv);
+        exit(1);
+    }
     gfa_file = argv[optind];
-    GFAKluge gg;
-    gg.parse_gfa_file(gfa_file);
+
+    // Topology and path metrics need the whole graph in memory; everything
+    // else is computed in a single streaming pass.
+    base_composition comp;
+    bool have_composition = false;
+    if (show_topology || show_paths){
+        GFAKluge gg;
+        bool parsed = gfa_file == "-" ? gg.parse_gfa_file(std::cin) : gg.parse_gfa_file(gfa_file);
+        if (!parsed){
+            cerr << "Couldn't open GFA file " << gfa_file << "." << endl;
+            exit(1);
+        }
+        topology_stats t = compute_topology(gg, threads);
+        if (json){
+            write_topology_json(cout, t, show_topology, show_paths);
+        }
+        else{
+            write_topology_tsv(cout, t, show_topology, show_paths);
+        }
+        if (show_composition){
+            comp = gg.get_composition();
+            have_composition = true;
+        }
+        if (!(show_nodes || show_edges || show_length || show_histogram || assembly_stats)){
+            if (show_composition){
+                print_composition(comp);
+            }
+            return 0;
+        }
+        if (gfa_file == "-"){
+            cerr << "Other statistics can't be combined with -p / -T when reading from stdin." << endl;
+            exit(1);
+        }
+    }
+
+    gfa_stream_stats st;
+    st.keep_lengths = assembly_stats;
+    st.count_composition = show_composition && !have_composition;
+    if (!stream_stats(gfa_file, st, threads)){
+        cerr << "Couldn't open GFA file " << gfa_file << "." << endl;
+        exit(1);
+    }
+
     if (show_nodes){
-        int num_nodes = gg.get_name_to_seq().size();
-        cout << "Number of nodes: " << num_nodes << endl;
+        cout << "Number of nodes: " << st.segments << endl;
     }
     if (show_edges){
-        
-        uint64_t num_edges = 0;
-        uint64_t num_links = 0;
-        uint64_t num_contains = 0;
-        // map<string, vector<link_elem> >::iterator it;
-        // map<string, vector<link_elem> > s_to_l = gg.get_seq_to_link();
-        // for (it = s_to_l.begin(); it != s_to_l.end(); it++){
-        //     num_edges += (it->second).size();
-        // }
-        map<string, vector<edge_elem>> c_edge_map = gg.get_seq_to_edges();
-        for (auto s : gg.get_name_to_seq()){
-            vector<edge_elem> cvec = c_edge_map[s.first];
-            for (auto e = cvec.begin(); e != cvec.end(); e++){
-                num_edges++;
-                int t = e->determine_type();
-                if (t == 1){
-                    num_links++;
-                }
-                else if (t == 2){
-                    num_contains++;
-                }
-            }
+        cout << "Number of edges: " << st.edges() << endl;
+        cout << "Number of links: " << st.links << endl;
+        cout << "Number of containments: " << st.containments << endl;
+        if (st.other_edges > 0){
+            cout << "Number of other edges: " << st.other_edges << endl;
         }
-        
-        cout << "Number of edges: " << num_edges << endl;
-        cout << "Number of links: " << num_links << endl;
-        cout << "Number of containments: " << num_contains << endl;
-        
+    }
+    if (show_nodes){
+        cout << "Number of paths: " << st.paths << endl;
+        cout << "Number of path steps: " << st.path_steps + st.walk_steps << endl;
+        cout << "Number of unordered groups: " << st.unordered_groups << endl;
+        cout << "Number of fragments: " << st.fragments << endl;
+        cout << "Number of gaps: " << st.gaps << endl;
     }
     if (show_length){
-        //This one's exciting. Let's iterate over the sequence elements and sum
-        //the length of their sequence.
-        map<string, sequence_elem, custom_key> my_seqs = gg.get_name_to_seq();
-        map<string, sequence_elem, custom_key>::iterator it;
-        int64_t total_len = 0;
-
-        for (it = my_seqs.begin(); it != my_seqs.end(); it++){
-            total_len += (it->second).length;
+        cout << "Total graph length in basepairs: " << st.total_length << endl;
+        if (st.segments > st.segments_without_length){
+            cout << "Shortest node: " << st.min_length << endl;
+            cout << "Longest node: " << st.max_length << endl;
+            cout << "Mean node length: " << st.mean_length() << endl;
+        }
+        if (st.segments_without_length > 0){
+            cout << "Nodes without a length: " << st.segments_without_length << endl;
         }
-        cout << "Total graph length in basepairs: " << total_len << endl;
     }
-    
-    if (show_paths){
-        
+    if (show_histogram){
+        cout << "#min_length\tmax_length\tcount" << endl;
+        for (size_t i = 0; i < st.length_histogram.size(); ++i){
+            if (st.length_histogram[i] > 0){
+                uint64_t lo = i == 0 ? 0 : (uint64_t) 1 << (i - 1);
+                uint64_t hi = i == 0 ? 0 : (i == 64 ? UINT64_MAX : ((uint64_t) 1 << i) - 1);
+                cout << lo << "\t" << hi << "\t" << st.length_histogram[i] << endl;
+            }
+        }
+    }
+
+    if (show_composition){
+        print_composition(have_composition ? comp : st.composition);
     }
 
     if (assembly_stats){
-        cout << "N50: " <<  (uint64_t) gg.get_N50() << endl;
-        cout << "N90: " << (uint64_t) gg.get_N90() << endl;
-        cout << "L50: " << (uint64_t) gg.get_L50() << endl;
-        cout << "L90: " << (uint64_t) gg.get_L90() << endl;
+        bool default_nx = nx_values.empty();
+        if (default_nx){
+            nx_values = {50.0, 90.0};
+        }
+        contiguity_stats cs = contiguity(st.lengths, nx_values, genome_size);
+        if (default_nx){
+            cout << "N50: " << cs.nx[0] << endl;
+            cout << "N90: " << cs.nx[1] << endl;
+            cout << "L50: " << cs.lx[0] << endl;
+            cout << "L90: " << cs.lx[1] << endl;
+        }
+        else{
+            for (size_t i = 0; i < nx_values.size(); ++i){
+                cout << "N" << nx_values[i] << ": " << cs.nx[i] << endl;
+                cout << "L" << nx_values[i] << ": " << cs.lx[i] << endl;
+            }
+        }
+        cout << "auN: " << cs.auN << endl;
+        if (genome_size > 0){
+            for (size_t i = 0; i < nx_values.size(); ++i){
+                cout << "NG" << nx_values[i] << ": " << cs.ngx[i] << endl;
+                cout << "LG" << nx_values[i] << ": " << cs.lgx[i] << endl;
+            }
+            cout << "auNG: " << cs.auNG << endl;
+        }
     }
-   
 
-    
     return 0;
 }
 
@@ -1045,6 +1656,10 @@ int subset_main(int argc, char** argv){
     double spec = 0;
     uint64_t start_id = 0;
     uint64_t end_id = UINT64_MAX;
+    string node_list;
+    string region;
+    bool region_fasta = false;
+    int threads = 1;
 
     if (argc == 1){
         subset_help(argv);
@@ -1061,12 +1676,16 @@ int subset_main(int argc, char** argv){
             {"spec", required_argument, 0, 'S'},
             {"end-id", required_argument, 0, 'e'},
             {"start-id", required_argument, 0, 's'},
+            {"node-list", required_argument, 0, 'n'},
+            {"region", required_argument, 0, 'r'},
+            {"fasta", no_argument, 0, 'f'},
+            {"threads", required_argument, 0, 't'},
             {"version", no_argument, 0, 'v'},
             {0,0,0,0}
         };
     
         int option_index = 0;
-        c = getopt_long(argc, argv, "vs:e:hS:b", long_options, &option_index);
+        c = getopt_long(argc, argv, "vs:e:n:hS:br:ft:", long_options, &option_index);
         if (c == -1){
             break;
         }
@@ -1086,9 +1705,21 @@ int subset_main(int argc, char** argv){
             case 'e':
                 end_id = stoul(optarg);
                 break;
+            case 'n':
+                node_list = optarg;
+                break;
             case 'b':
                 block_order = true;
                 break;
+            case 'r':
+                region = optarg;
+                break;
+            case 'f':
+                region_fasta = true;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
             case 'v':
                 print_version_help();
                 exit(0);
@@ -1098,7 +1729,7 @@ int subset_main(int argc, char** argv){
         }
     }
 
-    if (argc < 3){
+    if (argc < 3 || optind >= argc){
         cerr << "No GFA file provided" << endl;
         subset_help(argv);
         exit(1);
@@ -1110,45 +1741,73 @@ int subset_main(int argc, char** argv){
         optind++;
     }
 
-    for (auto i : gfiles){
-        GFAKluge gg;
-        GFAKluge outg;
-        gg.parse_gfa_file(i);
-        gg.gfa_2_ize();
-
-        map<string, sequence_elem, custom_key> seqs = gg.get_name_to_seq();
-        map<string, vector<edge_elem>> edges = gg.get_seq_to_edges();
-        map<string, vector<gap_elem>> gaps = gg.get_seq_to_gaps();
-        map<string, vector<fragment_elem>> fragments = gg.get_seq_to_fragments();
-        
-        for (auto s : seqs){
-            if (stoul(s.first) <= end_id && stoul(s.first) >= start_id){
-                outg.add_sequence(s.second);
-                for (auto e : edges[s.first]){
-                    if (stoul(e.sink_name) <= end_id && stoul(e.sink_name) >= start_id){
-                        outg.add_edge(e.source_name, e);
-                    }
-                }
-                for (auto gap : gaps[s.first]){
-                    outg.add_gap(gap);
-                }
-                for (auto frag : fragments[s.first]){
-                    outg.add_fragment(s.first, frag);
+    if (!region.empty()){
+        string path_name;
+        uint64_t start = 0;
+        uint64_t end = 0;
+        if (!parse_region(region, path_name, start, end)){
+            cerr << "Error: invalid region \"" << region << "\"; expected path:start-end." << endl;
+            exit(1);
+        }
+        for (auto i : gfiles){
+            GFAKluge gg;
+            gg.parse_gfa_file(i);
+            path_position_index pi(gg, threads);
+            if (!pi.has_path(path_name)){
+                cerr << "Error: no path named " << path_name << " in " << i << "." << endl;
+                exit(1);
+            }
+            if (region_fasta){
+                string seq;
+                if (!region_sequence(gg, pi, path_name, start, end, seq)){
+                    cerr << "Error: could not extract sequence for region " << region << "." << endl;
+                    exit(1);
                 }
+                cout << ">" << region << endl << seq << endl;
+                continue;
             }
-            
-        }
-        // TODO Just copy over all paths, but preferably trim the orientations and items vectors
-        for (auto p : gg.get_name_to_path())
-        {
-            outg.add_path(p.first, p.second);
+            GFAKluge outg;
+            outg.set_version(spec != 0.0 ? spec : gg.get_version());
+            if (!extract_region(gg, pi, path_name, start, end, outg)){
+                cerr << "Error: region " << region << " does not overlap path " << path_name << "." << endl;
+                exit(1);
+            }
+            cout << (block_order ? outg.block_order_string() : outg.to_string());
         }
+        return 0;
+    }
 
+    node_selection sel;
+    sel.start = start_id;
+    sel.end = end_id;
+    if (!node_list.empty() && !sel.load_names(node_list)){
+        cerr << "Error: could not read node list " << node_list << "." << endl;
+        exit(1);
+    }
+    for (auto i : gfiles){
+        if (!is_mappable_file(i)){
+            cerr << "subset reads its input twice and can't read from stdin or a pipe." << endl;
+            exit(1);
+        }
+        if (spec == 0.0 && !block_order){
+            if (!stream_subset(i, sel, cout)){
+                cerr << "Error: could not read " << i << "." << endl;
+                exit(1);
+            }
+            continue;
+        }
+        // Converting the output needs a graph, but only the subset is loaded.
+        stringstream ss;
+        if (!stream_subset(i, sel, ss)){
+            cerr << "Error: could not read " << i << "." << endl;
+            exit(1);
+        }
+        GFAKluge outg;
+        outg.parse_gfa_file(ss);
         if (spec != 0.0){
             outg.set_version(spec);
         }
-        cout << outg.to_string() << endl;
-
+        cout << (block_order ? outg.block_order_string() : outg.to_string());
     }
     return 0;
 }
@@ -1167,6 +1826,9 @@ int main(int argc, char** argv){
     else if (strcmp(argv[1], "diff") == 0){
         return diff_main(argc, argv);
     }
+    else if (strcmp(argv[1], "hash") == 0){
+        return hash_main(argc, argv);
+    }
     else if (strcmp(argv[1], "extract") == 0){
         return extract_main(argc, argv);
     }
@@ -1197,6 +1859,9 @@ int main(int argc, char** argv){
     else if (strcmp(argv[1], "build") == 0){
         return build_main(argc, argv);
     }
+    else if (strcmp(argv[1], "validate") == 0){
+        return validate_main(argc, argv);
+    }
     else if (strcmp(argv[1], "trim") == 0){
         return trim_main(argc, argv);
     }
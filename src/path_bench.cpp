@@ -0,0 +1,165 @@
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include "gfakluge.hpp"
+
+using namespace std;
+using namespace gfak;
+
+/**
+ * Compare the memory footprint of the compact_paths a GFAKluge stores
+ * against the path_elems they decode to, and time encoding and decoding,
+ * either on a GFA file or on a synthetic
+ * graph of haplotype-like paths.
+ */
+
+void path_bench_help(char** argv){
+    cerr << argv[0] << ": benchmark compact path encoding." << endl
+        << "Usage: " << argv[0] << " [options] [<GFA_FILE>]" << endl
+        << "Options:" << endl
+        << "  -n / --segments <INT>  Number of segments in the synthetic graph (default: 100000)." << endl
+        << "  -p / --paths <INT>     Number of synthetic haplotype paths (default: 100)." << endl
+        << endl;
+}
+
+inline size_t string_bytes(const string& s){
+    return sizeof(string) + (s.capacity() > 15 ? s.capacity() + 1 : 0);
+}
+
+inline size_t path_elem_bytes(const path_elem& p){
+    size_t b = sizeof(path_elem) + string_bytes(p.name);
+    for (auto& n : p.segment_names){
+        b += string_bytes(n);
+    }
+    for (auto& o : p.overlaps){
+        b += string_bytes(o);
+    }
+    b += p.orientations.capacity() / 8;
+    return b;
+}
+
+// Haplotypes walk the segments in order, taking one side of a
+// two-segment bubble at random every so often.
+void make_synthetic_graph(GFAKluge& gg, uint64_t n_segments, uint64_t n_paths){
+    mt19937_64 rng(31);
+    for (uint64_t i = 1; i <= n_segments; ++i){
+        sequence_elem s;
+        s.name = to_string(i);
+        s.sequence = "*";
+        s.length = 32;
+        gg.add_sequence(s);
+    }
+    for (uint64_t p = 0; p < n_paths; ++p){
+        path_elem pe;
+        pe.name = "hap" + to_string(p);
+        uint64_t i = 1;
+        while (i <= n_segments){
+            if (i + 2 <= n_segments && i % 10 == 0){
+                // Bubble: visit one of i, i + 1 and then continue at i + 2
+                pe.segment_names.push_back(to_string(i + (rng() & 1)));
+                i += 2;
+            }
+            else{
+                pe.segment_names.push_back(to_string(i++));
+            }
+            pe.orientations.push_back(true);
+        }
+        pe.overlaps.assign(pe.segment_names.size(), "0M");
+        gg.add_path(pe.name, pe);
+    }
+}
+
+int main(int argc, char** argv){
+    uint64_t n_segments = 100000;
+    uint64_t n_paths = 100;
+
+    int c;
+    optind = 1;
+    while (true){
+        static struct option long_options[] =
+        {
+            {"help", no_argument, 0, 'h'},
+            {"segments", required_argument, 0, 'n'},
+            {"paths", required_argument, 0, 'p'},
+            {0,0,0,0}
+        };
+
+        int option_index = 0;
+        c = getopt_long(argc, argv, "hn:p:", long_options, &option_index);
+        if (c == -1){
+            break;
+        }
+
+        switch (c){
+            case '?':
+            case 'h':
+                path_bench_help(argv);
+                exit(0);
+            case 'n':
+                n_segments = stoull(optarg);
+                break;
+            case 'p':
+                n_paths = stoull(optarg);
+                break;
+            default:
+                abort();
+        }
+    }
+
+    GFAKluge gg;
+    if (optind < argc){
+        gg.parse_gfa_file(argv[optind]);
+    }
+    else{
+        make_synthetic_graph(gg, n_segments, n_paths);
+    }
+
+    // Decode every path of gg to a path_elem, as for_each_path does.
+    uint64_t n_paths_read = 0;
+    uint64_t n_steps = 0;
+    size_t elem_bytes = 0;
+    uint64_t elem_checksum = 0;
+    auto t0 = chrono::steady_clock::now();
+    gg.for_each_path([&](const path_elem& p){
+            for (size_t i = 0; i < p.segment_names.size(); ++i){
+                elem_checksum += p.segment_names[i].length() + p.orientations[i];
+            }
+            ++n_paths_read;
+            n_steps += p.segment_names.size();
+            elem_bytes += path_elem_bytes(p);
+            });
+    auto t1 = chrono::steady_clock::now();
+
+    // Encode them again into a second graph, and check that they round-trip.
+    GFAKluge copy;
+    gg.for_each_path([&](const path_elem& p){
+            copy.add_path(p.name, p);
+            });
+    auto t2 = chrono::steady_clock::now();
+
+    uint64_t copy_checksum = 0;
+    copy.for_each_path([&](const path_elem& p){
+            for (size_t i = 0; i < p.segment_names.size(); ++i){
+                copy_checksum += p.segment_names[i].length() + p.orientations[i];
+            }
+            });
+
+    double decode_secs = chrono::duration<double>(t1 - t0).count();
+    double encode_secs = chrono::duration<double>(t2 - t1).count() - decode_secs;
+    size_t compact_bytes = gg.path_memory_bytes();
+
+    cout << "Paths: " << n_paths_read << endl
+        << "Steps: " << n_steps << endl
+        << "path_elem bytes: " << elem_bytes << endl
+        << "compact_path bytes: " << compact_bytes << endl
+        << "Segment dictionary bytes: " << gg.path_dictionary_bytes() << endl
+        << "Compression ratio: " << (compact_bytes > 0 ? (double) elem_bytes / compact_bytes : 0.0) << endl
+        << "Encode time (s): " << (encode_secs > 0 ? encode_secs : 0.0) << endl
+        << "Decode to path_elem (Msteps/s): " << (decode_secs > 0 ? n_steps / decode_secs / 1e6 : 0.0) << endl;
+
+    if (elem_checksum != copy_checksum){
+        cerr << "Error: decoded paths do not match the original paths." << endl;
+        return 1;
+    }
+    return 0;
+}
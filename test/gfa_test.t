@@ -4,7 +4,7 @@
 BASH_TAP_ROOT=./bash-tap
 . ./bash-tap/bash-tap-bootstrap
 
-plan tests 8
+plan tests 47
 
 ## Importing a GFA file in GFA1 and converting it to GFA2
 is $(./gfak convert -S 2.0 data/v1.gfa | md5sum | awk '{ print $1 }') "268e075f19c7600304b51247b11e5f0f" "Importing a GFA file in GFA1 and converting it to GFA2"
@@ -21,6 +21,7 @@ is $(./gfak sort data/gfa_2.gfa | md5sum | awk '{ print $1 }') "fa3b92296d3a23f9
 
 ## Extracting FASTA records from a GFA file
 is $(./gfak extract data/gfa_2.gfa | sort | md5sum | awk '{ print $1 }') "43bbe8fee3f67fd90b90ee885ddb15e3" "Extracting FASTA records from a GFA file"
+is $(./gfak extract -P 2p -t 2 data/gfa_2.gfa | md5sum | awk '{ print $1 }') "30c77d7282a3bde469910cf23ff8bc5d" "Extracting the sequence of a path from a GFA file"
 
 ## Replacing sequence placeholders with FASTA records
 is $(./gfak fillseq -f data/no_seqs.fa data/no_seqs.gfa | md5sum | awk '{ print $1 }') "caaf91eac390521d68d56bad57f7b3b3" "A GFA file can have sequence placeholders replaced with seqs from a FASTA file."
@@ -28,5 +29,121 @@ is $(./gfak fillseq -f data/no_seqs.fa data/no_seqs.gfa | md5sum | awk '{ print
 ## Bumping the ID space of a graph.
 is $(./gfak ids -s 9:9:9 data/test.gfa | sort | md5sum | awk '{ print $1 }') $(cat data/re_id.gfa | sort | md5sum | awk '{ print $1 }') "gfak ids can bump the ID space of the graph."
 
+## Renumbering segments with non-numeric names
+is "$(./gfak ids -c -s 100:0:0:0:0 data/non_numeric.gfa 2> /dev/null | grep "^P" | cut -f 3)" "102+,101+,103-" "gfak ids -c gives segments with non-numeric names integer IDs."
+
+## Streaming the ID spaces of several graphs
+is $(./gfak ids -z -t 2 -s 9:9:9 data/test.gfa data/test.gfa 2> /dev/null | grep "^S" | cut -f 2 | tr '\n' ',') "10,11,12,13,14,15,16,17,18,19,20,21," "gfak ids -z offsets the IDs of each graph past those of the graphs before it."
+
+## Streaming the ID spaces of pipes
+is "$(./gfak ids -z -s 9:9:9 <(cat data/test.gfa) data/test.gfa > /dev/null 2>&1; echo $?)" "1" "gfak ids -z refuses input it can't read twice."
+
 ## Merging two GFA files
 is $(./gfak merge -S 2.0 data/test.gfa data/gfa_2.gfa | md5sum | awk '{ print $1 }') "ca3b52673b63de931cd64a50669e7147" "Two graphs can be merged."
+
+## Merging graphs with the same IDs
+is "$(./gfak merge -S 2.0 data/test.gfa data/test.gfa 2> /dev/null | grep "^E" | cut -f 3-4 | tr '\t\n' ', ')" "1+,2+ 3+,2+ 3+,4- 4-,5+ 5+,6+ 7+,8+ 9+,8+ 9+,10- 10-,11+ 11+,12+ " "gfak merge renames segments whose IDs are taken."
+
+## Streaming a merge
+is "$(./gfak merge -s data/test.gfa data/test.gfa 2> /dev/null | grep "^[LC]" | cut -f 2,4 | tr '\t\n' ', ')" "1,2 3,2 3,4 4,5 5,6 7,8 9,8 9,10 10,11 11,12 " "gfak merge -s offsets the IDs of each file."
+
+## Streaming a merge of pipes
+is "$(./gfak merge -s <(cat data/test.gfa) data/test.gfa > /dev/null 2>&1; echo $?)" "1" "gfak merge -s refuses input it can't read twice."
+
+## Streaming a merge of graphs with non-numeric names
+is "$(./gfak merge -s data/non_numeric.gfa data/non_numeric.gfa 2> /dev/null | grep "^S" | cut -f 2 | tr '\n' ' ')" "ctg_a 7 ctg_b ctg_a_1 14 ctg_b_1 " "gfak merge -s renames non-numeric segments whose names are taken."
+
+## Extracting the sequence of a path interval
+is $(./gfak subset -f -r 1p:135-145 data/gfa_2.gfa | tail -n 1) "TAGAAAAAAGA" "gfak subset can extract the sequence of a path interval."
+
+## Subsetting a graph by node list
+is "$(./gfak subset -n <(printf "1\n3\n4\n") data/trim_paths.gfa | grep "^[LP]" | cut -f 2-3 | tr '\t\n' ', ')" "3,+ x_1,1+ x_2,3+,4+ y,3+,4+ " "gfak subset cuts paths into the runs of kept segments."
+
+## Subsetting a path whose piece names are taken
+is "$(./gfak subset -n <(printf "1\n3\n4\n") data/trim_collide.gfa | grep "^P" | cut -f 2,3 | tr '\t\n' ', ')" "x_2,1+ x_3,3+ x_1,3+,4+ " "gfak subset numbers path pieces past the names of other paths."
+
+## Reporting the base composition of a graph
+is $(./gfak stats -c data/gfa_2.gfa | grep "GC bases" | cut -d ' ' -f 3) "159" "gfak stats can report the base composition of a graph."
+
+## Reporting the base composition of a loaded graph
+is $(./gfak stats -c -T - < data/gfa_2.gfa | grep "GC bases" | cut -d ' ' -f 3) "159" "gfak stats -c uses the loaded graph's composition with -T, even on stdin."
+
+## Counting the records of a graph read from stdin
+is $(cat data/gfa_2.gfa | ./gfak stats -e - | grep "Number of links" | cut -d ' ' -f 4) "12" "gfak stats can count the records of a graph streamed on stdin."
+
+## Contiguity statistics relative to a genome size
+is $(./gfak stats -N 50 -g 600 data/gfa_2.gfa | grep "NG50" | cut -d ' ' -f 2) "81" "gfak stats can report NGx values for a given genome size."
+
+## Degree and topology metrics
+is $(./gfak stats -T data/gfa_2.gfa | grep "dovetails" | cut -f 3) "12" "gfak stats can report the topology of a graph."
+
+## Comparing graphs across GFA versions
+is $(./gfak diff -q data/test.gfa <(./gfak convert -S 2.0 data/test.gfa) 2> /dev/null; echo $?) "0" "gfak diff finds no differences between a graph and its GFA2 conversion."
+
+## Listing the differences of a pipe
+is "$(./gfak diff data/test.gfa <(cat data/gfa_2.gfa) 2>&1 > /dev/null)" "diff reads its inputs twice; use -q to compare a graph on stdin or a pipe." "gfak diff refuses to list the differences of input it can't read twice."
+
+## Fingerprinting a graph independent of its GFA version
+is $(./gfak convert -S 2.0 data/test.gfa | ./gfak hash - | cut -f 1 -d ' ') $(./gfak hash data/test.gfa | cut -f 1 -d ' ') "gfak hash gives a graph the same fingerprint in GFA1 and GFA2."
+
+## Fingerprinting an edge that overlaps the start of its first segment
+is $(./gfak hash data/dovetail_gfa2.gfa | cut -f 1 -d ' ') $(./gfak hash data/dovetail_gfa1.gfa | cut -f 1 -d ' ') "gfak hash reads an E line overlapping the start of its first segment as a link into it."
+
+## Validating a graph
+is $(./gfak validate data/dangling.gfa 2> /dev/null | cut -f 3 | sort -u) "dangling_edge" "gfak validate reports edges to missing segments."
+
+## Validating a pipe
+is "$(./gfak validate <(cat data/dangling.gfa) 2>&1 > /dev/null; echo $?)" "$(printf "validate reads its input twice and can't read from stdin or a pipe.\n1")" "gfak validate refuses input it can't read twice."
+
+## Trimming a graph and splitting its paths
+is "$(./gfak trim -l 4 -p data/trim_paths.gfa | grep "^P" | cut -f 2 | tr '\n' ' ')" "x_1 x_2 y " "gfak trim -p splits paths at removed segments."
+
+## Splitting a path whose piece names are taken
+is "$(./gfak trim -l 4 -p data/trim_collide.gfa | grep "^P" | cut -f 2,3 | tr '\t\n' ', ')" "x_1,3+,4+ x_2,1+ x_3,3+ " "gfak trim -p numbers path pieces past the names of other paths."
+
+## Splitting paths past the names of groups
+is "$(./gfak trim -l 4 -p data/trim_group_collide.gfa 2> /dev/null | grep "^[OU]" | cut -f 1,2 | tr '\t\n' ', ')" "U,x_1 O,x_2 O,x_3 " "gfak trim -p numbers path pieces past the names of groups."
+
+## Filling sequences from a FASTA file with Windows line endings
+is $(./gfak fillseq -t 2 -f data/no_seqs_crlf.fa data/no_seqs.gfa 2> /dev/null | md5sum | awk '{ print $1 }') "caaf91eac390521d68d56bad57f7b3b3" "gfak fillseq strips carriage returns from FASTA records."
+
+## Streaming sequences into a graph
+is $(./gfak fillseq -s -f data/no_seqs.fa data/no_seqs.gfa 2> /dev/null | ./gfak convert -S 2.0 - | md5sum | awk '{ print $1 }') "caaf91eac390521d68d56bad57f7b3b3" "gfak fillseq -s fills the same sequences without loading the graph."
+
+## Building contig graphs in parallel
+is $(./gfak build -m 16 -t 4 -f data/build_ref.fa -v data/build.vcf 2> /dev/null | md5sum | awk '{ print $1 }') $(./gfak build -m 16 -f data/build_ref.fa -v data/build.vcf 2> /dev/null | md5sum | awk '{ print $1 }') "gfak build gives the same graph on one thread and many."
+
+## Building from a gzipped VCF
+is $(./gfak build -m 16 -f data/build_ref.fa -v data/build.vcf.gz 2> /dev/null | md5sum | awk '{ print $1 }') $(./gfak build -m 16 -f data/build_ref.fa -v data/build.vcf 2> /dev/null | md5sum | awk '{ print $1 }') "gfak build reads gzip-compressed VCFs."
+
+# The region tests index a copy of the VCF, so the checkout is left clean.
+gvi_dir=$(mktemp -d)
+cp data/build.vcf ${gvi_dir}/
+
+## Building the graph of a region
+is "$(./gfak build -m 16 -f data/build_ref.fa -v ${gvi_dir}/build.vcf -r chr1:15-60 2> /dev/null | grep "^O")" "$(printf "O\tchr1:15-60\t1+ 3+ 4+ 5+ 6+ 7+ 8+")" "gfak build -r builds the graph of a region."
+
+## Building a region that starts at a variant
+is "$(./gfak build -m 16 -f data/build_ref.fa -v ${gvi_dir}/build.vcf -r chr2:10-10 2>&1 > /dev/null | grep "^Skipped")" "Skipped 1 variants at the first base of chr2:10-10." "gfak build -r skips variants at the first base of the region, and says so."
+
+## Building a region through a tabix index
+is $(./gfak build -m 16 -f data/build_ref.fa -v data/build_bgzf.vcf.gz -r chr1:15-60 2> /dev/null | md5sum | awk '{ print $1 }') $(./gfak build -m 16 -f data/build_ref.fa -v ${gvi_dir}/build.vcf -r chr1:15-60 2> /dev/null | md5sum | awk '{ print $1 }') "gfak build -r reads bgzipped VCFs through their tabix index."
+
+## Rebuilding a stale VCF index
+printf "chr1\t0\t100000\n" > ${gvi_dir}/build.vcf.gvi
+is $(./gfak build -m 16 -f data/build_ref.fa -v ${gvi_dir}/build.vcf -r chr1:15-60 2> /dev/null | md5sum | awk '{ print $1 }') $(./gfak build -m 16 -f data/build_ref.fa -v data/build_bgzf.vcf.gz -r chr1:15-60 2> /dev/null | md5sum | awk '{ print $1 }') "gfak build -r rebuilds a .gvi index that doesn't match its VCF."
+rm -rf ${gvi_dir}
+
+## Building through a small FASTA window
+is $(./gfak build -m 16 -w 7 -f data/build_ref.fa -v data/build.vcf 2> /dev/null | md5sum | awk '{ print $1 }') $(./gfak build -m 16 -f data/build_ref.fa -v data/build.vcf 2> /dev/null | md5sum | awk '{ print $1 }') "gfak build -w gives the same graph for any window size."
+
+## Building haplotype paths from phased genotypes
+is "$(./gfak build -m 16 -p -f data/build_ref.fa -v data/build_gt.vcf 2> /dev/null | grep "^O" | cut -f 2 | tr '\n' ' ')" "chr1 NA1#1#chr1 NA1#2#chr1 NA2#1#chr1 NA2#2#chr1 chr2 NA1#1#chr2 NA1#2#chr2 NA2#1#chr2 " "gfak build -p adds a path for each haplotype with an alternate allele."
+
+## Building insertions
+is "$(./gfak build -m 100 -f data/build_ref.fa -v data/build_sv.vcf -i data/build_ins.fa 2> /dev/null | awk '($1 == "S" && $2 == 7) || ($1 == "E" && ($3 == "7+" || $4 == "7+")) { print $1, $3, $4 }' | tr '\n' ',')" "S 6 CCCCCC,E 6+ 7+,E 7+ 8+," "gfak build writes an insertion node between the nodes on either side of it."
+is "$(./gfak build -m 100 -f data/build_ref.fa -v data/build_sv.vcf 2>&1 > /dev/null | grep "^No sequence" | tr '\n' ',')" "No sequence for insertion <INS_A> at chr1:30; skipping it.,No sequence for insertion <INS> at chr1:60; skipping it.," "gfak build skips insertions it can't find a sequence for, and says so."
+
+## Building a known graph from an SNP, insertions and a deletion
+is "$(./gfak build -m 100 -f data/build_ref.fa -v data/build_sv.vcf -i data/build_ins.fa 2> /dev/null | grep -c "^S") $(./gfak build -m 100 -f data/build_ref.fa -v data/build_sv.vcf -i data/build_ins.fa 2> /dev/null | awk '$1 == "E" { print $3 $4 }' | tr '\n' ' ')" "11 1+2+ 1+3+ 2+4+ 3+4+ 4+5+ 5+6+ 4+6+ 6+7+ 7+8+ 6+8+ 8+9+ 9+10+ 10+11+ 8+10+ " "gfak build makes the expected segments and edges for an SNP, insertions and a deletion."
+is "$(./gfak build -m 100 -f data/build_ref.fa -v data/build_sv.vcf -i data/build_ins.fa 2> /dev/null | grep "^O")" "$(printf "O\tchr1\t1+ 3+ 4+ 6+ 8+ 9+ 10+ 11+")" "gfak build makes the expected reference path through an SNP, insertions and a deletion."